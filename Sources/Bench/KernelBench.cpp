@@ -0,0 +1,800 @@
+#include <Core/CoreMinimal.h>
+#include <Core/Box.h>
+#include <Core/Camera.h>
+#include <Core/GridMedium.h>
+#include <Core/Integrator.h>
+#include <Core/MaterialTable.h>
+#include <Core/MovingSphere.h>
+#include <Core/Profiler.h>
+#include <Core/Rect.h>
+#include <Core/Sampler.h>
+#include <Core/Sphere.h>
+#include <Math/AABB.h>
+#include <Math/Sampling.h>
+#include <Scenes/Scenes.h>
+#include <cstdlib>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <string>
+
+// Times single intersection kernels on reproducible ray batches, sampling warps against the rejection loops they
+// replaced, camera rays, tracking through grid media and shading of every kind of material, and reports nanoseconds
+// per test.
+//
+// raytracer_kernelbench [--output <json>] [--baseline <json>] [--tolerance <fraction>] [--filter <kernel>]
+//
+// Before timing, checks that the edge pixels of equirectangular images don't overlap across the seam or the poles.
+// Every (kernel, variant, batch) triple is one record. With --baseline, records slower than the baseline by more than
+// the tolerance are reported and the process fails, so kernel regressions show up before full renders do.
+enum class BatchKind : uint32_t
+{
+   CoherentHit = 0,
+   CoherentMiss,
+   IncoherentHit,
+   IncoherentMiss,
+   Count
+};
+
+namespace KernelBenchConstants
+{
+   constexpr size_t RaysPerBatch = 4096;
+   constexpr size_t SamplesPerBatch = 4096;
+   constexpr int Trials = 7;
+   constexpr double MinimumTrialSeconds = 0.02;
+   constexpr double WarmupSeconds = 0.5;
+   constexpr uint64_t Seed = 1;
+   constexpr double DefaultTolerance = 0.15;
+   constexpr uint32_t JsonVersion = 1;
+   constexpr size_t BatchKindCount = static_cast<size_t>(BatchKind::Count);
+   constexpr const char* BatchNames[BatchKindCount] = { "CoherentHit", "CoherentMiss", "IncoherentHit", "IncoherentMiss" };
+   constexpr const char* SamplingBatchName = "Uniform";
+}
+
+struct RayBatch
+{
+public:
+   std::vector<Ray> Rays;
+   std::vector<Vec3> InverseDirections;
+
+};
+
+struct KernelVariant
+{
+public:
+   std::string Kernel;
+   std::string Variant;
+   AABB Bounds;
+   // Runs the kernel over every ray of the batch and returns number of hits.
+   std::function<size_t(const RayBatch&)> Run;
+
+};
+
+// Draws SamplesPerBatch samples from RandomDouble or a Sampler, adds them to sum, and returns the number of tuples of uniform
+// numbers drawn; more than the samples when a rejection loop threw some away.
+struct SamplingKernel
+{
+public:
+   std::string Kernel;
+   std::string Variant;
+   std::function<size_t(Vec3& sum)> Run;
+
+};
+
+// Shades every hit of a batch with one material of a table, emission then scattering like a bounce of the
+// integrators, adds what it got to sum, and returns the number of hits that scattered.
+struct ShadingKernel
+{
+public:
+   std::string Kernel;
+   std::string Variant;
+   std::function<size_t(const std::vector<HitRecord>& hits, const std::vector<Ray>& rays, Vec3& sum)> Run;
+
+};
+
+struct KernelResult
+{
+public:
+   std::string Kernel;
+   std::string Variant;
+   std::string Batch;
+   double NanosecondsPerTest = 0.0;
+   double HitRate = 0.0;
+
+};
+
+// Rejection samplers as Vec3.h had them, kept as the baseline of the warps and to generate the same ray batches.
+// draws counts the attempts.
+static Vec3 RejectionInUnitSphere(size_t& draws)
+{
+   while (true)
+   {
+      ++draws;
+      auto p = Vec3::Random(-1.0, 1.0);
+      if (p.SquaredLength() < 1.0)
+      {
+         return p;
+      }
+   }
+}
+
+static Vec3 RejectionInUnitDisk(size_t& draws)
+{
+   while (true)
+   {
+      ++draws;
+      auto p = Vec3(RandomDouble(-1.0, 1.0), RandomDouble(-1.0, 1.0), 0.0);
+      if (p.SquaredLength() < 1.0)
+      {
+         return p;
+      }
+   }
+}
+
+// Coherent batches shoot a scanline ordered grid from a single eye point, like primary rays. Incoherent batches start
+// on a sphere around the primitive and go in random order, like diffuse bounces. Hit batches aim inside the bounds,
+// miss batches aim at a ring around them; the measured hit rate is reported along with the timings. Rays face the
+// thinnest axis of the bounds, so flat primitives like rects are seen from the front.
+static RayBatch GenerateBatch(const AABB& bounds, BatchKind kind)
+{
+   SeedRandom(KernelBenchConstants::Seed + static_cast<uint64_t>(kind));
+   const Point3 center = bounds.Centroid();
+   const Vec3 halfExtent = 0.5 * (bounds.Maximum - bounds.Minimum);
+   const double radius = std::max(halfExtent.Length(), 1e-3);
+   const bool bHit = kind == BatchKind::CoherentHit || kind == BatchKind::IncoherentHit;
+
+   int facing = 0;
+   for (int axis = 1; axis < 3; ++axis)
+   {
+      facing = halfExtent[axis] < halfExtent[facing] ? axis : facing;
+   }
+
+   const int axisU = (facing + 1) % 3;
+   const int axisV = (facing + 2) % 3;
+   auto target = [&](double s, double t)
+   {
+      Vec3 offset;
+      if (bHit)
+      {
+         // Shrink towards the center so that grazing rays still hit most of the time.
+         offset[axisU] = 0.8 * (2.0 * s - 1.0) * halfExtent[axisU];
+         offset[axisV] = 0.8 * (2.0 * t - 1.0) * halfExtent[axisV];
+         offset[facing] = 0.8 * RandomDouble(-1.0, 1.0) * halfExtent[facing];
+      }
+      else
+      {
+         const double angle = 2.0 * Pi * s;
+         const double distance = radius * (1.5 + 1.5 * t);
+         offset[axisU] = distance * std::cos(angle);
+         offset[axisV] = distance * std::sin(angle);
+      }
+
+      return center + offset;
+   };
+
+   RayBatch batch;
+   batch.Rays.reserve(KernelBenchConstants::RaysPerBatch);
+   if (kind == BatchKind::CoherentHit || kind == BatchKind::CoherentMiss)
+   {
+      Vec3 eyeOffset;
+      eyeOffset[facing] = -4.0 * radius;
+      eyeOffset[axisU] = 0.3 * radius;
+      eyeOffset[axisV] = 0.2 * radius;
+      const Point3 eye = center + eyeOffset;
+      const size_t side = static_cast<size_t>(std::sqrt(static_cast<double>(KernelBenchConstants::RaysPerBatch)));
+      for (size_t idx = 0; idx < KernelBenchConstants::RaysPerBatch; ++idx)
+      {
+         const double s = (static_cast<double>(idx % side) + 0.5) / side;
+         const double t = (static_cast<double>(idx / side) + 0.5) / side;
+         batch.Rays.emplace_back(eye, target(s, t) - eye, 0.5);
+      }
+   }
+   else
+   {
+      for (size_t idx = 0; idx < KernelBenchConstants::RaysPerBatch; ++idx)
+      {
+         size_t draws = 0;
+         Vec3 direction = UnitVectorOf(RejectionInUnitSphere(draws));
+         // Keep origins on the front hemisphere so that rays cross the wide face of the bounds.
+         direction[facing] = -std::fabs(direction[facing]) - 0.25;
+         const Point3 origin = center + 4.0 * radius * UnitVectorOf(direction);
+         batch.Rays.emplace_back(origin, target(RandomDouble(), RandomDouble()) - origin, RandomDouble());
+      }
+   }
+
+   batch.InverseDirections.reserve(batch.Rays.size());
+   for (const auto& ray : batch.Rays)
+   {
+      batch.InverseDirections.emplace_back(1.0 / ray.Direction.x, 1.0 / ray.Direction.y, 1.0 / ray.Direction.z);
+   }
+
+   return batch;
+}
+
+template<typename PrimitiveType>
+static KernelVariant MakeHittableKernel(std::string kernel, std::shared_ptr<PrimitiveType> primitive, std::string variant = "Reference")
+{
+   AABB bounds;
+   primitive->BoundingBox(0.0, 1.0, bounds);
+   return { std::move(kernel), std::move(variant), bounds, [primitive](const RayBatch& batch)
+      {
+         size_t hits = 0;
+         HitRecord rec;
+         for (const auto& ray : batch.Rays)
+         {
+            hits += primitive->PrimitiveType::Hit(ray, 0.001, Infinity, rec) ? 1 : 0;
+         }
+
+         return hits;
+      } };
+}
+
+static std::vector<KernelVariant> CreateKernels()
+{
+   constexpr uint32_t material = 0;
+   const AABB box(Point3(-1.0, -1.0, -1.0), Point3(1.0, 1.0, 1.0));
+
+   std::vector<KernelVariant> kernels;
+   kernels.push_back({ "AABB", "Reference", box, [box](const RayBatch& batch)
+      {
+         size_t hits = 0;
+         for (const auto& ray : batch.Rays)
+         {
+            hits += box.Hit(ray, 0.001, Infinity) ? 1 : 0;
+         }
+
+         return hits;
+      } });
+   kernels.push_back({ "AABB", "InverseDirection", box, [box](const RayBatch& batch)
+      {
+         size_t hits = 0;
+         for (size_t idx = 0; idx < batch.Rays.size(); ++idx)
+         {
+            hits += box.Hit(batch.Rays[idx], batch.InverseDirections[idx], 0.001, Infinity) ? 1 : 0;
+         }
+
+         return hits;
+      } });
+
+   kernels.push_back(MakeHittableKernel("Sphere", std::make_shared<Sphere>(Point3(0.0, 0.0, 0.0), 1.0, material)));
+   kernels.push_back(MakeHittableKernel("MovingSphere",
+      std::make_shared<MovingSphere>(Point3(-0.25, 0.0, 0.0), Point3(0.25, 0.0, 0.0), 0.0, 1.0, 1.0, material)));
+   kernels.push_back(MakeHittableKernel("XYRect", std::make_shared<XYRect>(-1.0, 1.0, -1.0, 1.0, 0.0, material)));
+   kernels.push_back(MakeHittableKernel("XZRect", std::make_shared<XZRect>(-1.0, 1.0, -1.0, 1.0, 0.0, material)));
+   kernels.push_back(MakeHittableKernel("YZRect", std::make_shared<YZRect>(-1.0, 1.0, -1.0, 1.0, 0.0, material)));
+   kernels.push_back(MakeHittableKernel("Box", std::make_shared<Box>(Point3(-1.0, -1.0, -1.0), Point3(1.0, 1.0, 1.0), material)));
+
+   // Delta tracking through the cloud of CornellBoxCloud, fitted into the box with the optical depth it has there, on
+   // a dense and a sparse grid and against one majorant for the whole grid; then ratio tracking of transmittance
+   // through it, which counts rays that lost any light as hits.
+   constexpr double CloudDensity = 0.06 * 475.0 / 2.0;
+   const DensityGridData cloud = CloudGrid(64, box);
+   auto denseCloud = std::make_shared<GridMedium<DenseGrid>>(box, DenseGrid(cloud), CloudDensity, material);
+   kernels.push_back(MakeHittableKernel("CloudMedium", denseCloud, "Dense"));
+   kernels.push_back(MakeHittableKernel("CloudMedium", std::make_shared<GridMedium<SparseGrid>>(box, SparseGrid(cloud), CloudDensity, material), "Sparse"));
+   kernels.push_back(MakeHittableKernel("CloudMedium", std::make_shared<GridMedium<DenseGrid>>(box, DenseGrid(cloud), CloudDensity, material,
+      cloud.Resolution[0]), "OneMajorant"));
+   kernels.push_back({ "CloudShadowRay", "RatioTracking", box, [denseCloud](const RayBatch& batch)
+      {
+         size_t hits = 0;
+         for (const auto& ray : batch.Rays)
+         {
+            hits += denseCloud->Transmittance(ray, 0.001, Infinity) < 1.0 ? 1 : 0;
+         }
+
+         return hits;
+      } });
+   return kernels;
+}
+
+// Every pair of a rejection loop and its warp draws the same kind of sample; the analytic variants also cover the
+// warps which had no rejection counterpart.
+static std::vector<SamplingKernel> CreateSamplingKernels()
+{
+   const Vec3 normal = UnitVectorOf(Vec3(0.3, 0.8, -0.5));
+   auto repeat = [](auto drawSample)
+   {
+      return [drawSample](Vec3& sum)
+      {
+         size_t draws = 0;
+         for (size_t idx = 0; idx < KernelBenchConstants::SamplesPerBatch; ++idx)
+         {
+            sum += drawSample(draws);
+         }
+
+         return draws;
+      };
+   };
+
+   auto uniform2D = [](size_t& draws)
+   {
+      ++draws;
+      const double x = RandomDouble();
+      return Point2(x, RandomDouble());
+   };
+
+   std::vector<SamplingKernel> kernels;
+   kernels.push_back({ "UnitDisk", "Rejection", repeat([](size_t& draws) { return RejectionInUnitDisk(draws); }) });
+   kernels.push_back({ "UnitDisk", "Concentric", repeat([uniform2D](size_t& draws)
+      {
+         const Point2 p = SampleConcentricDisk(uniform2D(draws));
+         return Vec3(p.x, p.y, 0.0);
+      }) });
+   kernels.push_back({ "UnitBall", "Rejection", repeat([](size_t& draws) { return RejectionInUnitSphere(draws); }) });
+   kernels.push_back({ "UnitBall", "Analytic", repeat([uniform2D](size_t& draws)
+      {
+         const Point2 u = uniform2D(draws);
+         return SampleUniformBall(u, RandomDouble());
+      }) });
+   kernels.push_back({ "UnitSphere", "Rejection", repeat([](size_t& draws) { return UnitVectorOf(RejectionInUnitSphere(draws)); }) });
+   kernels.push_back({ "UnitSphere", "Analytic", repeat([uniform2D](size_t& draws) { return SampleUniformSphere(uniform2D(draws)); }) });
+   kernels.push_back({ "Hemisphere", "Rejection", repeat([normal](size_t& draws)
+      {
+         const Vec3 p = RejectionInUnitSphere(draws);
+         return Dot(p, normal) > 0.0 ? p : -p;
+      }) });
+   kernels.push_back({ "Hemisphere", "Analytic", repeat([uniform2D, normal](size_t& draws)
+      {
+         return OrthonormalBasis(normal).ToWorld(SampleUniformHemisphere(uniform2D(draws)));
+      }) });
+   kernels.push_back({ "CosineHemisphere", "Analytic", repeat([uniform2D, normal](size_t& draws)
+      {
+         return OrthonormalBasis(normal).ToWorld(SampleCosineHemisphere(uniform2D(draws)));
+      }) });
+   kernels.push_back({ "Cone", "Analytic", repeat([uniform2D](size_t& draws) { return SampleUniformCone(uniform2D(draws), 0.9); }) });
+   kernels.push_back({ "Triangle", "Analytic", repeat([uniform2D](size_t& draws) { return SampleUniformTriangle(uniform2D(draws)); }) });
+   // Camera rays of every pixel of a 64 x 64 image, through the kernel compiled for every feature and the one
+   // specialized for a static scene seen through a pinhole, then by viewport coordinates as before the generator
+   // stepped over pixels, and for the other projections.
+   const Point3 lookFrom(13.0, 2.0, 3.0);
+   const Point3 lookAt(0.0, 0.0, 0.0);
+   const Vec3 up(0.0, 1.0, 0.0);
+   const Camera camera(lookFrom, lookAt, up, 20.0, 1.0, 0.0, 10.0);
+   auto cameraRays = [](const Camera& camera, auto generate)
+   {
+      return [camera, generate](Vec3& sum)
+      {
+         constexpr int ImageSize = 64;
+         const CameraRayGenerator generator(camera, ImageSize, ImageSize);
+         Sampler sampler(SamplerType::Sobol, 1, KernelBenchConstants::Seed);
+         for (size_t idx = 0; idx < KernelBenchConstants::SamplesPerBatch; ++idx)
+         {
+            const int dx = static_cast<int>(idx % ImageSize);
+            const int dy = static_cast<int>(idx / ImageSize % ImageSize);
+            sampler.StartPixelSample(dx, dy, 0);
+            const Ray ray = generate(camera, generator, dx, dy, ImageSize, sampler);
+            sum += ray.Origin + ray.Direction;
+         }
+
+         return KernelBenchConstants::SamplesPerBatch;
+      };
+   };
+
+   auto generic = [](const Camera&, const CameraRayGenerator& generator, int dx, int dy, int, Sampler& sampler)
+   {
+      return generator.Generate(dx, dy, sampler);
+   };
+   auto pinhole = [](const Camera&, const CameraRayGenerator& generator, int dx, int dy, int, Sampler& sampler)
+   {
+      return generator.Generate<0>(dx, dy, sampler);
+   };
+   kernels.push_back({ "CameraRay", "Generic", cameraRays(camera, generic) });
+   kernels.push_back({ "CameraRay", "Pinhole", cameraRays(camera, pinhole) });
+   kernels.push_back({ "CameraRay", "Viewport", cameraRays(camera, [](const Camera& camera, const CameraRayGenerator&, int dx, int dy, int size,
+      Sampler& sampler)
+      {
+         const Point2 jitter = sampler.Get2D();
+         return camera.GetRay<0>((dx + jitter.x) / (size - 1), (dy + jitter.y) / (size - 1), sampler);
+      }) });
+   kernels.push_back({ "CameraRay", "Orthographic", cameraRays(Camera(lookFrom, lookAt, up, 20.0, 1.0, 0.0, 10.0, 0.0, 0.0,
+      CameraProjection::Orthographic), pinhole) });
+   kernels.push_back({ "CameraRay", "Equirectangular", cameraRays(Camera(lookFrom, lookAt, up, 20.0, 1.0, 0.0, 10.0, 0.0, 0.0,
+      CameraProjection::Equirectangular), pinhole) });
+   kernels.push_back({ "SphericalRect", "Analytic", repeat([uniform2D](size_t& draws)
+      {
+         double pdf = 0.0;
+         return SampleSphericalRectangle(Point3(0.2, 0.0, -0.3), Point3(-1.0, 2.0, -1.0), Vec3(2.0, 0.0, 0.0), Vec3(0.0, 0.0, 2.0),
+            uniform2D(draws), pdf);
+      }) });
+   return kernels;
+}
+
+// Camera rays of the edge pixels of an equirectangular image must stay within their own pixel's longitudes and
+// latitudes, so the first and last columns don't sample the same directions across the seam and the first and last
+// rows don't fold back over the poles.
+static bool CheckEquirectangularEdges()
+{
+   constexpr int Width = 64;
+   constexpr int Height = 32;
+   constexpr uint32_t Samples = 64;
+   const Camera camera(Point3(0.0, 0.0, 0.0), Point3(0.0, 0.0, -1.0), Vec3(0.0, 1.0, 0.0), 90.0, 2.0, 0.0, 1.0, 0.0, 0.0,
+      CameraProjection::Equirectangular);
+   const CameraRayGenerator generator(camera, Width, Height);
+   Sampler sampler(SamplerType::Sobol, Samples, KernelBenchConstants::Seed);
+   const int pixels[4][2] = { { 0, Height / 2 }, { Width - 1, Height / 2 }, { Width / 2, 0 }, { Width / 2, Height - 1 } };
+   for (const auto& pixel : pixels)
+   {
+      const double phiMin = -Pi + 2.0 * Pi * pixel[0] / Width;
+      const double thetaMin = -Pi / 2.0 + Pi * pixel[1] / Height;
+      for (uint32_t sampleIndex = 0; sampleIndex < Samples; ++sampleIndex)
+      {
+         sampler.StartPixelSample(pixel[0], pixel[1], sampleIndex);
+         const Vec3 direction = UnitVectorOf(generator.Generate<0>(pixel[0], pixel[1], sampler).Direction);
+         const double phi = std::atan2(direction.x, -direction.z);
+         const double theta = std::asin(std::clamp(direction.y, -1.0, 1.0));
+         constexpr double Epsilon = 1e-9;
+         const bool bInColumn = pixel[1] != Height / 2 ||
+            (phi >= phiMin - Epsilon && phi <= phiMin + 2.0 * Pi / Width + Epsilon);
+         const bool bInRow = theta >= thetaMin - Epsilon && theta <= thetaMin + Pi / Height + Epsilon;
+         if (!bInColumn || !bInRow)
+         {
+            std::cerr << "Equirectangular pixel (" << pixel[0] << ", " << pixel[1] << ") samples outside itself.\n";
+            return false;
+         }
+      }
+   }
+
+   return true;
+}
+
+// Every kind of material, looked up in one table as in a scene.
+static std::vector<ShadingKernel> CreateShadingKernels()
+{
+   auto materials = std::make_shared<MaterialTable>();
+   auto shade = [materials](uint32_t material)
+   {
+      return [materials, material](const std::vector<HitRecord>& hits, const std::vector<Ray>& rays, Vec3& sum)
+      {
+         Sampler sampler(SamplerType::Independent, 1, KernelBenchConstants::Seed);
+         size_t scattered = 0;
+         for (size_t idx = 0; idx < hits.size(); ++idx)
+         {
+            HitRecord rec = hits[idx];
+            rec.Material = material;
+            sampler.StartPixelSample(static_cast<int>(idx & 63), static_cast<int>(idx >> 6), 0);
+            sum += materials->Emitted(material, rec.u, rec.v, rec.p);
+            ScatterRecord srec;
+            sampler.StartBounce();
+            if (materials->Scatter(material, rays[idx], rec, sampler, srec))
+            {
+               sum += srec.Attenuation;
+               ++scattered;
+            }
+         }
+
+         return scattered;
+      };
+   };
+
+   const uint32_t checker = materials->AddCheckerTexture(Color(0.2, 0.3, 0.1), Color(0.9, 0.9, 0.9));
+   std::vector<ShadingKernel> kernels;
+   kernels.push_back({ "Lambertian", "Switch", shade(materials->AddLambertian(Color(0.5, 0.5, 0.5))) });
+   kernels.push_back({ "LambertianChecker", "Switch", shade(materials->AddLambertian(checker)) });
+   kernels.push_back({ "Metal", "Switch", shade(materials->AddMetal(Color(0.8, 0.8, 0.9), 0.3)) });
+   kernels.push_back({ "Dielectric", "Switch", shade(materials->AddDielectric(1.5)) });
+   kernels.push_back({ "DiffuseLight", "Switch", shade(materials->AddDiffuseLight(Color(4.0, 4.0, 4.0))) });
+   kernels.push_back({ "Isotropic", "Switch", shade(materials->AddIsotropic(Color(0.2, 0.4, 0.9))) });
+   return kernels;
+}
+
+// Best of several trials; each trial repeats the run until it takes long enough for the clock to be accurate.
+template<typename Run>
+static double MeasureBestSeconds(const Run& run)
+{
+   size_t repetitions = 1;
+   double bestSeconds = Infinity;
+   for (int trial = 0; trial < KernelBenchConstants::Trials; ++trial)
+   {
+      while (true)
+      {
+         const auto begin = RenderProfiler::Clock::now();
+         for (size_t repetition = 0; repetition < repetitions; ++repetition)
+         {
+            run();
+         }
+
+         const double seconds = RenderProfiler::SecondsBetween(begin, RenderProfiler::Clock::now());
+         if (seconds >= KernelBenchConstants::MinimumTrialSeconds)
+         {
+            bestSeconds = std::min(bestSeconds, seconds / repetitions);
+            break;
+         }
+
+         repetitions *= 2;
+      }
+   }
+
+   return bestSeconds;
+}
+
+static KernelResult Measure(const KernelVariant& kernel, BatchKind kind)
+{
+   const RayBatch batch = GenerateBatch(kernel.Bounds, kind);
+   const size_t hits = kernel.Run(batch);
+
+   volatile size_t sink = 0;
+   const double bestSeconds = MeasureBestSeconds([&]() { sink = sink + kernel.Run(batch); });
+
+   KernelResult result;
+   result.Kernel = kernel.Kernel;
+   result.Variant = kernel.Variant;
+   result.Batch = KernelBenchConstants::BatchNames[static_cast<size_t>(kind)];
+   result.NanosecondsPerTest = bestSeconds * 1e9 / batch.Rays.size();
+   result.HitRate = static_cast<double>(hits) / batch.Rays.size();
+   return result;
+}
+
+// Hit rate of a sampling kernel is the fraction of drawn tuples that became samples, one for the warps.
+static KernelResult Measure(const SamplingKernel& kernel)
+{
+   SeedRandom(KernelBenchConstants::Seed);
+   Vec3 sum;
+   const size_t draws = kernel.Run(sum);
+
+   volatile double sink = 0.0;
+   const double bestSeconds = MeasureBestSeconds([&]()
+      {
+         Vec3 repetitionSum;
+         kernel.Run(repetitionSum);
+         sink = sink + repetitionSum.x;
+      });
+
+   KernelResult result;
+   result.Kernel = kernel.Kernel;
+   result.Variant = kernel.Variant;
+   result.Batch = KernelBenchConstants::SamplingBatchName;
+   result.NanosecondsPerTest = bestSeconds * 1e9 / KernelBenchConstants::SamplesPerBatch;
+   result.HitRate = static_cast<double>(KernelBenchConstants::SamplesPerBatch) / draws;
+   return result;
+}
+
+// Hits are those of the incoherent hit batch on a unit sphere, so shading sees the spread of normals and incident
+// directions of diffuse bounces. Hit rate is the fraction of hits that scattered.
+static KernelResult Measure(const ShadingKernel& kernel)
+{
+   const RayBatch batch = GenerateBatch(AABB(Point3(-1.0, -1.0, -1.0), Point3(1.0, 1.0, 1.0)), BatchKind::IncoherentHit);
+   std::vector<HitRecord> hits;
+   std::vector<Ray> rays;
+   for (const auto& ray : batch.Rays)
+   {
+      HitRecord rec;
+      if (Sphere::Intersect(Point3(0.0, 0.0, 0.0), 1.0, 0, ray, 0.001, Infinity, rec))
+      {
+         hits.push_back(rec);
+         rays.push_back(ray);
+      }
+   }
+
+   Vec3 sum;
+   const size_t scattered = kernel.Run(hits, rays, sum);
+
+   volatile double sink = 0.0;
+   const double bestSeconds = MeasureBestSeconds([&]()
+      {
+         Vec3 repetitionSum;
+         kernel.Run(hits, rays, repetitionSum);
+         sink = sink + repetitionSum.x;
+      });
+
+   KernelResult result;
+   result.Kernel = kernel.Kernel;
+   result.Variant = kernel.Variant;
+   result.Batch = KernelBenchConstants::BatchNames[static_cast<size_t>(BatchKind::IncoherentHit)];
+   result.NanosecondsPerTest = bestSeconds * 1e9 / hits.size();
+   result.HitRate = static_cast<double>(scattered) / hits.size();
+   return result;
+}
+
+// Keeps the core busy for a while, so that the first kernel isn't measured at idle clock speed.
+static void Warmup(const KernelVariant& kernel)
+{
+   const RayBatch batch = GenerateBatch(kernel.Bounds, BatchKind::IncoherentHit);
+   const auto begin = RenderProfiler::Clock::now();
+   volatile size_t sink = 0;
+   while (RenderProfiler::SecondsBetween(begin, RenderProfiler::Clock::now()) < KernelBenchConstants::WarmupSeconds)
+   {
+      sink = sink + kernel.Run(batch);
+   }
+}
+
+static std::string RecordKey(const std::string& kernel, const std::string& variant, const std::string& batch)
+{
+   return kernel + '/' + variant + '/' + batch;
+}
+
+static bool WriteJson(const std::string& path, const std::vector<KernelResult>& results)
+{
+   std::ofstream stream(path);
+   if (!stream)
+   {
+      std::cerr << "Failed to write kernel benchmark report '" << path << "'.\n";
+      return false;
+   }
+
+   stream << std::setprecision(6);
+   stream << "{\n";
+   stream << "  \"version\": " << KernelBenchConstants::JsonVersion << ",\n";
+   stream << "  \"raysPerBatch\": " << KernelBenchConstants::RaysPerBatch << ",\n";
+   stream << "  \"results\": [";
+   for (size_t idx = 0; idx < results.size(); ++idx)
+   {
+      const auto& result = results[idx];
+      // One record per line; ReadBaseline relies on it.
+      stream << (idx == 0 ? "\n" : ",\n")
+         << "    { \"kernel\": \"" << result.Kernel << '"'
+         << ", \"variant\": \"" << result.Variant << '"'
+         << ", \"batch\": \"" << result.Batch << '"'
+         << ", \"nsPerTest\": " << result.NanosecondsPerTest
+         << ", \"hitRate\": " << result.HitRate << " }";
+   }
+   stream << (results.empty() ? "]\n" : "\n  ]\n");
+   stream << "}\n";
+   return static_cast<bool>(stream);
+}
+
+// Reads reports written by WriteJson. Returns ns/test keyed by RecordKey.
+static std::map<std::string, double> ReadBaseline(const std::string& path)
+{
+   std::map<std::string, double> baseline;
+   std::ifstream stream(path);
+   if (!stream)
+   {
+      std::cerr << "Failed to read kernel benchmark baseline '" << path << "'.\n";
+      return baseline;
+   }
+
+   auto field = [](const std::string& line, const std::string& name) -> std::string
+   {
+      const std::string key = '"' + name + "\": ";
+      auto begin = line.find(key);
+      if (begin == std::string::npos)
+      {
+         return {};
+      }
+
+      begin += key.size();
+      if (line[begin] == '"')
+      {
+         ++begin;
+         return line.substr(begin, line.find('"', begin) - begin);
+      }
+
+      return line.substr(begin, line.find_first_of(",}", begin) - begin);
+   };
+
+   std::string line;
+   while (std::getline(stream, line))
+   {
+      const std::string kernel = field(line, "kernel");
+      const std::string nanoseconds = field(line, "nsPerTest");
+      if (!kernel.empty() && !nanoseconds.empty())
+      {
+         baseline[RecordKey(kernel, field(line, "variant"), field(line, "batch"))] = std::atof(nanoseconds.c_str());
+      }
+   }
+
+   return baseline;
+}
+
+int main(int argc, char** argv)
+{
+   std::string outputPath = "kernelbench.json";
+   std::string baselinePath;
+   std::string filter;
+   double tolerance = KernelBenchConstants::DefaultTolerance;
+   for (int idx = 1; idx < argc; ++idx)
+   {
+      const std::string_view arg = argv[idx];
+      const bool bHasValue = idx + 1 < argc;
+      if (arg == "--output" && bHasValue)
+      {
+         outputPath = argv[++idx];
+      }
+      else if (arg == "--baseline" && bHasValue)
+      {
+         baselinePath = argv[++idx];
+      }
+      else if (arg == "--tolerance" && bHasValue)
+      {
+         tolerance = std::atof(argv[++idx]);
+      }
+      else if (arg == "--filter" && bHasValue)
+      {
+         filter = argv[++idx];
+      }
+      else
+      {
+         std::cerr << "Unknown or incomplete argument '" << arg << "'.\n";
+         return 2;
+      }
+   }
+
+   if (!CheckEquirectangularEdges())
+   {
+      return 1;
+   }
+
+   const auto baseline = baselinePath.empty() ? std::map<std::string, double>() : ReadBaseline(baselinePath);
+
+   std::cout << std::left << std::setw(18) << "Kernel"
+      << std::setw(18) << "Variant"
+      << std::setw(16) << "Batch"
+      << std::right << std::setw(10) << "ns/test"
+      << std::setw(10) << "Hit rate";
+   if (!baseline.empty())
+   {
+      std::cout << std::setw(10) << "Change";
+   }
+   std::cout << '\n';
+
+   const auto kernels = CreateKernels();
+   Warmup(kernels.front());
+
+   size_t regressions = 0;
+   std::vector<KernelResult> results;
+   auto report = [&](const KernelResult& result)
+   {
+      std::cout << std::left << std::setw(18) << result.Kernel
+         << std::setw(18) << result.Variant
+         << std::setw(16) << result.Batch
+         << std::right << std::fixed << std::setprecision(2)
+         << std::setw(10) << result.NanosecondsPerTest
+         << std::setw(10) << result.HitRate;
+
+      auto previous = baseline.find(RecordKey(result.Kernel, result.Variant, result.Batch));
+      if (previous != baseline.end() && previous->second > 0.0)
+      {
+         const double change = result.NanosecondsPerTest / previous->second - 1.0;
+         std::cout << std::setw(9) << std::showpos << change * 100.0 << std::noshowpos << '%';
+         if (change > tolerance)
+         {
+            std::cout << "  REGRESSION";
+            ++regressions;
+         }
+      }
+      std::cout << std::defaultfloat << std::endl;
+
+      results.push_back(result);
+   };
+
+   for (const auto& kernel : kernels)
+   {
+      if (!filter.empty() && kernel.Kernel != filter)
+      {
+         continue;
+      }
+
+      for (size_t kind = 0; kind < KernelBenchConstants::BatchKindCount; ++kind)
+      {
+         report(Measure(kernel, static_cast<BatchKind>(kind)));
+      }
+   }
+
+   for (const auto& kernel : CreateSamplingKernels())
+   {
+      if (filter.empty() || kernel.Kernel == filter)
+      {
+         report(Measure(kernel));
+      }
+   }
+
+   for (const auto& kernel : CreateShadingKernels())
+   {
+      if (filter.empty() || kernel.Kernel == filter)
+      {
+         report(Measure(kernel));
+      }
+   }
+
+   WriteJson(outputPath, results);
+   if (regressions > 0)
+   {
+      std::cerr << regressions << " kernel(s) slower than baseline by more than " << tolerance * 100.0 << "%.\n";
+      return 1;
+   }
+
+   return 0;
+}
@@ -0,0 +1,606 @@
+#include <Core/CoreMinimal.h>
+#include <Core/Renderer.h>
+#include <Core/BVHCache.h>
+#include <Core/CommandLine.h>
+#include <Core/Profiler.h>
+#include <Core/Tonemap.h>
+#include <Scenes/Scenes.h>
+#include <cmath>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <numeric>
+#include <string>
+
+// Renders every registered scene with fixed settings and compares the result against a stored reference.
+//
+// raytracer_bench [--scene <name>] [--sampler <name>] [--integrator <name>] [--packet-size <rays>] [--reorder-rays]
+//                 [--generic-kernels] [--output <json>] [--reference-dir <dir>] [--max-rmse <value>] [--write-references]
+//                 [--primary-rays] [--secondary-rays]
+//
+// --write-references renders the converged references instead (slow); --max-rmse makes the process fail when any
+// scene drifts further from its reference, which is what regression gates use. --primary-rays also times closest
+// hits of the camera rays alone, one by one against packets of every size. --secondary-rays times closest hits of the
+// first bounce rays in the order they were scattered against reordered by RayReorderer, sorting included; the memory
+// bound InstancedClusters scene, whose BVH is far larger than L2, is the one to look at. --generic-kernels renders
+// with the kernels compiled for every feature, the baseline of the ones specialized for each scene.
+namespace BenchConstants
+{
+   constexpr int ImageWidth = 128;
+   constexpr int ImageHeight = 128;
+   constexpr int SamplesPerPixel = 16;
+   constexpr int ReferenceSamplesPerPixel = 1024;
+   constexpr int MaximumDepth = 50;
+   constexpr uint64_t SceneSeed = 1;
+   constexpr uint64_t RenderSeed = 1;
+   constexpr double ShutterOpen = 0.0;
+   constexpr double ShutterClose = 1.0; // Of animated scenes; static ones close the shutter at once
+   constexpr int Channels = 3;
+   constexpr int PrimaryRayRepetitions = 3; // Best of, against timer noise
+   constexpr size_t PrimaryRayModes = 1 + std::size(RayPacketConstants::Sizes); // Single rays, then every packet size
+   constexpr int SecondaryRayRepetitions = 3;
+}
+
+struct BenchOptions
+{
+public:
+   std::string SceneName;
+   SamplerType Sampler = SamplerType::Sobol;
+   IntegratorType Integrator = IntegratorType::Megakernel;
+   int PacketSize = 0;
+   bool bReorderRays = false;
+   bool bGenericKernels = false;
+   std::string OutputPath = "bench.json";
+   std::filesystem::path ReferenceDirectory = "Resources/References";
+   double MaximumRMSE = -1.0;
+   bool bWriteReferences = false;
+   bool bPrimaryRays = false;
+   bool bSecondaryRays = false;
+
+};
+
+struct PrimaryRayResult
+{
+public:
+   size_t Rays = 0;
+   double MegaRaysPerSecond[BenchConstants::PrimaryRayModes] = {};
+   size_t Mismatches = 0; // Rays whose hit in a packet differs from the hit traced alone
+
+};
+
+struct SecondaryRayResult
+{
+public:
+   size_t Rays = 0;
+   double InOrderMegaRaysPerSecond = 0.0;
+   double ReorderedMegaRaysPerSecond = 0.0; // Including the time to sort
+
+};
+
+struct BenchResult
+{
+public:
+   std::string_view Name;
+   double BuildSeconds = 0.0;
+   double RenderSeconds = 0.0;
+   RayCounters Counters;
+   double RMSE = -1.0; // Negative when there is no reference to compare against
+   PrimaryRayResult PrimaryRays; // Zero rays unless measured
+   SecondaryRayResult SecondaryRays; // Zero rays unless measured
+
+};
+
+static bool ParseOptions(int argc, char** argv, BenchOptions& options)
+{
+   for (int idx = 1; idx < argc; ++idx)
+   {
+      const std::string_view arg = argv[idx];
+      const bool bHasValue = idx + 1 < argc;
+      if (arg == "--scene" && bHasValue)
+      {
+         options.SceneName = argv[++idx];
+      }
+      else if (arg == "--sampler" && bHasValue)
+      {
+         const std::string_view name = argv[++idx];
+         const auto found = std::find(std::begin(SamplerConstants::SamplerNames), std::end(SamplerConstants::SamplerNames), name);
+         if (found == std::end(SamplerConstants::SamplerNames))
+         {
+            std::cerr << "Unknown sampler '" << name << "'.\n";
+            return false;
+         }
+
+         options.Sampler = static_cast<SamplerType>(found - std::begin(SamplerConstants::SamplerNames));
+      }
+      else if (arg == "--integrator" && bHasValue)
+      {
+         const std::string_view name = argv[++idx];
+         const auto found = std::find(std::begin(IntegratorConstants::IntegratorNames), std::end(IntegratorConstants::IntegratorNames), name);
+         if (found == std::end(IntegratorConstants::IntegratorNames))
+         {
+            std::cerr << "Unknown integrator '" << name << "'.\n";
+            return false;
+         }
+
+         options.Integrator = static_cast<IntegratorType>(found - std::begin(IntegratorConstants::IntegratorNames));
+      }
+      else if (arg == "--packet-size" && bHasValue)
+      {
+         const std::string_view value = argv[++idx];
+         if (!ParsePacketSize(value, options.PacketSize))
+         {
+            std::cerr << "Invalid value '" << value << "' of '" << arg << "'.\n";
+            return false;
+         }
+      }
+      else if (arg == "--reorder-rays")
+      {
+         options.bReorderRays = true;
+      }
+      else if (arg == "--generic-kernels")
+      {
+         options.bGenericKernels = true;
+      }
+      else if (arg == "--primary-rays")
+      {
+         options.bPrimaryRays = true;
+      }
+      else if (arg == "--secondary-rays")
+      {
+         options.bSecondaryRays = true;
+      }
+      else if (arg == "--output" && bHasValue)
+      {
+         options.OutputPath = argv[++idx];
+      }
+      else if (arg == "--reference-dir" && bHasValue)
+      {
+         options.ReferenceDirectory = argv[++idx];
+      }
+      else if (arg == "--max-rmse" && bHasValue)
+      {
+         const std::string_view value = argv[++idx];
+         if (!ParseNumber(value, 0.0, options.MaximumRMSE))
+         {
+            std::cerr << "Invalid value '" << value << "' of '" << arg << "'.\n";
+            return false;
+         }
+      }
+      else if (arg == "--write-references")
+      {
+         options.bWriteReferences = true;
+      }
+      else
+      {
+         std::cerr << "Unknown or incomplete argument '" << arg << "'.\n";
+         return false;
+      }
+   }
+
+   return ValidateIntegratorOptions(options.Integrator, options.PacketSize, options.bReorderRays);
+}
+
+// Root mean square error of 8-bit images, normalized to [0, 1]. Returns negative value if the reference can't be used.
+static double ComputeRMSE(const unsigned char* image, const std::filesystem::path& referencePath)
+{
+   int width = 0;
+   int height = 0;
+   int components = 0;
+   unsigned char* reference = stbi_load(referencePath.string().c_str(), &width, &height, &components, BenchConstants::Channels);
+   if (reference == nullptr)
+   {
+      std::cerr << "Missing reference image '" << referencePath.string() << "'.\n";
+      return -1.0;
+   }
+
+   double rmse = -1.0;
+   if (width == BenchConstants::ImageWidth && height == BenchConstants::ImageHeight)
+   {
+      const size_t count = static_cast<size_t>(width) * height * BenchConstants::Channels;
+      double sumOfSquares = 0.0;
+      for (size_t idx = 0; idx < count; ++idx)
+      {
+         const double difference = (static_cast<double>(image[idx]) - reference[idx]) / 255.0;
+         sumOfSquares += difference * difference;
+      }
+
+      rmse = std::sqrt(sumOfSquares / count);
+   }
+   else
+   {
+      std::cerr << "Reference image '" << referencePath.string() << "' has wrong resolution.\n";
+   }
+
+   stbi_image_free(reference);
+   return rmse;
+}
+
+// Closest hits of the camera rays of the benchmark image, in the order the wavefront integrator traces them, timed
+// on one thread one by one and in packets of every size.
+static std::vector<Ray> GenerateCameraRays(const Camera& camera, Sampler& sampler)
+{
+   const CameraRayGenerator cameraRays(camera, BenchConstants::ImageWidth, BenchConstants::ImageHeight);
+   std::vector<Ray> rays;
+   for (int row = 0; row < BenchConstants::ImageHeight; ++row)
+   {
+      for (int dx = 0; dx < BenchConstants::ImageWidth; ++dx)
+      {
+         for (int ds = 0; ds < BenchConstants::SamplesPerPixel; ++ds)
+         {
+            sampler.StartPixelSample(dx, row, ds);
+            rays.push_back(cameraRays.Generate(dx, BenchConstants::ImageHeight - row - 1, sampler));
+         }
+      }
+   }
+
+   return rays;
+}
+
+static PrimaryRayResult MeasurePrimaryRays(const Camera& camera, const Hittable& world, SamplerType samplerType)
+{
+   Sampler sampler(samplerType, BenchConstants::SamplesPerPixel, BenchConstants::RenderSeed);
+   const std::vector<Ray> rays = GenerateCameraRays(camera, sampler);
+
+   PrimaryRayResult result;
+   result.Rays = rays.size();
+   std::vector<HitRecord> singleRecs(rays.size());
+   std::vector<uint8_t> singleHits(rays.size());
+   std::vector<HitRecord> packetRecs(rays.size());
+   std::vector<uint8_t> packetHits(rays.size());
+   RayPacket packet;
+   for (size_t mode = 0; mode < BenchConstants::PrimaryRayModes; ++mode)
+   {
+      double bestSeconds = Infinity;
+      for (int repetition = 0; repetition < BenchConstants::PrimaryRayRepetitions; ++repetition)
+      {
+         const auto begin = RenderProfiler::Clock::now();
+         if (mode == 0)
+         {
+            for (size_t idx = 0; idx < rays.size(); ++idx)
+            {
+               singleHits[idx] = world.Hit(rays[idx], 0.001, Infinity, singleRecs[idx]) ? 1 : 0;
+            }
+         }
+         else
+         {
+            const size_t packetSize = RayPacketConstants::Sizes[mode - 1];
+            for (size_t first = 0; first < rays.size(); first += packetSize)
+            {
+               const size_t count = std::min(packetSize, rays.size() - first);
+               packet.Set(&rays[first], count);
+               const uint32_t hits = world.HitPacket(packet, 0.001, &packetRecs[first]);
+               for (size_t lane = 0; lane < count; ++lane)
+               {
+                  packetHits[first + lane] = (hits >> lane) & 1;
+               }
+            }
+         }
+
+         bestSeconds = std::min(bestSeconds, RenderProfiler::SecondsBetween(begin, RenderProfiler::Clock::now()));
+      }
+
+      result.MegaRaysPerSecond[mode] = bestSeconds > 0.0 ? rays.size() / bestSeconds / 1e6 : 0.0;
+      for (size_t idx = 0; mode > 0 && idx < rays.size(); ++idx)
+      {
+         if (packetHits[idx] != singleHits[idx] || (singleHits[idx] && (packetRecs[idx].t != singleRecs[idx].t || packetRecs[idx].Material != singleRecs[idx].Material)))
+         {
+            ++result.Mismatches;
+         }
+      }
+   }
+
+   return result;
+}
+
+// Closest hits of the rays scattered where camera rays of the benchmark image hit, timed on one thread as they come,
+// by pixel, and reordered in batches of the wavefront integrator.
+static SecondaryRayResult MeasureSecondaryRays(const Camera& camera, const Hittable& world, const MaterialTable& materials,
+   SamplerType samplerType)
+{
+   Sampler sampler(samplerType, BenchConstants::SamplesPerPixel, BenchConstants::RenderSeed);
+   std::vector<Ray> rays;
+   for (const Ray& cameraRay : GenerateCameraRays(camera, sampler))
+   {
+      HitRecord rec;
+      if (world.Hit(cameraRay, 0.001, Infinity, rec))
+      {
+         ScatterRecord srec;
+         sampler.StartBounce();
+         if (materials.Scatter(rec.Material, cameraRay, rec, sampler, srec))
+         {
+            rays.push_back(srec.Scattered);
+         }
+      }
+   }
+
+   SecondaryRayResult result;
+   result.Rays = rays.size();
+   RayReorderer reorderer;
+   std::vector<uint32_t> order;
+   for (const bool bReordered : { false, true })
+   {
+      double bestSeconds = Infinity;
+      for (int repetition = 0; repetition < BenchConstants::SecondaryRayRepetitions; ++repetition)
+      {
+         const auto begin = RenderProfiler::Clock::now();
+         for (size_t batchBegin = 0; batchBegin < rays.size(); batchBegin += WavefrontConstants::BatchSize)
+         {
+            const size_t batchEnd = std::min(rays.size(), batchBegin + WavefrontConstants::BatchSize);
+            order.resize(batchEnd - batchBegin);
+            std::iota(order.begin(), order.end(), static_cast<uint32_t>(batchBegin));
+            if (bReordered)
+            {
+               reorderer.Sort(order, [&rays](uint32_t idx) { return rays[idx]; });
+            }
+
+            for (uint32_t idx : order)
+            {
+               HitRecord rec;
+               world.Hit(rays[idx], 0.001, Infinity, rec);
+            }
+         }
+
+         bestSeconds = std::min(bestSeconds, RenderProfiler::SecondsBetween(begin, RenderProfiler::Clock::now()));
+      }
+
+      const double megaRaysPerSecond = bestSeconds > 0.0 ? rays.size() / bestSeconds / 1e6 : 0.0;
+      (bReordered ? result.ReorderedMegaRaysPerSecond : result.InOrderMegaRaysPerSecond) = megaRaysPerSecond;
+   }
+
+   return result;
+}
+
+static BenchResult RunScene(const SceneDescription& scene, const BenchOptions& options)
+{
+   auto& profiler = RenderProfiler::Instance();
+   profiler.Reset();
+
+   BenchResult result;
+   result.Name = scene.Name;
+
+   const auto buildBegin = RenderProfiler::Clock::now();
+   SeedRandom(BenchConstants::SceneSeed);
+   MaterialTable materials;
+   const double shutterClose = scene.bAnimated ? BenchConstants::ShutterClose : BenchConstants::ShutterOpen;
+   auto world = scene.Build(materials, BenchConstants::ShutterOpen, shutterClose);
+   auto worldBVH = BVHCache::Instance().GetOrBuild(*world, BenchConstants::ShutterOpen, shutterClose);
+   result.BuildSeconds = RenderProfiler::SecondsBetween(buildBegin, RenderProfiler::Clock::now());
+
+   RenderSettings settings;
+   settings.ImageWidth = BenchConstants::ImageWidth;
+   settings.ImageHeight = BenchConstants::ImageHeight;
+   settings.SamplesPerPixel = options.bWriteReferences ? BenchConstants::ReferenceSamplesPerPixel : BenchConstants::SamplesPerPixel;
+   settings.MaximumDepth = BenchConstants::MaximumDepth;
+   settings.Seed = BenchConstants::RenderSeed;
+   settings.Sampler = options.Sampler;
+   settings.Integrator = options.Integrator;
+   settings.PacketSize = options.PacketSize;
+   settings.bReorderRays = options.bReorderRays;
+   settings.bSpecializeKernels = !options.bGenericKernels;
+   settings.bReportProgress = false;
+
+   constexpr double aspectRatio = static_cast<double>(BenchConstants::ImageWidth) / BenchConstants::ImageHeight;
+   const Camera camera = FindCameraPreset(scene.DefaultCamera)->Create(aspectRatio, BenchConstants::ShutterOpen, shutterClose);
+   Renderer renderer(settings);
+   const Framebuffer framebuffer = renderer.Render(camera, *worldBVH, materials, scene.Background);
+   result.RenderSeconds = profiler.GetPhaseSeconds(RenderPhase::Render);
+   result.Counters = profiler.GetTotalCounters();
+   if (options.bPrimaryRays)
+   {
+      result.PrimaryRays = MeasurePrimaryRays(camera, *worldBVH, options.Sampler);
+   }
+
+   if (options.bSecondaryRays)
+   {
+      result.SecondaryRays = MeasureSecondaryRays(camera, *worldBVH, materials, options.Sampler);
+   }
+
+   const auto image = Tonemap(framebuffer.Resolve(), TonemapSettings());
+   const auto referencePath = options.ReferenceDirectory / (std::string(scene.Name) + ".png");
+   if (options.bWriteReferences)
+   {
+      std::error_code error;
+      std::filesystem::create_directories(options.ReferenceDirectory, error);
+      if (!stbi_write_png(referencePath.string().c_str(), settings.ImageWidth, settings.ImageHeight, BenchConstants::Channels,
+         image.get(), settings.ImageWidth * BenchConstants::Channels))
+      {
+         std::cerr << "Failed to write reference image '" << referencePath.string() << "'.\n";
+      }
+   }
+   else
+   {
+      result.RMSE = ComputeRMSE(image.get(), referencePath);
+   }
+
+   return result;
+}
+
+static double MegaRaysPerSecond(const BenchResult& result)
+{
+   return result.RenderSeconds > 0.0 ? result.Counters.Rays / result.RenderSeconds / 1e6 : 0.0;
+}
+
+static bool WriteJson(const std::string& path, const std::vector<BenchResult>& results, int samplesPerPixel, SamplerType sampler,
+   IntegratorType integrator, int packetSize, bool bReorderRays, bool bGenericKernels)
+{
+   std::ofstream stream(path);
+   if (!stream)
+   {
+      std::cerr << "Failed to write benchmark report '" << path << "'.\n";
+      return false;
+   }
+
+   stream << std::setprecision(9);
+   stream << "{\n";
+   stream << "  \"imageWidth\": " << BenchConstants::ImageWidth << ",\n";
+   stream << "  \"imageHeight\": " << BenchConstants::ImageHeight << ",\n";
+   stream << "  \"samplesPerPixel\": " << samplesPerPixel << ",\n";
+   stream << "  \"maximumDepth\": " << BenchConstants::MaximumDepth << ",\n";
+   stream << "  \"seed\": " << BenchConstants::RenderSeed << ",\n";
+   stream << "  \"sampler\": \"" << SamplerConstants::SamplerNames[static_cast<size_t>(sampler)] << "\",\n";
+   stream << "  \"integrator\": \"" << IntegratorConstants::IntegratorNames[static_cast<size_t>(integrator)] << "\",\n";
+   stream << "  \"packetSize\": " << packetSize << ",\n";
+   stream << "  \"reorderRays\": " << (bReorderRays ? "true" : "false") << ",\n";
+   stream << "  \"genericKernels\": " << (bGenericKernels ? "true" : "false") << ",\n";
+   stream << "  \"scenes\": [";
+   for (size_t idx = 0; idx < results.size(); ++idx)
+   {
+      const auto& result = results[idx];
+      stream << (idx == 0 ? "\n" : ",\n") << "    { \"name\": \"" << result.Name << '"'
+         << ", \"buildSeconds\": " << result.BuildSeconds
+         << ", \"renderSeconds\": " << result.RenderSeconds
+         << ", \"rays\": " << result.Counters.Rays
+         << ", \"samples\": " << result.Counters.Samples
+         << ", \"mraysPerSecond\": " << MegaRaysPerSecond(result)
+         << ", \"rmse\": ";
+      if (result.RMSE >= 0.0)
+      {
+         stream << result.RMSE;
+      }
+      else
+      {
+         stream << "null";
+      }
+      if (result.PrimaryRays.Rays > 0)
+      {
+         stream << ", \"primaryRays\": { \"rays\": " << result.PrimaryRays.Rays
+            << ", \"singleMraysPerSecond\": " << result.PrimaryRays.MegaRaysPerSecond[0];
+         for (size_t mode = 1; mode < BenchConstants::PrimaryRayModes; ++mode)
+         {
+            stream << ", \"packet" << RayPacketConstants::Sizes[mode - 1] << "MraysPerSecond\": " << result.PrimaryRays.MegaRaysPerSecond[mode];
+         }
+         stream << ", \"mismatches\": " << result.PrimaryRays.Mismatches << " }";
+      }
+      if (result.SecondaryRays.Rays > 0)
+      {
+         stream << ", \"secondaryRays\": { \"rays\": " << result.SecondaryRays.Rays
+            << ", \"inOrderMraysPerSecond\": " << result.SecondaryRays.InOrderMegaRaysPerSecond
+            << ", \"reorderedMraysPerSecond\": " << result.SecondaryRays.ReorderedMegaRaysPerSecond << " }";
+      }
+      stream << " }";
+   }
+   stream << (results.empty() ? "]\n" : "\n  ]\n");
+   stream << "}\n";
+   return static_cast<bool>(stream);
+}
+
+int main(int argc, char** argv)
+{
+   BenchOptions options;
+   if (!ParseOptions(argc, argv, options))
+   {
+      return 2;
+   }
+
+   // Build times should measure the builder, not whatever a previous run left in the cache.
+   BVHCache::Instance().SetEnabled(false);
+
+   std::vector<const SceneDescription*> scenes;
+   for (const auto& scene : GetScenes())
+   {
+      if (options.SceneName.empty() || scene.Name == options.SceneName)
+      {
+         scenes.push_back(&scene);
+      }
+   }
+
+   if (scenes.empty())
+   {
+      std::cerr << "Unknown scene '" << options.SceneName << "'.\n";
+      return 2;
+   }
+
+   std::cout << std::left << std::setw(26) << "Scene"
+      << std::right << std::setw(12) << "Build (s)"
+      << std::setw(12) << "Render (s)"
+      << std::setw(14) << "Rays"
+      << std::setw(10) << "Mrays/s"
+      << std::setw(10) << "RMSE" << '\n';
+
+   bool bPassed = true;
+   std::vector<BenchResult> results;
+   for (const auto* scene : scenes)
+   {
+      const auto result = RunScene(*scene, options);
+      std::cout << std::left << std::setw(26) << result.Name
+         << std::right << std::fixed << std::setprecision(3)
+         << std::setw(12) << result.BuildSeconds
+         << std::setw(12) << result.RenderSeconds
+         << std::setw(14) << result.Counters.Rays
+         << std::setw(10) << MegaRaysPerSecond(result);
+      if (result.RMSE >= 0.0)
+      {
+         std::cout << std::setw(10) << std::setprecision(5) << result.RMSE;
+      }
+      else
+      {
+         std::cout << std::setw(10) << "-";
+      }
+      std::cout << std::defaultfloat << std::endl;
+
+      if (options.MaximumRMSE >= 0.0 && !options.bWriteReferences && (result.RMSE < 0.0 || result.RMSE > options.MaximumRMSE))
+      {
+         bPassed = false;
+      }
+
+      results.push_back(result);
+   }
+
+   bool bPacketsAgree = true;
+   if (options.bPrimaryRays)
+   {
+      std::cout << "\nPrimary rays, Mrays/s on one thread\n" << std::left << std::setw(26) << "Scene" << std::right << std::setw(10) << "Single";
+      for (size_t packetSize : RayPacketConstants::Sizes)
+      {
+         std::cout << std::setw(10) << ("Packet" + std::to_string(packetSize));
+      }
+      std::cout << std::setw(12) << "Mismatches" << '\n';
+
+      for (const auto& result : results)
+      {
+         std::cout << std::left << std::setw(26) << result.Name << std::right << std::fixed << std::setprecision(3);
+         for (double megaRaysPerSecond : result.PrimaryRays.MegaRaysPerSecond)
+         {
+            std::cout << std::setw(10) << megaRaysPerSecond;
+         }
+         std::cout << std::setw(12) << result.PrimaryRays.Mismatches << std::defaultfloat << std::endl;
+
+         // Packets must find exactly the hits of single rays, or images would depend on the packet size.
+         if (result.PrimaryRays.Mismatches > 0)
+         {
+            std::cerr << "Packet traversal of " << result.Name << " disagrees with single rays.\n";
+            bPacketsAgree = false;
+         }
+      }
+   }
+
+   if (options.bSecondaryRays)
+   {
+      std::cout << "\nSecondary rays, Mrays/s on one thread\n" << std::left << std::setw(26) << "Scene"
+         << std::right << std::setw(12) << "Rays" << std::setw(10) << "In order" << std::setw(11) << "Reordered" << '\n';
+      for (const auto& result : results)
+      {
+         std::cout << std::left << std::setw(26) << result.Name << std::right << std::setw(12) << result.SecondaryRays.Rays
+            << std::fixed << std::setprecision(3) << std::setw(10) << result.SecondaryRays.InOrderMegaRaysPerSecond
+            << std::setw(11) << result.SecondaryRays.ReorderedMegaRaysPerSecond << std::defaultfloat << std::endl;
+      }
+   }
+
+   const int samplesPerPixel = options.bWriteReferences ? BenchConstants::ReferenceSamplesPerPixel : BenchConstants::SamplesPerPixel;
+   WriteJson(options.OutputPath, results, samplesPerPixel, options.Sampler, options.Integrator, options.PacketSize, options.bReorderRays,
+      options.bGenericKernels);
+   if (!bPassed)
+   {
+      std::cerr << "RMSE exceeded " << options.MaximumRMSE << " in at least one scene.\n";
+      return 1;
+   }
+
+   if (!bPacketsAgree)
+   {
+      return 1;
+   }
+
+   return 0;
+}
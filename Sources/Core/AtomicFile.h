@@ -0,0 +1,66 @@
+#pragma once
+#include <Core/CoreMinimal.h>
+#include <atomic>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <string_view>
+
+#ifdef _WIN32
+#include <process.h>
+#else
+#include <unistd.h>
+#endif
+
+// Number distinguishing the temporary files of WriteFileAtomically within one process.
+inline uint32_t NextTemporaryFileIndex()
+{
+   static std::atomic<uint32_t> count = 0;
+   return count++;
+}
+
+// Writes path through a temporary file that is renamed over it once complete, so that an interrupted write never
+// leaves a half-written file behind and readers, mapping it from other processes too, see either the old file or the
+// new one. Temporary names are unique to the process and the call, so concurrent writers of the same path never
+// truncate each other's files. write(stream) writes the contents; description names the kind of file in errors.
+template<typename Write>
+bool WriteFileAtomically(const std::filesystem::path& path, std::string_view description, const Write& write)
+{
+#ifdef _WIN32
+   const auto processId = static_cast<uint64_t>(_getpid());
+#else
+   const auto processId = static_cast<uint64_t>(getpid());
+#endif
+   auto tempPath = path;
+   tempPath += "." + std::to_string(processId) + "." + std::to_string(NextTemporaryFileIndex()) + ".tmp";
+
+   std::error_code error;
+   {
+      std::ofstream stream(tempPath, std::ios::binary | std::ios::trunc);
+      if (!stream)
+      {
+         std::cerr << "Failed to write " << description << " '" << tempPath.string() << "'.\n";
+         return false;
+      }
+
+      write(stream);
+      stream.flush();
+      if (!stream)
+      {
+         std::cerr << "Failed to write " << description << " '" << tempPath.string() << "'.\n";
+         stream.close();
+         std::filesystem::remove(tempPath, error);
+         return false;
+      }
+   }
+
+   std::filesystem::rename(tempPath, path, error);
+   if (error)
+   {
+      std::cerr << "Failed to write " << description << " '" << path.string() << "'.\n";
+      std::filesystem::remove(tempPath, error);
+      return false;
+   }
+
+   return true;
+}
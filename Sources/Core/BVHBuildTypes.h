@@ -0,0 +1,129 @@
+#pragma once
+#include <Core/Hittable.h>
+#include <cstdint>
+#include <type_traits>
+
+enum class BVHBuildMethod : uint32_t
+{
+   SAH = 0,
+   LBVH,        // 30-bit Morton codes
+   LBVH63,      // 63-bit Morton codes
+   TreeletLBVH, // 63-bit Morton codes followed by treelet restructuring
+   SBVH,        // SAH with spatial splits
+   Count
+};
+
+namespace BVHBuildMethodConstants
+{
+   constexpr size_t MethodCount = static_cast<size_t>(BVHBuildMethod::Count);
+   constexpr const char* MethodNames[MethodCount] = { "SAH", "LBVH", "LBVH63", "TreeletLBVH", "SBVH" };
+}
+
+// Node of a depth-first flattened BVH. Left child of interior node is always located right after its parent.
+struct FlatBVHNode
+{
+public:
+   bool IsLeaf() const { return PrimitiveCount > 0; }
+
+public:
+   AABB Bounds;
+   uint32_t Offset = 0; // Leaf: First index in primitive index array, Interior: Index of second child
+   uint16_t PrimitiveCount = 0;
+   uint8_t Axis = 0;
+   uint8_t Padding = 0;
+
+};
+
+static_assert(std::is_trivially_copyable_v<FlatBVHNode>, "FlatBVHNode must be serializable as raw bytes.");
+
+struct FlatBVHData
+{
+public:
+   std::vector<FlatBVHNode> Nodes;
+   std::vector<uint32_t> PrimitiveIndices;
+
+};
+
+struct BVHPrimitiveInfo
+{
+public:
+   BVHPrimitiveInfo() = default;
+   BVHPrimitiveInfo(uint32_t index, const AABB& bounds) :
+      Index(index),
+      Bounds(bounds),
+      Centroid(bounds.Centroid())
+   {
+   }
+
+public:
+   uint32_t Index = 0;
+   AABB Bounds;
+   Point3 Centroid;
+
+};
+
+namespace BVHBuildConstants
+{
+   constexpr size_t MaxPrimitivesInLeaf = 4;
+   constexpr size_t NumBuckets = 12;
+   constexpr double TraversalCost = 0.125;
+   constexpr size_t TraversalStackSize = 128;
+   constexpr size_t MaxDepth = TraversalStackSize - 1; // Traversal keeps one node on its stack for each interior ancestor
+}
+
+// Levels below a node of primitiveCount primitives when it and its descendants are split by count down to full leaves.
+// Builders switch to such splits where their own would take the tree deeper than BVHBuildConstants::MaxDepth.
+inline size_t CountSplitDepth(size_t primitiveCount)
+{
+   size_t depth = 0;
+   while (primitiveCount > BVHBuildConstants::MaxPrimitivesInLeaf)
+   {
+      primitiveCount = (primitiveCount + 1) / 2;
+      ++depth;
+   }
+
+   return depth;
+}
+
+// Checks a node array read from a file or built by a method without a depth limit: children must follow their parents,
+// leaves must index within primitiveIndexCount and no leaf may be deeper than the traversal stack allows.
+inline bool ValidateFlatBVHNodes(const FlatBVHNode* nodes, size_t nodeCount, size_t primitiveIndexCount)
+{
+   std::vector<uint32_t> depths(nodeCount, 0);
+   for (size_t idx = 0; idx < nodeCount; ++idx)
+   {
+      const auto& node = nodes[idx];
+      if (node.IsLeaf())
+      {
+         if (static_cast<size_t>(node.Offset) + node.PrimitiveCount > primitiveIndexCount)
+         {
+            return false;
+         }
+      }
+      else if (node.Offset <= idx || node.Offset >= nodeCount || idx + 1 >= nodeCount || node.Axis > 2 ||
+         depths[idx] + 1 > BVHBuildConstants::MaxDepth)
+      {
+         return false;
+      }
+      else
+      {
+         depths[idx + 1] = depths[idx] + 1;
+         depths[node.Offset] = depths[idx] + 1;
+      }
+   }
+
+   return true;
+}
+
+inline bool ValidateFlatBVHPrimitiveIndices(const uint32_t* primitiveIndices, size_t primitiveIndexCount, size_t primitiveCount)
+{
+   for (size_t idx = 0; idx < primitiveIndexCount; ++idx)
+   {
+      if (primitiveIndices[idx] >= primitiveCount)
+      {
+         return false;
+      }
+   }
+
+   return true;
+}
@@ -0,0 +1,195 @@
+#pragma once
+#include <Core/AtomicFile.h>
+#include <Core/FlatBVH.h>
+#include <Core/MappedFile.h>
+#include <Core/Profiler.h>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+
+namespace BVHCacheConstants
+{
+   constexpr char Magic[8] = { 'R', 'T', 'B', 'V', 'H', 'C', '\0', '\0' };
+   constexpr uint32_t Version = 1;
+}
+
+struct BVHCacheHeader
+{
+public:
+   char Magic[8];
+   uint32_t Version;
+   uint32_t BuildMethod;
+   uint64_t InputHash;
+   uint64_t PrimitiveCount;
+   uint64_t NodeCount;
+   uint64_t PrimitiveIndexCount;
+   uint32_t NodeSize;
+   uint32_t Padding;
+
+};
+
+static_assert(sizeof(BVHCacheHeader) % alignof(FlatBVHNode) == 0, "Nodes must be aligned right after the header.");
+
+// Stores built FlatBVHs on disk keyed by hash of the build input. Except for SBVH, topology of BVH depends only on
+// bounding boxes of primitives and build method, so those are what the key is made of; changing materials keeps the
+// cache valid. SBVH leaf bounds come from the clipped bounds of the primitives, which depend on their shape and not
+// only their boxes, so SBVH builds are never cached.
+class BVHCache
+{
+public:
+   static BVHCache& Instance()
+   {
+      static BVHCache instance;
+      return instance;
+   }
+
+   void SetDirectory(const std::filesystem::path& directory) { m_directory = directory; }
+   const std::filesystem::path& GetDirectory() const { return m_directory; }
+
+   void SetEnabled(bool bEnabled) { m_bEnabled = bEnabled; }
+   bool IsEnabled() const { return m_bEnabled; }
+
+   std::shared_ptr<FlatBVH> GetOrBuild(const HittableList& list, double time0, double time1, BVHBuildMethod method = BVHBuildMethod::SAH)
+   {
+      RenderProfiler::ScopedPhase phase(RenderPhase::BVHBuild);
+      const auto& primitives = list.GetObjects();
+      auto infos = FlatBVH::GatherPrimitiveInfos(primitives, time0, time1);
+      if (!m_bEnabled || method == BVHBuildMethod::SBVH)
+      {
+         return std::make_shared<FlatBVH>(primitives, FlatBVH::Build(std::move(infos), primitives, time0, time1, method));
+      }
+
+      const uint64_t inputHash = HashInput(infos, time0, time1, method);
+      const auto path = m_directory / (ToHexString(inputHash) + ".bvh");
+      if (auto cached = Load(path, primitives, inputHash, method))
+      {
+         return cached;
+      }
+
+      auto data = FlatBVH::Build(std::move(infos), primitives, time0, time1, method);
+      Store(path, data, primitives.size(), inputHash, method);
+      return std::make_shared<FlatBVH>(primitives, std::move(data));
+   }
+
+   static uint64_t HashInput(const std::vector<BVHPrimitiveInfo>& infos, double time0, double time1, BVHBuildMethod method)
+   {
+      // FNV-1a
+      uint64_t hash = 14695981039346656037ull;
+      auto combine = [&hash](const void* data, size_t size)
+      {
+         auto bytes = static_cast<const uint8_t*>(data);
+         for (size_t idx = 0; idx < size; ++idx)
+         {
+            hash ^= bytes[idx];
+            hash *= 1099511628211ull;
+         }
+      };
+
+      const uint64_t count = infos.size();
+      combine(&BVHCacheConstants::Version, sizeof(BVHCacheConstants::Version));
+      combine(&method, sizeof(method));
+      combine(&count, sizeof(count));
+      combine(&time0, sizeof(time0));
+      combine(&time1, sizeof(time1));
+      for (const auto& info : infos)
+      {
+         combine(info.Bounds.Minimum.e, sizeof(info.Bounds.Minimum.e));
+         combine(info.Bounds.Maximum.e, sizeof(info.Bounds.Maximum.e));
+      }
+
+      return hash;
+   }
+
+private:
+   BVHCache() = default;
+
+   static std::string ToHexString(uint64_t value)
+   {
+      std::ostringstream stream;
+      stream << std::hex << std::setw(16) << std::setfill('0') << value;
+      return stream.str();
+   }
+
+   static std::shared_ptr<FlatBVH> Load(const std::filesystem::path& path, const std::vector<std::shared_ptr<Hittable>>& primitives,
+      uint64_t inputHash, BVHBuildMethod method)
+   {
+      std::error_code error;
+      if (!std::filesystem::exists(path, error))
+      {
+         return nullptr;
+      }
+
+      auto mapping = std::make_shared<MappedFile>(path);
+      if (!mapping->IsValid() || mapping->Size() < sizeof(BVHCacheHeader))
+      {
+         return nullptr;
+      }
+
+      BVHCacheHeader header;
+      std::memcpy(&header, mapping->Data(), sizeof(header));
+      bool bValidHeader =
+         std::memcmp(header.Magic, BVHCacheConstants::Magic, sizeof(header.Magic)) == 0 &&
+         header.Version == BVHCacheConstants::Version &&
+         header.BuildMethod == static_cast<uint32_t>(method) &&
+         header.InputHash == inputHash &&
+         header.PrimitiveCount == primitives.size() &&
+         header.NodeSize == sizeof(FlatBVHNode);
+
+      const size_t expectedSize = sizeof(BVHCacheHeader) +
+         header.NodeCount * sizeof(FlatBVHNode) +
+         header.PrimitiveIndexCount * sizeof(uint32_t);
+      if (!bValidHeader || mapping->Size() != expectedSize)
+      {
+         std::cerr << "Ignoring stale BVH cache file '" << path.string() << "'.\n";
+         return nullptr;
+      }
+
+      auto nodes = reinterpret_cast<const FlatBVHNode*>(mapping->Data() + sizeof(BVHCacheHeader));
+      auto primitiveIndices = reinterpret_cast<const uint32_t*>(nodes + header.NodeCount);
+      if (!Validate(nodes, header.NodeCount, primitiveIndices, header.PrimitiveIndexCount, header.PrimitiveCount))
+      {
+         std::cerr << "Ignoring corrupted BVH cache file '" << path.string() << "'.\n";
+         return nullptr;
+      }
+
+      std::cerr << "Loaded BVH from cache '" << path.string() << "'.\n";
+      return std::make_shared<FlatBVH>(primitives, mapping, nodes, header.NodeCount, primitiveIndices, header.PrimitiveIndexCount);
+   }
+
+   static bool Validate(const FlatBVHNode* nodes, size_t nodeCount, const uint32_t* primitiveIndices, size_t primitiveIndexCount, size_t primitiveCount)
+   {
+      return ValidateFlatBVHNodes(nodes, nodeCount, primitiveIndexCount) &&
+         ValidateFlatBVHPrimitiveIndices(primitiveIndices, primitiveIndexCount, primitiveCount);
+   }
+
+   static void Store(const std::filesystem::path& path, const FlatBVHData& data, size_t primitiveCount, uint64_t inputHash, BVHBuildMethod method)
+   {
+      std::error_code error;
+      std::filesystem::create_directories(path.parent_path(), error);
+
+      BVHCacheHeader header;
+      std::memcpy(header.Magic, BVHCacheConstants::Magic, sizeof(header.Magic));
+      header.Version = BVHCacheConstants::Version;
+      header.BuildMethod = static_cast<uint32_t>(method);
+      header.InputHash = inputHash;
+      header.PrimitiveCount = primitiveCount;
+      header.NodeCount = data.Nodes.size();
+      header.PrimitiveIndexCount = data.PrimitiveIndices.size();
+      header.NodeSize = sizeof(FlatBVHNode);
+      header.Padding = 0;
+
+      // Concurrent runs may map the cache while this one replaces it.
+      WriteFileAtomically(path, "BVH cache file", [&](std::ofstream& stream)
+         {
+            stream.write(reinterpret_cast<const char*>(&header), sizeof(header));
+            stream.write(reinterpret_cast<const char*>(data.Nodes.data()), data.Nodes.size() * sizeof(FlatBVHNode));
+            stream.write(reinterpret_cast<const char*>(data.PrimitiveIndices.data()), data.PrimitiveIndices.size() * sizeof(uint32_t));
+         });
+   }
+
+private:
+   std::filesystem::path m_directory = "BVHCache";
+   bool m_bEnabled = true;
+
+};
@@ -76,6 +76,18 @@ public:
       return bHitLeft || bHitRight;
    }
 
+   void BoundaryCrossings(const Ray& r, double tMin, double tMax, std::vector<BoundaryCrossing>& crossings) const override
+   {
+      if (m_aabb.Hit(r, tMin, tMax))
+      {
+         m_left->BoundaryCrossings(r, tMin, tMax, crossings);
+         if (m_right != m_left)
+         {
+            m_right->BoundaryCrossings(r, tMin, tMax, crossings);
+         }
+      }
+   }
+
    bool BoundingBox(double time0, double time1, AABB& outputBox) const override
    {
       outputBox = m_aabb;
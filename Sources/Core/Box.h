@@ -1,28 +1,83 @@
 #pragma once
 #include <Core/Rect.h>
-#include <Core/HittableList.h>
 
 class Box : public Hittable
 {
 public:
    Box() = default;
-   Box(const Point3& boxMin, const Point3& boxMax, std::shared_ptr<Material> matPtr) :
+   Box(const Point3& boxMin, const Point3& boxMax, uint32_t material) :
       m_boxMin(boxMin),
-      m_boxMax(boxMax)
+      m_boxMax(boxMax),
+      m_material(material)
    {
-      m_sides.Add(std::make_shared<XYRect>(boxMin.x, boxMax.x, boxMin.y, boxMax.y, boxMax.z, matPtr));
-      m_sides.Add(std::make_shared<XYRect>(boxMin.x, boxMax.x, boxMin.y, boxMax.y, boxMin.z, matPtr));
+   }
+
+   bool Hit(const Ray& r, double tMin, double tMax, HitRecord& rec) const override
+   {
+      RT_STAT_INCREMENT(StatCounter::BoxTests);
+      return Intersect(m_boxMin, m_boxMax, m_material, r, tMin, tMax, rec);
+   }
+
+   // Closest hit among the six sides, tested in place rather than through six rect objects.
+   static bool Intersect(const Point3& boxMin, const Point3& boxMax, uint32_t material,
+      const Ray& r, double tMin, double tMax, HitRecord& rec)
+   {
+      bool bHitAnything = false;
+      auto closestSoFar = tMax;
+      auto testSide = [&](bool bHit)
+      {
+         if (bHit)
+         {
+            bHitAnything = true;
+            closestSoFar = rec.t;
+         }
+      };
 
-      m_sides.Add(std::make_shared<XZRect>(boxMin.x, boxMax.x, boxMin.z, boxMax.z, boxMax.y, matPtr));
-      m_sides.Add(std::make_shared<XZRect>(boxMin.x, boxMax.x, boxMin.z, boxMax.z, boxMin.y, matPtr));
+      testSide(HitAxisAlignedRect<0, 1, 2>(boxMin.x, boxMax.x, boxMin.y, boxMax.y, boxMax.z, material, r, tMin, closestSoFar, rec));
+      testSide(HitAxisAlignedRect<0, 1, 2>(boxMin.x, boxMax.x, boxMin.y, boxMax.y, boxMin.z, material, r, tMin, closestSoFar, rec));
 
-      m_sides.Add(std::make_shared<YZRect>(boxMin.y, boxMax.y, boxMin.z, boxMax.z, boxMax.x, matPtr));
-      m_sides.Add(std::make_shared<YZRect>(boxMin.y, boxMax.y, boxMin.z, boxMax.z, boxMin.x, matPtr));
+      testSide(HitAxisAlignedRect<0, 2, 1>(boxMin.x, boxMax.x, boxMin.z, boxMax.z, boxMax.y, material, r, tMin, closestSoFar, rec));
+      testSide(HitAxisAlignedRect<0, 2, 1>(boxMin.x, boxMax.x, boxMin.z, boxMax.z, boxMin.y, material, r, tMin, closestSoFar, rec));
+
+      testSide(HitAxisAlignedRect<1, 2, 0>(boxMin.y, boxMax.y, boxMin.z, boxMax.z, boxMax.x, material, r, tMin, closestSoFar, rec));
+      testSide(HitAxisAlignedRect<1, 2, 0>(boxMin.y, boxMax.y, boxMin.z, boxMax.z, boxMin.x, material, r, tMin, closestSoFar, rec));
+      return bHitAnything;
    }
 
-   bool Hit(const Ray& r, double tMin, double tMax, HitRecord& rec) const override
+   void BoundaryCrossings(const Ray& r, double tMin, double tMax, std::vector<BoundaryCrossing>& crossings) const override
    {
-      return m_sides.Hit(r, tMin, tMax, rec);
+      RT_STAT_INCREMENT(StatCounter::BoxTests);
+      Crossings(m_boxMin, m_boxMax, r, tMin, tMax, crossings);
+   }
+
+   // Where r enters and leaves the box, if between tMin and tMax: the last of the near sides and the first of the far
+   // sides, at the same t Intersect finds on them.
+   static void Crossings(const Point3& boxMin, const Point3& boxMax, const Ray& r, double tMin, double tMax,
+      std::vector<BoundaryCrossing>& crossings)
+   {
+      double tEnter = -Infinity;
+      double tExit = Infinity;
+      for (int axis = 0; axis < 3; ++axis)
+      {
+         const double t0 = (boxMin[axis] - r.Origin[axis]) / r.Direction[axis];
+         const double t1 = (boxMax[axis] - r.Origin[axis]) / r.Direction[axis];
+         tEnter = std::max(tEnter, std::min(t0, t1));
+         tExit = std::min(tExit, std::max(t0, t1));
+      }
+
+      if (tEnter >= tExit)
+      {
+         return;
+      }
+
+      const BoundaryCrossing sides[2] = { { tEnter, true }, { tExit, false } };
+      for (const BoundaryCrossing& side : sides)
+      {
+         if (side.t >= tMin && side.t <= tMax)
+         {
+            crossings.push_back(side);
+         }
+      }
    }
 
    bool BoundingBox(double time0, double time1, AABB& outputBox) const override
@@ -34,6 +89,6 @@ public:
 private:
    Point3 m_boxMin = Point3(-0.5, -0.5, -0.5);
    Point3 m_boxMax = Point3(0.5, 0.5, 0.5);
-   HittableList m_sides;
+   uint32_t m_material = 0;
 
 };
@@ -1,6 +1,23 @@
 #pragma once
 #include <Core/CoreMinimal.h>
+#include <Core/RenderFeatures.h>
+#include <Core/Sampler.h>
 #include <Math/Ray.h>
+#include <Math/Sampling.h>
+
+enum class CameraProjection : uint32_t
+{
+   Perspective = 0, // Rays from the lens through the viewport
+   Orthographic,    // Parallel rays from the viewport, which frames at the focus distance what perspective frames there
+   Equirectangular, // Every direction around the camera, longitude across the image and latitude up it
+   Count
+};
+
+namespace CameraConstants
+{
+   constexpr size_t ProjectionCount = static_cast<size_t>(CameraProjection::Count);
+   constexpr const char* ProjectionNames[ProjectionCount] = { "Perspective", "Orthographic", "Equirectangular" };
+}
 
 class Camera
 {
@@ -14,7 +31,8 @@ public:
       double aperture,
       double focusDist,
       double time0 = 0.0,
-      double time1 = 0.0)
+      double time1 = 0.0,
+      CameraProjection projection = CameraProjection::Perspective)
    {
       // Camera
       auto theta = DegreesToRadians(verticalFov);
@@ -30,28 +48,159 @@ public:
       m_horizontal = m_u * viewportWidth * focusDist;
       m_vertical = m_v * viewportHeight * focusDist;
       m_lowerLeftCorner = m_position - (m_horizontal / 2.0) - (m_vertical / 2.0) - (focusDist*m_w);
+      m_planeCorner = m_lowerLeftCorner + focusDist * m_w;
 
       m_lensRad = aperture / 2.0;
 
       m_time0 = time0;
       m_time1 = time1;
+
+      m_projection = projection;
+   }
+
+   // Ray through (s, t) of the viewport, from (0, 0) at the bottom left to (1, 1) at the top right. Lens and time
+   // draw the camera dimensions after the pixel position. Without DepthOfField or MotionBlur in Features the lens is
+   // a pinhole and the shutter an instant; their dimensions are skipped rather than drawn, so bounces still draw from
+   // the same ones. Only perspective cameras have a lens. Equirectangular images wrap around, so their pixels span s
+   // in [0, 1) as (dx + jitter) / width, not (dx + jitter) / (width - 1), lest the columns of the seam repeat.
+   template<uint32_t Features = RenderFeatureConstants::AllFeatures>
+   Ray GetRay(double s, double t, Sampler& sampler) const
+   {
+      switch (m_projection)
+      {
+      case CameraProjection::Orthographic:
+         return Expose<Features>(m_planeCorner + s * m_horizontal + t * m_vertical, -m_w, false, sampler);
+
+      case CameraProjection::Equirectangular:
+         return Expose<Features>(m_position, DirectionAt(s * 2.0 * Pi - Pi, t * Pi - Pi / 2.0), false, sampler);
+
+      default:
+         return Expose<Features>(m_position, m_lowerLeftCorner + s * m_horizontal + t * m_vertical - m_position, true, sampler);
+      }
+   }
+
+   // Features the camera needs rays generated with.
+   uint32_t GetFeatures() const
+   {
+      const bool bLens = m_projection == CameraProjection::Perspective && m_lensRad > 0.0;
+      return (m_time1 != m_time0 ? FeatureBit(RenderFeature::MotionBlur) : 0) |
+         (bLens ? FeatureBit(RenderFeature::DepthOfField) : 0);
+   }
+
+   CameraProjection GetProjection() const { return m_projection; }
+
+private:
+   // Direction of longitude phi around the up axis, zero straight ahead, and latitude theta above the horizon.
+   Vec3 DirectionAt(double phi, double theta) const
+   {
+      const double cosTheta = std::cos(theta);
+      return cosTheta * std::sin(phi) * m_u + std::sin(theta) * m_v - cosTheta * std::cos(phi) * m_w;
    }
 
-   Ray GetRay(double s, double t) const
+   // Ray from origin along direction at a time of the shutter, through the lens if bLens.
+   template<uint32_t Features>
+   Ray Expose(Point3 origin, Vec3 direction, bool bLens, Sampler& sampler) const
    {
-      Vec3 rd = m_lensRad * RandomInUnitDisk();
-      Vec3 offset = m_u * rd.x + m_v * rd.y;
-      return Ray(m_position + offset, m_lowerLeftCorner + s * m_horizontal + t * m_vertical - m_position - offset,
-         RandomDouble(m_time0, m_time1));
+      if constexpr (HasFeature(Features, RenderFeature::DepthOfField))
+      {
+         const Point2 rd = SampleConcentricDisk(sampler.Get2D());
+         if (bLens)
+         {
+            const Vec3 offset = m_lensRad * (m_u * rd.x + m_v * rd.y);
+            origin += offset;
+            direction -= offset;
+         }
+      }
+      else
+      {
+         sampler.Skip();
+      }
+
+      double time = m_time0;
+      if constexpr (HasFeature(Features, RenderFeature::MotionBlur))
+      {
+         time += (m_time1 - m_time0) * sampler.Get1D();
+      }
+      else
+      {
+         sampler.Skip();
+      }
+
+      return Ray(origin, direction, time);
    }
 
 private:
+   friend class CameraRayGenerator;
+
    Point3 m_position;
    Point3 m_lowerLeftCorner;
+   Point3 m_planeCorner; // Lower left corner of the viewport moved back onto the camera, where orthographic rays start
    Vec3 m_horizontal;
    Vec3 m_vertical;
    Vec3 m_u, m_v, m_w;
    double m_lensRad;
    double m_time0, m_time1;
+   CameraProjection m_projection;
+
+};
+
+// Camera rays of the pixels of an image, pixel (dx, dy) counted from the bottom left and jittered by the first
+// dimension of the pixel sample. What varies linearly over the image, the viewport point of a perspective or
+// orthographic camera or the angles of an equirectangular one, is kept as its value at pixel (0, 0) plus steps per
+// column and row, so a ray takes two multiply-adds to aim rather than a division and four vector operations.
+class CameraRayGenerator
+{
+public:
+   CameraRayGenerator(const Camera& camera, int imageWidth, int imageHeight) :
+      m_camera(camera)
+   {
+      const double columnScale = 1.0 / (imageWidth - 1);
+      const double rowScale = 1.0 / (imageHeight - 1);
+      switch (camera.m_projection)
+      {
+      case CameraProjection::Orthographic:
+         m_first = camera.m_planeCorner;
+         m_columnStep = camera.m_horizontal * columnScale;
+         m_rowStep = camera.m_vertical * rowScale;
+         break;
+
+      case CameraProjection::Equirectangular:
+         // Pixels tile [-Pi, Pi) x [-Pi / 2, Pi / 2] edge to edge, so neither the seam nor the poles are sampled twice.
+         m_first = Vec3(-Pi, -Pi / 2.0, 0.0);
+         m_columnStep = Vec3(2.0 * Pi / imageWidth, 0.0, 0.0);
+         m_rowStep = Vec3(0.0, Pi / imageHeight, 0.0);
+         break;
+
+      default:
+         m_first = camera.m_lowerLeftCorner - camera.m_position;
+         m_columnStep = camera.m_horizontal * columnScale;
+         m_rowStep = camera.m_vertical * rowScale;
+         break;
+      }
+   }
+
+   template<uint32_t Features = RenderFeatureConstants::AllFeatures>
+   Ray Generate(int dx, int dy, Sampler& sampler) const
+   {
+      const Point2 jitter = sampler.Get2D();
+      const Vec3 aim = m_first + (dx + jitter.x) * m_columnStep + (dy + jitter.y) * m_rowStep;
+      switch (m_camera.m_projection)
+      {
+      case CameraProjection::Orthographic:
+         return m_camera.Expose<Features>(aim, -m_camera.m_w, false, sampler);
+
+      case CameraProjection::Equirectangular:
+         return m_camera.Expose<Features>(m_camera.m_position, m_camera.DirectionAt(aim.x, aim.y), false, sampler);
+
+      default:
+         return m_camera.Expose<Features>(m_camera.m_position, aim, true, sampler);
+      }
+   }
+
+private:
+   const Camera& m_camera;
+   Vec3 m_first;
+   Vec3 m_columnStep;
+   Vec3 m_rowStep;
 
 };
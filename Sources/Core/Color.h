@@ -4,14 +4,8 @@
 
 using Color = Vec3;
 
-static void WriteColor(std::unique_ptr<unsigned char[]>& buffer, Color color, size_t base, size_t samplesPerPixel)
+// Relative luminance of linear Rec. 709 RGB.
+inline double Luminance(const Color& color)
 {
-   auto scale = 1.0 / static_cast<double>(samplesPerPixel);
-   double r = std::sqrt(color.r * scale);
-   double g = std::sqrt(color.g * scale);
-   double b = std::sqrt(color.b * scale);
-
-   buffer[base + 0] = static_cast<unsigned char>(256.0 * std::clamp(r, 0.0, 0.999));
-   buffer[base + 1] = static_cast<unsigned char>(256.0 * std::clamp(g, 0.0, 0.999));
-   buffer[base + 2] = static_cast<unsigned char>(256.0 * std::clamp(b, 0.0, 0.999));
+   return 0.2126 * color.r + 0.7152 * color.g + 0.0722 * color.b;
 }
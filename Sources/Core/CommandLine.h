@@ -0,0 +1,55 @@
+#pragma once
+#include <Core/CoreMinimal.h>
+#include <Core/Integrator.h>
+#include <Math/RayPacket.h>
+#include <charconv>
+#include <string_view>
+
+// Parsing shared by the command lines of the renderer and the benchmarks, so they accept and reject the same values.
+
+// Whole of text as a number no less than minimum; output is left alone otherwise.
+template<typename T>
+inline bool ParseNumber(std::string_view text, T minimum, T& output)
+{
+   T value = 0;
+   auto result = std::from_chars(text.data(), text.data() + text.size(), value);
+   if (result.ec != std::errc() || result.ptr != text.data() + text.size() || value < minimum)
+   {
+      return false;
+   }
+
+   output = value;
+   return true;
+}
+
+// Zero for single rays, or one of the packet sizes of RayPacketConstants::Sizes.
+inline bool ParsePacketSize(std::string_view text, int& output)
+{
+   int size = 0;
+   if (!ParseNumber(text, 0, size) || (size != 0 &&
+      std::find(std::begin(RayPacketConstants::Sizes), std::end(RayPacketConstants::Sizes), static_cast<size_t>(size)) == std::end(RayPacketConstants::Sizes)))
+   {
+      return false;
+   }
+
+   output = size;
+   return true;
+}
+
+// Only the wavefront integrator has whole batches of rays at hand, to trace as packets or to reorder.
+inline bool ValidateIntegratorOptions(IntegratorType integrator, int packetSize, bool bReorderRays)
+{
+   if (packetSize > 0 && integrator != IntegratorType::Wavefront)
+   {
+      std::cerr << "'--packet-size' needs '--integrator Wavefront'.\n";
+      return false;
+   }
+
+   if (bReorderRays && integrator != IntegratorType::Wavefront)
+   {
+      std::cerr << "'--reorder-rays' needs '--integrator Wavefront'.\n";
+      return false;
+   }
+
+   return true;
+}
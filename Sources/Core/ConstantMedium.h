@@ -1,85 +1,83 @@
 #pragma once
 #include <Core/Hittable.h>
-#include <Core/Isotropic.h>
+#include <Core/Material.h>
+#include <Core/RayHash.h>
+#include <bit>
 
 class ConstantMedium : public Hittable
 {
 public:
-   ConstantMedium(std::shared_ptr<Hittable> boundary, double density, std::shared_ptr<Texture> albedo) : 
+   ConstantMedium(std::shared_ptr<Hittable> boundary, double density, uint32_t phaseFunction) :
       m_boundary(boundary),
-      m_negInvDensity(-1.0/density),
-      m_phaseFunction(std::make_shared<Isotropic>(albedo))
-   {
-   }
-
-   ConstantMedium(std::shared_ptr<Hittable> boundary, double density, Color albedo) :
-      ConstantMedium(boundary, density, std::make_shared<SolidColorTexture>(albedo))
+      m_phaseFunction(phaseFunction),
+      m_negInvDensity(-1.0 / density)
    {
    }
 
    bool Hit(const Ray& r, double tMin, double tMax, HitRecord& rec) const override
    {
-      constexpr bool bEnableDebug = false;
-      const bool bDebugging = bEnableDebug && RandomDouble() <= 0.000001;
-
-      HitRecord recs[2];
-      if (!m_boundary->Hit(r, -Infinity, Infinity, recs[0]))
-      {
-         return false;
-      }
-
-      if (!m_boundary->Hit(r, recs[0].t + 0.0001, Infinity, recs[1]))
+      RT_STAT_INCREMENT(StatCounter::ConstantMediumTests);
+      auto boundaryCrossings = [this](const Ray& boundaryRay, double boundaryMin, double boundaryMax, std::vector<BoundaryCrossing>& crossings)
       {
-         return false;
-      }
+         m_boundary->BoundaryCrossings(boundaryRay, boundaryMin, boundaryMax, crossings);
+      };
 
-      if (bDebugging)
-      {
-         std::cerr << "\ntMin = " << recs[0].t << ", tMax = " << recs[1].t << std::endl;
-      }
+      return HitMedium(boundaryCrossings, m_negInvDensity, m_phaseFunction, r, tMin, tMax, rec);
+   }
 
-      if (recs[0].t < tMin)
-      {
-         recs[0].t = tMin;
-      }
-      if (recs[1].t > tMax)
-      {
-         recs[1].t = tMax;
-      }
+   // A medium has no surface to cross.
+   void BoundaryCrossings(const Ray& r, double tMin, double tMax, std::vector<BoundaryCrossing>& crossings) const override
+   {
+   }
 
-      if (recs[0].t >= recs[1].t)
+   // Scattering event inside of a boundary of any shape, found with one traversal of it. BoundaryCrossings is called as
+   // boundaryCrossings(ray, tMin, tMax, crossings), which lets boundaries that are not Hittable objects share the same
+   // sampling. The ray is inside wherever it has entered more pieces of the boundary than it has left, so pieces may
+   // overlap or touch, and the sampled distance is spent over those intervals in order.
+   template<typename BoundaryCrossings>
+   static bool HitMedium(const BoundaryCrossings& boundaryCrossings, double negInvDensity, uint32_t phaseFunction,
+      const Ray& r, double tMin, double tMax, HitRecord& rec)
+   {
+      thread_local std::vector<BoundaryCrossing> crossings;
+      crossings.clear();
+      boundaryCrossings(r, -Infinity, Infinity, crossings);
+      if (crossings.size() < 2)
       {
          return false;
       }
 
-      if (recs[0].t < 0.0)
-      {
-         recs[0].t = 0.0;
-      }
+      std::sort(crossings.begin(), crossings.end(), [](const BoundaryCrossing& lhs, const BoundaryCrossing& rhs) { return lhs.t < rhs.t; });
 
       const auto rayLength = r.Direction.Length();
-      const auto distanceInsideBoundary = (recs[1].t - recs[0].t) * rayLength;
-      const auto hitDistance = m_negInvDensity * log(RandomDouble());
-
-      if (hitDistance > distanceInsideBoundary)
+      auto hitDistance = negInvDensity * log(RayHashSequence(r, std::bit_cast<uint64_t>(negInvDensity)).Next());
+      int depth = 0;
+      for (size_t idx = 0; idx + 1 < crossings.size(); ++idx)
       {
-         return false;
+         depth += crossings[idx].bEntering ? 1 : -1;
+         const double entry = std::max({ crossings[idx].t, tMin, 0.0 });
+         const double exit = std::min(crossings[idx + 1].t, tMax);
+         if (depth <= 0 || entry >= exit)
+         {
+            continue;
+         }
+
+         const auto distanceInsideBoundary = (exit - entry) * rayLength;
+         if (hitDistance > distanceInsideBoundary)
+         {
+            hitDistance -= distanceInsideBoundary;
+            continue;
+         }
+
+         rec.t = entry + (hitDistance / rayLength);
+         rec.p = r.At(rec.t);
+         rec.n = Vec3(1.0, 0.0, 0.0);
+         rec.bFrontFace = true;
+         rec.Material = phaseFunction;
+
+         return true;
       }
 
-      rec.t = recs[0].t + (hitDistance / rayLength);
-      rec.p = r.At(rec.t);
-      if (bDebugging)
-      {
-         std::cerr << "Hit Distance = " << hitDistance << std::endl;
-         std::cerr << "Rec.t = " << rec.t << std::endl;
-         std::cerr << "Rec.p = " << rec.p << std::endl;
-      }
-
-      rec.n = Vec3(1.0, 0.0, 0.0);
-      rec.bFrontFace = true;
-      rec.MatPtr = m_phaseFunction;
-
-      return true;
+      return false;
    }
 
    bool BoundingBox(double time0, double time1, AABB& outputBox) const override
@@ -89,7 +87,7 @@ public:
 
 private:
    std::shared_ptr<Hittable> m_boundary;
-   std::shared_ptr<Material> m_phaseFunction;
+   uint32_t m_phaseFunction = 0;
    double m_negInvDensity;
 
 };
@@ -1,10 +1,14 @@
 #pragma once
+#include <algorithm>
+#include <cstdint>
 #include <memory>
 #include <iostream>
 #include <vector>
 #include <random>
 
+#ifdef _MSC_VER
 #define STBI_MSC_SECURE_CRT
+#endif
 #ifndef STB_IMAGE_WRITE_IMPLEMENTATION
 #define STB_IMAGE_WRITE_IMPLEMENTATION
 #endif
@@ -29,11 +33,33 @@ inline double RadiansToDegrees(double rad)
    return rad * (180.0f / Pi);
 }
 
+// Every thread owns its generator, so render threads never race on the random state.
+inline std::mt19937& RandomGenerator()
+{
+   thread_local std::mt19937 gen;
+   return gen;
+}
+
+// SplitMix64 finalizer; turns structured values like (seed, pixel index) into well distributed seeds.
+inline uint64_t MixBits(uint64_t value)
+{
+   value ^= value >> 30;
+   value *= 0xbf58476d1ce4e5b9ull;
+   value ^= value >> 27;
+   value *= 0x94d049bb133111ebull;
+   value ^= value >> 31;
+   return value;
+}
+
+inline void SeedRandom(uint64_t seed)
+{
+   RandomGenerator().seed(static_cast<std::mt19937::result_type>(MixBits(seed)));
+}
+
 inline double RandomDouble()
 {
-   static std::uniform_real_distribution<double> distribution(0.0, 1.0);
-   static std::mt19937 gen;
-   return distribution(gen);
+   thread_local std::uniform_real_distribution<double> distribution(0.0, 1.0);
+   return distribution(RandomGenerator());
 }
 
 inline double RandomDouble(double min, double max)
@@ -0,0 +1,170 @@
+#pragma once
+#include <Core/CoreMinimal.h>
+#include <Math/AABB.h>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+
+namespace DensityGridConstants
+{
+   constexpr int BrickSize = 8; // Voxels along each axis of a brick of SparseGrid
+   constexpr size_t BrickVoxelCount = static_cast<size_t>(BrickSize) * BrickSize * BrickSize;
+   constexpr uint32_t EmptyBrick = ~0u;
+}
+
+// Voxel densities of a grid medium, x varying fastest and z slowest, with the box the grid fills.
+struct DensityGridData
+{
+public:
+   int Resolution[3] = {};
+   AABB Bounds;
+   std::vector<float> Densities;
+
+   size_t VoxelCount() const
+   {
+      return static_cast<size_t>(Resolution[0]) * Resolution[1] * Resolution[2];
+   }
+
+};
+
+// Every voxel of the grid, in one array.
+class DenseGrid
+{
+public:
+   DenseGrid(const DensityGridData& data) :
+      m_resolution{ data.Resolution[0], data.Resolution[1], data.Resolution[2] },
+      m_densities(data.Densities)
+   {
+   }
+
+   float Lookup(int x, int y, int z) const
+   {
+      return m_densities[(static_cast<size_t>(z) * m_resolution[1] + y) * m_resolution[0] + x];
+   }
+
+   int Resolution(int axis) const { return m_resolution[axis]; }
+   size_t MemorySize() const { return m_densities.size() * sizeof(float); }
+
+private:
+   int m_resolution[3];
+   std::vector<float> m_densities;
+
+};
+
+// Voxels in bricks of BrickSize^3, of which only those with any density are stored. Clouds and smoke leave most of
+// their box empty, so they take a fraction of the memory of a DenseGrid for one more indirection per lookup.
+class SparseGrid
+{
+public:
+   SparseGrid(const DensityGridData& data) :
+      m_resolution{ data.Resolution[0], data.Resolution[1], data.Resolution[2] }
+   {
+      using namespace DensityGridConstants;
+      for (int axis = 0; axis < 3; ++axis)
+      {
+         m_brickCount[axis] = (m_resolution[axis] + BrickSize - 1) / BrickSize;
+      }
+
+      m_brickSlots.assign(static_cast<size_t>(m_brickCount[0]) * m_brickCount[1] * m_brickCount[2], EmptyBrick);
+      std::vector<float> brick(BrickVoxelCount);
+      for (int bz = 0; bz < m_brickCount[2]; ++bz)
+      {
+         for (int by = 0; by < m_brickCount[1]; ++by)
+         {
+            for (int bx = 0; bx < m_brickCount[0]; ++bx)
+            {
+               bool bEmpty = true;
+               for (int z = 0; z < BrickSize; ++z)
+               {
+                  for (int y = 0; y < BrickSize; ++y)
+                  {
+                     for (int x = 0; x < BrickSize; ++x)
+                     {
+                        const int vx = bx * BrickSize + x;
+                        const int vy = by * BrickSize + y;
+                        const int vz = bz * BrickSize + z;
+                        const bool bInside = vx < m_resolution[0] && vy < m_resolution[1] && vz < m_resolution[2];
+                        const float density = bInside ?
+                           data.Densities[(static_cast<size_t>(vz) * m_resolution[1] + vy) * m_resolution[0] + vx] : 0.0f;
+                        brick[(z * BrickSize + y) * BrickSize + x] = density;
+                        bEmpty = bEmpty && density == 0.0f;
+                     }
+                  }
+               }
+
+               if (!bEmpty)
+               {
+                  m_brickSlots[(static_cast<size_t>(bz) * m_brickCount[1] + by) * m_brickCount[0] + bx] =
+                     static_cast<uint32_t>(m_bricks.size() / BrickVoxelCount);
+                  m_bricks.insert(m_bricks.end(), brick.begin(), brick.end());
+               }
+            }
+         }
+      }
+   }
+
+   float Lookup(int x, int y, int z) const
+   {
+      using namespace DensityGridConstants;
+      const size_t brickIdx = (static_cast<size_t>(z / BrickSize) * m_brickCount[1] + y / BrickSize) * m_brickCount[0] + x / BrickSize;
+      const uint32_t slot = m_brickSlots[brickIdx];
+      if (slot == EmptyBrick)
+      {
+         return 0.0f;
+      }
+
+      return m_bricks[slot * BrickVoxelCount + ((z % BrickSize) * BrickSize + y % BrickSize) * BrickSize + x % BrickSize];
+   }
+
+   int Resolution(int axis) const { return m_resolution[axis]; }
+   size_t MemorySize() const { return m_bricks.size() * sizeof(float) + m_brickSlots.size() * sizeof(uint32_t); }
+
+private:
+   int m_resolution[3];
+   int m_brickCount[3];
+   std::vector<uint32_t> m_brickSlots; // Index of brick in m_bricks, or EmptyBrick
+   std::vector<float> m_bricks;
+
+};
+
+// Reads a Mitsuba .vol grid of single channel float32 voxels: "VOL", version 3, then as little endian int32
+// encoding (1), resolution x, y, z and channel count (1), the bounds as six float32 and the voxels. With bHeaderOnly
+// only resolution and bounds are read.
+inline bool ReadVolFile(const std::filesystem::path& path, DensityGridData& output, bool bHeaderOnly = false)
+{
+   std::ifstream file(path, std::ios::binary);
+   char magic[4] = {};
+   int32_t header[5] = {};
+   float bounds[6] = {};
+   if (!file.read(magic, sizeof(magic)) || !file.read(reinterpret_cast<char*>(header), sizeof(header)) ||
+      !file.read(reinterpret_cast<char*>(bounds), sizeof(bounds)))
+   {
+      std::cerr << "Failed to read grid '" << path.string() << "'.\n";
+      return false;
+   }
+
+   if (std::memcmp(magic, "VOL\x03", sizeof(magic)) != 0 || header[0] != 1 || header[4] != 1 ||
+      header[1] <= 0 || header[2] <= 0 || header[3] <= 0)
+   {
+      std::cerr << "Grid '" << path.string() << "' is not a single channel float32 .vol file.\n";
+      return false;
+   }
+
+   output.Resolution[0] = header[1];
+   output.Resolution[1] = header[2];
+   output.Resolution[2] = header[3];
+   output.Bounds = AABB(Point3(bounds[0], bounds[1], bounds[2]), Point3(bounds[3], bounds[4], bounds[5]));
+   if (bHeaderOnly)
+   {
+      return true;
+   }
+
+   output.Densities.resize(output.VoxelCount());
+   if (!file.read(reinterpret_cast<char*>(output.Densities.data()), output.Densities.size() * sizeof(float)))
+   {
+      std::cerr << "Grid '" << path.string() << "' is truncated.\n";
+      return false;
+   }
+
+   return true;
+}
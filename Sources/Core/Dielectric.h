@@ -2,20 +2,18 @@
 #include <Core/CoreMinimal.h>
 #include <Core/Hittable.h>
 #include <Core/Material.h>
+#include <Core/Sampler.h>
 #include <Math/Ray.h>
 
-class Dielectric : public Material
+class Dielectric
 {
 public:
-   Dielectric(double ior) :
-      IOR(ior)
+   static bool Scatter(double ior, const Ray& rayIn, const HitRecord& rec, Sampler& sampler, ScatterRecord& srec)
    {
-   }
-
-   bool Scatter(const Ray& rayIn, const HitRecord& rec, Color& attenuation, Ray& scattered) const override
-   {
-      attenuation = Color(1.0, 1.0, 1.0);
-      double refractionRatio = rec.bFrontFace ? (1.0 / IOR) : IOR; // 1.0/IOR = Air(or vaccum)->IOR interaction
+      srec.Attenuation = Color(1.0, 1.0, 1.0);
+      srec.PDF = 0.0;
+      srec.bSpecular = true;
+      double refractionRatio = rec.bFrontFace ? (1.0 / ior) : ior; // 1.0/IOR = Air(or vaccum)->IOR interaction
 
       Vec3 unitDir = UnitVectorOf(rayIn.Direction);
       double cosTheta = std::fmin(Dot(-unitDir, rec.n), 1.0);
@@ -23,7 +21,7 @@ public:
 
       bool bCannotRefract = refractionRatio * sinTheta > 1.0;
       Vec3 dir;
-      if (bCannotRefract || Reflectance(cosTheta, rec.bFrontFace ? 1.0 : IOR, rec.bFrontFace ? IOR : 1.0) > RandomDouble())
+      if (bCannotRefract || Reflectance(cosTheta, rec.bFrontFace ? 1.0 : ior, rec.bFrontFace ? ior : 1.0) > sampler.Get1D())
       {
          dir = Reflect(unitDir, rec.n);
       }
@@ -33,7 +31,7 @@ public:
       }
 
 
-      scattered = Ray(rec.p, dir, rayIn.Time);
+      srec.Scattered = Ray(rec.p, dir, rayIn.Time);
       return true;
    }
 
@@ -46,7 +44,4 @@ private:
       return r0 + (1.0 - r0) * pow((1.0 - cosine), 5);
    }
 
-public:
-   double IOR;
-
 };
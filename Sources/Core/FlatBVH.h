@@ -0,0 +1,413 @@
+#pragma once
+#include <Core/Hittable.h>
+#include <Core/HittableList.h>
+#include <Core/MappedFile.h>
+#include <Core/SAHBVHBuilder.h>
+#include <Core/LBVHBuilder.h>
+#include <Core/SBVHBuilder.h>
+#include <bit>
+#include <cassert>
+
+// BVH stored as a single node array, traversed with an explicit stack. Node and index arrays may live either in
+// memory owned by the BVH or in a memory-mapped cache file.
+class FlatBVH : public Hittable
+{
+public:
+   FlatBVH(const HittableList& list, double time0, double time1, BVHBuildMethod method = BVHBuildMethod::SAH) :
+      m_primitives(list.GetObjects())
+   {
+      m_ownedData = Build(GatherPrimitiveInfos(m_primitives, time0, time1), m_primitives, time0, time1, method);
+      m_nodes = m_ownedData.Nodes.data();
+      m_nodeCount = m_ownedData.Nodes.size();
+      m_primitiveIndices = m_ownedData.PrimitiveIndices.data();
+      m_bSharedPrimitives = m_ownedData.PrimitiveIndices.size() > m_primitives.size();
+   }
+
+   FlatBVH(std::vector<std::shared_ptr<Hittable>> primitives, FlatBVHData&& data) :
+      m_primitives(std::move(primitives)),
+      m_ownedData(std::move(data))
+   {
+      m_nodes = m_ownedData.Nodes.data();
+      m_nodeCount = m_ownedData.Nodes.size();
+      m_primitiveIndices = m_ownedData.PrimitiveIndices.data();
+      m_bSharedPrimitives = m_ownedData.PrimitiveIndices.size() > m_primitives.size();
+   }
+
+   FlatBVH(std::vector<std::shared_ptr<Hittable>> primitives, std::shared_ptr<MappedFile> mapping,
+      const FlatBVHNode* nodes, size_t nodeCount, const uint32_t* primitiveIndices, size_t primitiveIndexCount) :
+      m_primitives(std::move(primitives)),
+      m_mapping(std::move(mapping)),
+      m_nodes(nodes),
+      m_nodeCount(nodeCount),
+      m_primitiveIndices(primitiveIndices),
+      m_bSharedPrimitives(primitiveIndexCount > m_primitives.size())
+   {
+   }
+
+   bool Hit(const Ray& r, double tMin, double tMax, HitRecord& rec) const override
+   {
+      if (m_nodeCount == 0)
+      {
+         return false;
+      }
+
+      return Traverse(m_nodes, m_primitiveIndices, r, tMin, tMax, rec,
+         [this](uint32_t primitiveIdx, const Ray& r, double tMin, double tMax, HitRecord& rec)
+         {
+            return m_primitives[primitiveIdx]->Hit(r, tMin, tMax, rec);
+         });
+   }
+
+   uint32_t HitPacket(const RayPacket& packet, double tMin, HitRecord* recs) const override
+   {
+      if (m_nodeCount == 0)
+      {
+         return 0;
+      }
+
+      return TracePacket(m_nodes, m_primitiveIndices, packet, tMin, recs,
+         [this](uint32_t primitiveIdx, const Ray& r, double tMin, double tMax, HitRecord& rec)
+         {
+            return m_primitives[primitiveIdx]->Hit(r, tMin, tMax, rec);
+         });
+   }
+
+   void BoundaryCrossings(const Ray& r, double tMin, double tMax, std::vector<BoundaryCrossing>& crossings) const override
+   {
+      if (m_nodeCount == 0)
+      {
+         return;
+      }
+
+      if (!m_bSharedPrimitives)
+      {
+         VisitPrimitives(m_nodes, m_primitiveIndices, r, tMin, tMax,
+            [this, &r, tMin, tMax, &crossings](uint32_t primitiveIdx)
+            {
+               m_primitives[primitiveIdx]->BoundaryCrossings(r, tMin, tMax, crossings);
+            });
+         return;
+      }
+
+      // Each primitive must add its crossings once, however many leaves spatial splits put it in. The scratch
+      // indices of this call start at first, above those of any FlatBVH it is nested in.
+      thread_local std::vector<uint32_t> visited;
+      const size_t first = visited.size();
+      VisitPrimitives(m_nodes, m_primitiveIndices, r, tMin, tMax,
+         [](uint32_t primitiveIdx)
+         {
+            visited.push_back(primitiveIdx);
+         });
+
+      std::sort(visited.begin() + first, visited.end());
+      const size_t last = static_cast<size_t>(std::unique(visited.begin() + first, visited.end()) - visited.begin());
+      for (size_t idx = first; idx < last; ++idx)
+      {
+         m_primitives[visited[idx]]->BoundaryCrossings(r, tMin, tMax, crossings);
+      }
+
+      visited.resize(first);
+   }
+
+   // Closest hit traversal over a non-empty node array. PrimitiveHit is called as primitiveHit(index, ray, tMin, tMax, rec)
+   // so that primitives which are not Hittable objects can be traversed the same way.
+   template<typename PrimitiveHit>
+   static bool Traverse(const FlatBVHNode* nodes, const uint32_t* primitiveIndices,
+      const Ray& r, double tMin, double tMax, HitRecord& rec, const PrimitiveHit& primitiveHit)
+   {
+      const bool bDirIsNeg[3] = { r.Direction.x < 0.0, r.Direction.y < 0.0, r.Direction.z < 0.0 };
+      bool bHitAnything = false;
+      uint32_t toVisit[BVHBuildConstants::TraversalStackSize];
+      size_t toVisitCount = 0;
+      uint32_t current = 0;
+      while (true)
+      {
+         const FlatBVHNode& node = nodes[current];
+         if (node.Bounds.Hit(r, tMin, tMax))
+         {
+            if (node.IsLeaf())
+            {
+               for (uint32_t idx = 0; idx < node.PrimitiveCount; ++idx)
+               {
+                  if (primitiveHit(primitiveIndices[node.Offset + idx], r, tMin, tMax, rec))
+                  {
+                     bHitAnything = true;
+                     tMax = rec.t;
+                  }
+               }
+            }
+            else if (bDirIsNeg[node.Axis])
+            {
+               // Visit second child first, since it lies closer along this axis.
+               assert(toVisitCount < BVHBuildConstants::TraversalStackSize);
+               toVisit[toVisitCount++] = current + 1;
+               current = node.Offset;
+               continue;
+            }
+            else
+            {
+               assert(toVisitCount < BVHBuildConstants::TraversalStackSize);
+               toVisit[toVisitCount++] = node.Offset;
+               current = current + 1;
+               continue;
+            }
+         }
+
+         if (toVisitCount == 0)
+         {
+            break;
+         }
+
+         current = toVisit[--toVisitCount];
+      }
+
+      return bHitAnything;
+   }
+
+   // Calls visit(index) for every primitive of the leaves r passes through between tMin and tMax of a non-empty node
+   // array, where Traverse stops at the closest hit. A primitive that spatial splits put in several leaves is visited
+   // once for each of them.
+   template<typename PrimitiveVisit>
+   static void VisitPrimitives(const FlatBVHNode* nodes, const uint32_t* primitiveIndices,
+      const Ray& r, double tMin, double tMax, const PrimitiveVisit& visit)
+   {
+      uint32_t toVisit[BVHBuildConstants::TraversalStackSize];
+      size_t toVisitCount = 0;
+      uint32_t current = 0;
+      while (true)
+      {
+         const FlatBVHNode& node = nodes[current];
+         if (node.Bounds.Hit(r, tMin, tMax))
+         {
+            if (node.IsLeaf())
+            {
+               for (uint32_t idx = 0; idx < node.PrimitiveCount; ++idx)
+               {
+                  visit(primitiveIndices[node.Offset + idx]);
+               }
+            }
+            else
+            {
+               assert(toVisitCount < BVHBuildConstants::TraversalStackSize);
+               toVisit[toVisitCount++] = node.Offset;
+               current = current + 1;
+               continue;
+            }
+         }
+
+         if (toVisitCount == 0)
+         {
+            break;
+         }
+
+         current = toVisit[--toVisitCount];
+      }
+   }
+
+   // Packet traversal for coherent packets of the sizes of RayPacketConstants::Sizes, ray by ray for the rest.
+   template<typename PrimitiveHit>
+   static uint32_t TracePacket(const FlatBVHNode* nodes, const uint32_t* primitiveIndices, const RayPacket& packet,
+      double tMin, HitRecord* recs, const PrimitiveHit& primitiveHit)
+   {
+      if (packet.bCoherent)
+      {
+         switch (packet.Size)
+         {
+         case 4:
+            return TraversePacket<4>(nodes, primitiveIndices, packet, tMin, recs, primitiveHit);
+         case 8:
+            return TraversePacket<8>(nodes, primitiveIndices, packet, tMin, recs, primitiveHit);
+         case 16:
+            return TraversePacket<16>(nodes, primitiveIndices, packet, tMin, recs, primitiveHit);
+         default:
+            break;
+         }
+      }
+
+      uint32_t hits = 0;
+      for (size_t lane = 0; lane < packet.Size; ++lane)
+      {
+         if (Traverse(nodes, primitiveIndices, packet.Rays[lane], tMin, Infinity, recs[lane], primitiveHit))
+         {
+            hits |= 1u << lane;
+         }
+      }
+
+      return hits;
+   }
+
+   // Closest hits of a coherent packet of N rays. Each stack entry carries the mask of rays which hit the parent, and
+   // every ray is tested against exactly the nodes and primitives it visits in Traverse, in the same order, so hits
+   // are identical to tracing the rays one by one. What is saved is fetching and ordering nodes once per packet, and
+   // testing each of them once for the whole packet when interval culling shows that no ray can hit it.
+   template<size_t N, typename PrimitiveHit>
+   static uint32_t TraversePacket(const FlatBVHNode* nodes, const uint32_t* primitiveIndices, const RayPacket& packet,
+      double tMin, HitRecord* recs, const PrimitiveHit& primitiveHit)
+   {
+      static_assert(N <= RayPacketConstants::MaximumSize, "Packet is larger than RayPacket.");
+      struct StackEntry
+      {
+      public:
+         uint32_t Node;
+         uint32_t Mask;
+
+      };
+
+      double tMaxs[N];
+      std::fill(tMaxs, tMaxs + N, Infinity);
+      uint32_t hits = 0;
+      StackEntry toVisit[BVHBuildConstants::TraversalStackSize];
+      size_t toVisitCount = 0;
+      uint32_t current = 0;
+      uint32_t mask = (1u << N) - 1;
+      while (true)
+      {
+         // Nodes are mostly hit by all rays or by none. When the first ray hits, every ray is tested; otherwise the
+         // interval test tries to rule out the whole packet first.
+         const FlatBVHNode& node = nodes[current];
+         const size_t firstLane = static_cast<size_t>(std::countr_zero(mask));
+         RT_STAT_INCREMENT(StatCounter::AABBTests);
+         bool bMayHit = node.Bounds.Hit(packet.Rays[firstLane], packet.GetInvDirection(firstLane), tMin, tMaxs[firstLane]);
+         if (!bMayHit)
+         {
+            double packetMax = -Infinity;
+            for (size_t lane = 0; lane < N; ++lane)
+            {
+               packetMax = (mask >> lane) & 1 ? std::max(packetMax, tMaxs[lane]) : packetMax;
+            }
+
+            bMayHit = packet.MayHit(node.Bounds, tMin, packetMax);
+         }
+
+         mask = bMayHit ? packet.HitMask<N>(node.Bounds, tMin, tMaxs, mask) : 0;
+         if (mask != 0)
+         {
+            if (node.IsLeaf())
+            {
+               for (uint32_t idx = 0; idx < node.PrimitiveCount; ++idx)
+               {
+                  const uint32_t primitiveIdx = primitiveIndices[node.Offset + idx];
+                  for (size_t lane = 0; lane < N; ++lane)
+                  {
+                     if ((mask >> lane) & 1 && primitiveHit(primitiveIdx, packet.Rays[lane], tMin, tMaxs[lane], recs[lane]))
+                     {
+                        hits |= 1u << lane;
+                        tMaxs[lane] = recs[lane].t;
+                     }
+                  }
+               }
+            }
+            else if (packet.bNegative[node.Axis])
+            {
+               assert(toVisitCount < BVHBuildConstants::TraversalStackSize);
+               toVisit[toVisitCount++] = StackEntry{ current + 1, mask };
+               current = node.Offset;
+               continue;
+            }
+            else
+            {
+               assert(toVisitCount < BVHBuildConstants::TraversalStackSize);
+               toVisit[toVisitCount++] = StackEntry{ node.Offset, mask };
+               current = current + 1;
+               continue;
+            }
+         }
+
+         if (toVisitCount == 0)
+         {
+            break;
+         }
+
+         --toVisitCount;
+         current = toVisit[toVisitCount].Node;
+         mask = toVisit[toVisitCount].Mask;
+      }
+
+      return hits;
+   }
+
+   bool BoundingBox(double time0, double time1, AABB& outputBox) const override
+   {
+      if (m_nodeCount == 0)
+      {
+         return false;
+      }
+
+      outputBox = m_nodes[0].Bounds;
+      return true;
+   }
+
+   const FlatBVHNode* GetNodes() const { return m_nodes; }
+   size_t GetNodeCount() const { return m_nodeCount; }
+   const uint32_t* GetPrimitiveIndices() const { return m_primitiveIndices; }
+   size_t GetPrimitiveIndexCount() const
+   {
+      size_t count = 0;
+      for (size_t idx = 0; idx < m_nodeCount; ++idx)
+      {
+         count += m_nodes[idx].PrimitiveCount;
+      }
+
+      return count;
+   }
+
+   const std::vector<std::shared_ptr<Hittable>>& GetPrimitives() const { return m_primitives; }
+
+   static std::vector<BVHPrimitiveInfo> GatherPrimitiveInfos(const std::vector<std::shared_ptr<Hittable>>& primitives, double time0, double time1)
+   {
+      std::vector<BVHPrimitiveInfo> infos;
+      infos.reserve(primitives.size());
+      for (size_t idx = 0; idx < primitives.size(); ++idx)
+      {
+         AABB box;
+         if (!primitives[idx]->BoundingBox(time0, time1, box))
+         {
+            std::cerr << "No bounding box in FlatBVH constructor! \n";
+         }
+
+         infos.emplace_back(static_cast<uint32_t>(idx), box);
+      }
+
+      return infos;
+   }
+
+   static FlatBVHData Build(std::vector<BVHPrimitiveInfo> infos, const std::vector<std::shared_ptr<Hittable>>& primitives,
+      double time0, double time1, BVHBuildMethod method)
+   {
+      switch (method)
+      {
+      case BVHBuildMethod::LBVH:
+      case BVHBuildMethod::LBVH63:
+      case BVHBuildMethod::TreeletLBVH:
+      {
+         // Morton code hierarchies have no depth limit of their own; fall back to SAH in the rare case of one too deep
+         // for the traversal stack.
+         FlatBVHData data = method == BVHBuildMethod::LBVH ?
+            LBVHBuilder<uint32_t>(infos, false).Build() :
+            LBVHBuilder<uint64_t>(infos, method == BVHBuildMethod::TreeletLBVH).Build();
+         if (ValidateFlatBVHNodes(data.Nodes.data(), data.Nodes.size(), data.PrimitiveIndices.size()))
+         {
+            return data;
+         }
+
+         std::cerr << "LBVH is too deep for traversal; building with SAH instead.\n";
+         return SAHBVHBuilder(std::move(infos)).Build();
+      }
+      case BVHBuildMethod::SBVH:
+         return SBVHBuilder(std::move(infos), primitives, time0, time1).Build();
+      case BVHBuildMethod::SAH:
+      default:
+         return SAHBVHBuilder(std::move(infos)).Build();
+      }
+   }
+
+private:
+   std::vector<std::shared_ptr<Hittable>> m_primitives;
+   FlatBVHData m_ownedData;
+   std::shared_ptr<MappedFile> m_mapping;
+   const FlatBVHNode* m_nodes = nullptr;
+   size_t m_nodeCount = 0;
+   const uint32_t* m_primitiveIndices = nullptr;
+   bool m_bSharedPrimitives = false; // Some primitives are in several leaves, as spatial splits leave them
+
+};
@@ -0,0 +1,191 @@
+#pragma once
+#include <Core/CoreMinimal.h>
+#include <Core/Color.h>
+#include <Core/HDRImage.h>
+#include <istream>
+#include <ostream>
+
+namespace FramebufferConstants
+{
+   // Keeps relative error of nearly black pixels finite.
+   constexpr double RelativeErrorEpsilon = 1e-2;
+}
+
+// Samples of a single pixel taken by one render pass. Kept in double while sampling and merged into the float
+// framebuffer once per pass. Luminance variance is accumulated with Welford's algorithm.
+struct PixelSamples
+{
+public:
+   void Add(const Color& sample)
+   {
+      Sum += sample;
+      ++Count;
+      const double luminance = Luminance(sample);
+      const double delta = luminance - LuminanceMean;
+      LuminanceMean += delta / Count;
+      LuminanceM2 += delta * (luminance - LuminanceMean);
+   }
+
+public:
+   Color Sum;
+   uint32_t Count = 0;
+   double LuminanceMean = 0.0;
+   double LuminanceM2 = 0.0;
+
+};
+
+// Float accumulation buffer of radiance: sum and sample count per pixel, and optionally the running variance of
+// luminance. Pixels are stored row by row from the top. Resolving gives the mean radiance as an HDRImage, which is
+// tonemapped separately, so neither HDR output nor a different tonemap needs another render.
+class Framebuffer
+{
+public:
+   Framebuffer(int width, int height, bool bTrackVariance = false) :
+      m_width(width),
+      m_height(height),
+      m_sums(PixelCount() * 3, 0.0f),
+      m_sampleCounts(PixelCount(), 0)
+   {
+      if (bTrackVariance)
+      {
+         m_luminanceMeans.assign(PixelCount(), 0.0f);
+         m_luminanceM2s.assign(PixelCount(), 0.0f);
+      }
+   }
+
+   // Not thread-safe for the same pixel; every pixel is owned by one thread at a time.
+   void AddSamples(size_t pixelIndex, const PixelSamples& samples)
+   {
+      if (samples.Count == 0)
+      {
+         return;
+      }
+
+      const uint32_t previousCount = m_sampleCounts[pixelIndex];
+      const uint32_t count = previousCount + samples.Count;
+      for (int component = 0; component < 3; ++component)
+      {
+         m_sums[pixelIndex * 3 + component] += static_cast<float>(samples.Sum[component]);
+      }
+
+      if (TracksVariance())
+      {
+         // Chan et al. merge of two sets of moments.
+         const double delta = samples.LuminanceMean - m_luminanceMeans[pixelIndex];
+         const double weight = static_cast<double>(samples.Count) / count;
+         m_luminanceMeans[pixelIndex] = static_cast<float>(m_luminanceMeans[pixelIndex] + delta * weight);
+         m_luminanceM2s[pixelIndex] = static_cast<float>(m_luminanceM2s[pixelIndex] + samples.LuminanceM2 + delta * delta * previousCount * weight);
+      }
+
+      m_sampleCounts[pixelIndex] = count;
+   }
+
+   Color Mean(size_t pixelIndex) const
+   {
+      const uint32_t count = m_sampleCounts[pixelIndex];
+      if (count == 0)
+      {
+         return Color(0.0, 0.0, 0.0);
+      }
+
+      const float* sum = &m_sums[pixelIndex * 3];
+      return Color(sum[0], sum[1], sum[2]) / static_cast<double>(count);
+   }
+
+   // Unbiased sample variance of luminance, zero when variance is not tracked.
+   double Variance(size_t pixelIndex) const
+   {
+      const uint32_t count = m_sampleCounts[pixelIndex];
+      if (!TracksVariance() || count < 2)
+      {
+         return 0.0;
+      }
+
+      return m_luminanceM2s[pixelIndex] / (count - 1.0);
+   }
+
+   // Mean over pixels of the standard error of luminance relative to the luminance itself. Needs variance tracking;
+   // pixels with less than two samples count as fully uncertain.
+   double EstimateRelativeError() const
+   {
+      if (!TracksVariance() || PixelCount() == 0)
+      {
+         return Infinity;
+      }
+
+      double errorSum = 0.0;
+      for (size_t idx = 0; idx < PixelCount(); ++idx)
+      {
+         const uint32_t count = m_sampleCounts[idx];
+         if (count < 2)
+         {
+            errorSum += 1.0;
+            continue;
+         }
+
+         const double standardError = std::sqrt(Variance(idx) / count);
+         errorSum += standardError / (std::abs(m_luminanceMeans[idx]) + FramebufferConstants::RelativeErrorEpsilon);
+      }
+
+      return errorSum / PixelCount();
+   }
+
+   HDRImage Resolve() const
+   {
+      HDRImage image(m_width, m_height);
+      for (size_t idx = 0; idx < PixelCount(); ++idx)
+      {
+         const Color mean = Mean(idx);
+         for (int component = 0; component < 3; ++component)
+         {
+            image.Pixels[idx * 3 + component] = static_cast<float>(mean[component]);
+         }
+      }
+
+      return image;
+   }
+
+   // Raw accumulation state, in the layout of the members. Used by render checkpoints.
+   void Write(std::ostream& stream) const
+   {
+      WriteArray(stream, m_sums);
+      WriteArray(stream, m_sampleCounts);
+      WriteArray(stream, m_luminanceMeans);
+      WriteArray(stream, m_luminanceM2s);
+   }
+
+   bool Read(std::istream& stream)
+   {
+      return ReadArray(stream, m_sums) && ReadArray(stream, m_sampleCounts) &&
+         ReadArray(stream, m_luminanceMeans) && ReadArray(stream, m_luminanceM2s);
+   }
+
+   int GetWidth() const { return m_width; }
+   int GetHeight() const { return m_height; }
+   size_t PixelCount() const { return static_cast<size_t>(m_width) * m_height; }
+   uint32_t SampleCount(size_t pixelIndex) const { return m_sampleCounts[pixelIndex]; }
+   bool TracksVariance() const { return !m_luminanceM2s.empty(); }
+
+private:
+   template<typename T>
+   static void WriteArray(std::ostream& stream, const std::vector<T>& values)
+   {
+      stream.write(reinterpret_cast<const char*>(values.data()), values.size() * sizeof(T));
+   }
+
+   template<typename T>
+   static bool ReadArray(std::istream& stream, std::vector<T>& values)
+   {
+      stream.read(reinterpret_cast<char*>(values.data()), values.size() * sizeof(T));
+      return static_cast<bool>(stream);
+   }
+
+private:
+   int m_width = 0;
+   int m_height = 0;
+   std::vector<float> m_sums; // RGB
+   std::vector<uint32_t> m_sampleCounts;
+   std::vector<float> m_luminanceMeans;
+   std::vector<float> m_luminanceM2s;
+
+};
@@ -0,0 +1,279 @@
+#pragma once
+#include <Core/CoreMinimal.h>
+#include <Core/DensityGrid.h>
+#include <Core/Hittable.h>
+#include <Core/RayHash.h>
+#include <bit>
+
+namespace GridMediumConstants
+{
+   constexpr int MajorantCellSize = 8; // Voxels along each axis of a cell of the majorant grid
+}
+
+// Participating medium whose density varies over a voxel grid (DenseGrid or SparseGrid), interpolated trilinearly
+// between voxel centers and multiplied by a density scale. Free-flight distances are sampled by delta tracking
+// against a coarse grid of majorants, the largest density in each cell of MajorantCellSize^3 voxels: tentative
+// collisions are drawn at the rate of the majorant and kept as real ones with probability density / majorant. The
+// majorant cells are walked by a 3D DDA, so cells without density cost a step and no collision at all, and sparse
+// smoke does not pay for the densest voxel of its box everywhere.
+template<typename Grid>
+class GridMedium : public Hittable
+{
+public:
+   GridMedium(const AABB& bounds, Grid grid, double densityScale, uint32_t phaseFunction,
+      int majorantCellSize = GridMediumConstants::MajorantCellSize) :
+      m_bounds(bounds),
+      m_grid(std::move(grid)),
+      m_densityScale(densityScale),
+      m_phaseFunction(phaseFunction),
+      m_seed(std::bit_cast<uint64_t>(densityScale) ^ MixBits(std::bit_cast<uint64_t>(bounds.Minimum.x)))
+   {
+      const Vec3 extent = bounds.Maximum - bounds.Minimum;
+      for (int axis = 0; axis < 3; ++axis)
+      {
+         const int resolution = m_grid.Resolution(axis);
+         m_cellCount[axis] = (resolution + majorantCellSize - 1) / majorantCellSize;
+         m_worldToVoxel[axis] = resolution / extent[axis];
+         m_worldToCell[axis] = m_worldToVoxel[axis] / majorantCellSize;
+      }
+
+      BuildMajorants(majorantCellSize);
+   }
+
+   bool Hit(const Ray& r, double tMin, double tMax, HitRecord& rec) const override
+   {
+      RT_STAT_INCREMENT(StatCounter::GridMediumTests);
+      if (!m_bounds.Clip(r, tMin, tMax))
+      {
+         return false;
+      }
+
+      RayHashSequence random(r, m_seed);
+      double hitT = Infinity;
+      SampleCollisions(r, tMin, tMax, random, [&](double t, double majorant)
+         {
+            if (random.Next() * majorant < Density(r.At(t)))
+            {
+               hitT = t;
+               return false;
+            }
+
+            return true;
+         });
+
+      if (hitT == Infinity)
+      {
+         return false;
+      }
+
+      rec.t = hitT;
+      rec.p = r.At(hitT);
+      rec.n = Vec3(1.0, 0.0, 0.0);
+      rec.bFrontFace = true;
+      rec.Material = m_phaseFunction;
+      return true;
+   }
+
+   // A medium has no surface to cross.
+   void BoundaryCrossings(const Ray& r, double tMin, double tMax, std::vector<BoundaryCrossing>& crossings) const override
+   {
+   }
+
+   // Fraction of light which crosses the medium between tMin and tMax along r, estimated by ratio tracking: at each
+   // tentative collision drawn as by Hit, the estimate is weighed by the chance that it is a null collision.
+   double Transmittance(const Ray& r, double tMin, double tMax) const
+   {
+      if (!m_bounds.Clip(r, tMin, tMax))
+      {
+         return 1.0;
+      }
+
+      RayHashSequence random(r, ~m_seed);
+      double transmittance = 1.0;
+      SampleCollisions(r, tMin, tMax, random, [&](double t, double majorant)
+         {
+            transmittance *= 1.0 - Density(r.At(t)) / majorant;
+            return true;
+         });
+
+      return transmittance;
+   }
+
+   // Scaled density at p, interpolated between the centers of the eight nearest voxels.
+   double Density(const Point3& p) const
+   {
+      int lower[3];
+      double weights[3];
+      for (int axis = 0; axis < 3; ++axis)
+      {
+         const double voxel = (p[axis] - m_bounds.Minimum[axis]) * m_worldToVoxel[axis] - 0.5;
+         const double floorVoxel = std::floor(voxel);
+         lower[axis] = static_cast<int>(floorVoxel);
+         weights[axis] = voxel - floorVoxel;
+      }
+
+      auto lookup = [this](int x, int y, int z)
+      {
+         return static_cast<double>(m_grid.Lookup(
+            std::clamp(x, 0, m_grid.Resolution(0) - 1),
+            std::clamp(y, 0, m_grid.Resolution(1) - 1),
+            std::clamp(z, 0, m_grid.Resolution(2) - 1)));
+      };
+
+      double density = 0.0;
+      for (int corner = 0; corner < 8; ++corner)
+      {
+         const int dx = corner & 1;
+         const int dy = (corner >> 1) & 1;
+         const int dz = corner >> 2;
+         const double weight = (dx ? weights[0] : 1.0 - weights[0]) * (dy ? weights[1] : 1.0 - weights[1]) * (dz ? weights[2] : 1.0 - weights[2]);
+         density += weight * lookup(lower[0] + dx, lower[1] + dy, lower[2] + dz);
+      }
+
+      return m_densityScale * density;
+   }
+
+   bool BoundingBox(double time0, double time1, AABB& outputBox) const override
+   {
+      outputBox = m_bounds;
+      return true;
+   }
+
+   const Grid& GetGrid() const { return m_grid; }
+
+private:
+   // Largest scaled density of the voxels a point of each cell interpolates between, which reach one voxel past the
+   // cell on every side.
+   void BuildMajorants(int majorantCellSize)
+   {
+      m_majorants.assign(static_cast<size_t>(m_cellCount[0]) * m_cellCount[1] * m_cellCount[2], 0.0);
+      for (int cz = 0; cz < m_cellCount[2]; ++cz)
+      {
+         for (int cy = 0; cy < m_cellCount[1]; ++cy)
+         {
+            for (int cx = 0; cx < m_cellCount[0]; ++cx)
+            {
+               const int cell[3] = { cx, cy, cz };
+               int first[3], last[3];
+               for (int axis = 0; axis < 3; ++axis)
+               {
+                  first[axis] = std::max(cell[axis] * majorantCellSize - 1, 0);
+                  last[axis] = std::min((cell[axis] + 1) * majorantCellSize, m_grid.Resolution(axis) - 1);
+               }
+
+               float majorant = 0.0f;
+               for (int z = first[2]; z <= last[2]; ++z)
+               {
+                  for (int y = first[1]; y <= last[1]; ++y)
+                  {
+                     for (int x = first[0]; x <= last[0]; ++x)
+                     {
+                        majorant = std::max(majorant, m_grid.Lookup(x, y, z));
+                     }
+                  }
+               }
+
+               m_majorants[(static_cast<size_t>(cz) * m_cellCount[1] + cy) * m_cellCount[0] + cx] = m_densityScale * majorant;
+            }
+         }
+      }
+   }
+
+   // Calls collide(t, majorant) at the tentative collisions along r between tMin and tMax, drawn from random at the
+   // rate of the majorant of each cell, until it returns false. Optical depth left to the next collision carries over
+   // from one cell into the next, and cells without density are crossed without drawing anything.
+   template<typename Collide>
+   void SampleCollisions(const Ray& r, double tMin, double tMax, RayHashSequence& random, const Collide& collide) const
+   {
+      const double rayLength = r.Direction.Length();
+      double opticalDepth = -std::log(random.Next());
+      TraverseMajorants(r, tMin, tMax, [&](double cellBegin, double cellEnd, double majorant)
+         {
+            if (majorant <= 0.0)
+            {
+               return true;
+            }
+
+            const double rate = majorant * rayLength;
+            double t = cellBegin;
+            while (opticalDepth < rate * (cellEnd - t))
+            {
+               t += opticalDepth / rate;
+               if (!collide(t, majorant))
+               {
+                  return false;
+               }
+
+               opticalDepth = -std::log(random.Next());
+            }
+
+            opticalDepth -= rate * (cellEnd - t);
+            return true;
+         });
+   }
+
+   // Calls visit(cellBegin, cellEnd, majorant) for the majorant cells r crosses between tMin and tMax, in order, until
+   // it returns false.
+   template<typename Visit>
+   void TraverseMajorants(const Ray& r, double tMin, double tMax, const Visit& visit) const
+   {
+      int cell[3], step[3];
+      double tNext[3], tDelta[3];
+      for (int axis = 0; axis < 3; ++axis)
+      {
+         const double origin = (r.Origin[axis] - m_bounds.Minimum[axis]) * m_worldToCell[axis];
+         const double direction = r.Direction[axis] * m_worldToCell[axis];
+         cell[axis] = std::clamp(static_cast<int>(std::floor(origin + tMin * direction)), 0, m_cellCount[axis] - 1);
+         if (direction > 0.0)
+         {
+            step[axis] = 1;
+            tNext[axis] = (cell[axis] + 1 - origin) / direction;
+            tDelta[axis] = 1.0 / direction;
+         }
+         else if (direction < 0.0)
+         {
+            step[axis] = -1;
+            tNext[axis] = (cell[axis] - origin) / direction;
+            tDelta[axis] = -1.0 / direction;
+         }
+         else
+         {
+            step[axis] = 0;
+            tNext[axis] = Infinity;
+            tDelta[axis] = Infinity;
+         }
+      }
+
+      for (double t = tMin; t < tMax; )
+      {
+         const int axis = tNext[0] < tNext[1] ? (tNext[0] < tNext[2] ? 0 : 2) : (tNext[1] < tNext[2] ? 1 : 2);
+         const double cellEnd = std::min(tNext[axis], tMax);
+         const double majorant = m_majorants[(static_cast<size_t>(cell[2]) * m_cellCount[1] + cell[1]) * m_cellCount[0] + cell[0]];
+         if (cellEnd > t && !visit(t, cellEnd, majorant))
+         {
+            return;
+         }
+
+         t = cellEnd;
+         cell[axis] += step[axis];
+         if (cell[axis] < 0 || cell[axis] >= m_cellCount[axis])
+         {
+            return;
+         }
+
+         tNext[axis] += tDelta[axis];
+      }
+   }
+
+private:
+   AABB m_bounds;
+   Grid m_grid;
+   double m_densityScale;
+   uint32_t m_phaseFunction;
+   uint64_t m_seed;
+   int m_cellCount[3];
+   double m_worldToVoxel[3];
+   double m_worldToCell[3];
+   std::vector<double> m_majorants;
+
+};
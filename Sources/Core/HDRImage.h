@@ -0,0 +1,245 @@
+#pragma once
+#include <Core/CoreMinimal.h>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+
+// Linear RGB float image, stored row by row from the top. Written as PFM or as uncompressed single-part scanline
+// OpenEXR with 32-bit float channels, which every HDR viewer reads; PFM can be read back for tonemapping.
+struct HDRImage
+{
+public:
+   HDRImage() = default;
+   HDRImage(int width, int height) :
+      Width(width),
+      Height(height),
+      Pixels(static_cast<size_t>(width) * height * 3, 0.0f)
+   {
+   }
+
+   // Picks the format from the extension, '.exr' or '.pfm'.
+   bool Write(const std::filesystem::path& path) const
+   {
+      if (path.extension() == ".exr")
+      {
+         return WriteEXR(path);
+      }
+      else if (path.extension() == ".pfm")
+      {
+         return WritePFM(path);
+      }
+
+      std::cerr << "Unknown HDR image format of '" << path.string() << "'. Use .exr or .pfm.\n";
+      return false;
+   }
+
+   bool WritePFM(const std::filesystem::path& path) const
+   {
+      std::ofstream stream(path, std::ios::binary | std::ios::trunc);
+      if (!stream)
+      {
+         std::cerr << "Failed to write HDR image '" << path.string() << "'.\n";
+         return false;
+      }
+
+      // Negative scale marks little-endian data. Rows are stored from the bottom.
+      stream << "PF\n" << Width << ' ' << Height << "\n-1.0\n";
+      for (int y = Height - 1; y >= 0; --y)
+      {
+         WriteLittleEndian(stream, &Pixels[static_cast<size_t>(y) * Width * 3], static_cast<size_t>(Width) * 3);
+      }
+
+      if (!stream)
+      {
+         std::cerr << "Failed to write HDR image '" << path.string() << "'.\n";
+         return false;
+      }
+
+      return true;
+   }
+
+   bool WriteEXR(const std::filesystem::path& path) const
+   {
+      std::string header;
+      auto appendInt = [&header](int32_t value) { AppendLittleEndian(header, value); };
+      auto appendFloat = [&header](float value) { AppendLittleEndian(header, value); };
+      auto beginAttribute = [&header, &appendInt](const char* name, const char* type, int32_t size)
+      {
+         header.append(name, std::strlen(name) + 1);
+         header.append(type, std::strlen(type) + 1);
+         appendInt(size);
+      };
+
+      constexpr int32_t magic = 20000630;
+      constexpr int32_t version = 2; // Single-part scanline file
+      appendInt(magic);
+      appendInt(version);
+
+      // Channels must be sorted by name.
+      constexpr int32_t pixelTypeFloat = 2;
+      constexpr const char* channelNames[3] = { "B", "G", "R" };
+      beginAttribute("channels", "chlist", 3 * 18 + 1);
+      for (const char* name : channelNames)
+      {
+         header.append(name, 2);
+         appendInt(pixelTypeFloat);
+         header.append(4, '\0'); // pLinear and reserved
+         appendInt(1); // x sampling
+         appendInt(1); // y sampling
+      }
+      header.push_back('\0');
+
+      beginAttribute("compression", "compression", 1);
+      header.push_back('\0'); // NO_COMPRESSION
+      for (const char* window : { "dataWindow", "displayWindow" })
+      {
+         beginAttribute(window, "box2i", 16);
+         appendInt(0);
+         appendInt(0);
+         appendInt(Width - 1);
+         appendInt(Height - 1);
+      }
+
+      beginAttribute("lineOrder", "lineOrder", 1);
+      header.push_back('\0'); // INCREASING_Y
+      beginAttribute("pixelAspectRatio", "float", 4);
+      appendFloat(1.0f);
+      beginAttribute("screenWindowCenter", "v2f", 8);
+      appendFloat(0.0f);
+      appendFloat(0.0f);
+      beginAttribute("screenWindowWidth", "float", 4);
+      appendFloat(1.0f);
+      header.push_back('\0');
+
+      // Offset table, then one block per scanline: y, size of data and the scanline channel by channel.
+      const int32_t scanlineSize = Width * 3 * static_cast<int32_t>(sizeof(float));
+      const uint64_t firstBlock = header.size() + static_cast<uint64_t>(Height) * sizeof(uint64_t);
+      for (int y = 0; y < Height; ++y)
+      {
+         AppendLittleEndian(header, firstBlock + static_cast<uint64_t>(y) * (2 * sizeof(int32_t) + scanlineSize));
+      }
+
+      std::ofstream stream(path, std::ios::binary | std::ios::trunc);
+      if (!stream)
+      {
+         std::cerr << "Failed to write HDR image '" << path.string() << "'.\n";
+         return false;
+      }
+
+      stream.write(header.data(), header.size());
+      std::vector<float> channel(Width);
+      for (int y = 0; y < Height; ++y)
+      {
+         std::string blockHeader;
+         AppendLittleEndian(blockHeader, static_cast<int32_t>(y));
+         AppendLittleEndian(blockHeader, scanlineSize);
+         stream.write(blockHeader.data(), blockHeader.size());
+         for (int component : { 2, 1, 0 })
+         {
+            for (int x = 0; x < Width; ++x)
+            {
+               channel[x] = Pixels[(static_cast<size_t>(y) * Width + x) * 3 + component];
+            }
+
+            WriteLittleEndian(stream, channel.data(), channel.size());
+         }
+      }
+
+      if (!stream)
+      {
+         std::cerr << "Failed to write HDR image '" << path.string() << "'.\n";
+         return false;
+      }
+
+      return true;
+   }
+
+   static bool ReadPFM(const std::filesystem::path& path, HDRImage& output)
+   {
+      std::ifstream stream(path, std::ios::binary);
+      std::string magic;
+      double scale = 0.0;
+      int width = 0;
+      int height = 0;
+      if (!(stream >> magic >> width >> height >> scale) || magic != "PF" || width <= 0 || height <= 0 || scale == 0.0)
+      {
+         std::cerr << "Failed to read PFM image '" << path.string() << "'.\n";
+         return false;
+      }
+
+      stream.get(); // Single whitespace before data
+      const bool bLittleEndian = scale < 0.0;
+      output = HDRImage(width, height);
+      for (int y = height - 1; y >= 0; --y)
+      {
+         float* row = &output.Pixels[static_cast<size_t>(y) * width * 3];
+         stream.read(reinterpret_cast<char*>(row), static_cast<std::streamsize>(width) * 3 * sizeof(float));
+         if (bLittleEndian != IsLittleEndian())
+         {
+            for (int idx = 0; idx < width * 3; ++idx)
+            {
+               row[idx] = SwapBytes(row[idx]);
+            }
+         }
+      }
+
+      if (!stream)
+      {
+         std::cerr << "Failed to read PFM image '" << path.string() << "'.\n";
+         return false;
+      }
+
+      return true;
+   }
+
+private:
+   static bool IsLittleEndian()
+   {
+      const uint16_t value = 1;
+      uint8_t firstByte = 0;
+      std::memcpy(&firstByte, &value, 1);
+      return firstByte == 1;
+   }
+
+   template<typename T>
+   static T SwapBytes(T value)
+   {
+      uint8_t bytes[sizeof(T)];
+      std::memcpy(bytes, &value, sizeof(T));
+      std::reverse(bytes, bytes + sizeof(T));
+      std::memcpy(&value, bytes, sizeof(T));
+      return value;
+   }
+
+   template<typename T>
+   static void AppendLittleEndian(std::string& buffer, T value)
+   {
+      if (!IsLittleEndian())
+      {
+         value = SwapBytes(value);
+      }
+
+      buffer.append(reinterpret_cast<const char*>(&value), sizeof(T));
+   }
+
+   static void WriteLittleEndian(std::ofstream& stream, const float* values, size_t count)
+   {
+      if (IsLittleEndian())
+      {
+         stream.write(reinterpret_cast<const char*>(values), count * sizeof(float));
+         return;
+      }
+
+      for (size_t idx = 0; idx < count; ++idx)
+      {
+         const float swapped = SwapBytes(values[idx]);
+         stream.write(reinterpret_cast<const char*>(&swapped), sizeof(float));
+      }
+   }
+
+public:
+   int Width = 0;
+   int Height = 0;
+   std::vector<float> Pixels; // RGB
+
+};
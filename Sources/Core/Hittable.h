@@ -2,6 +2,12 @@
 #include <Core/CoreMinimal.h>
 #include <Math/Ray.h>
 #include <Math/AABB.h>
+#include <Math/RayPacket.h>
+
+namespace HittableConstants
+{
+   constexpr double CrossingStep = 0.0001; // How far past a hit the default BoundaryCrossings looks for the next one
+}
 
 struct HitRecord
 {
@@ -15,7 +21,7 @@ public:
 public:
    Point3 p;
    Vec3 n;
-   std::shared_ptr<class Material> MatPtr;
+   uint32_t Material = 0; // Index in the MaterialTable of the scene
    double t = 0.0;
    double u = 0.0;
    double v = 0.0;
@@ -23,10 +29,60 @@ public:
 
 };
 
+// Point at t along a ray where it crosses the surface of an object, into the object or out of it.
+struct BoundaryCrossing
+{
+public:
+   double t = 0.0;
+   bool bEntering = false; // Against the outward normal
+
+};
+
 class Hittable
 {
 public:
    virtual bool Hit(const Ray& r, double tMin, double tMax, HitRecord& rec) const = 0;
    virtual bool BoundingBox(double time0, double time1, AABB& outputBox) const = 0;
 
+   // Closest hits of the rays of packet beyond tMin, each exactly what Hit finds for the ray alone. Bit i of the
+   // result is set when ray i hit something. Acceleration structures override it to trace the rays together.
+   virtual uint32_t HitPacket(const RayPacket& packet, double tMin, HitRecord* recs) const
+   {
+      uint32_t hits = 0;
+      for (size_t lane = 0; lane < packet.Size; ++lane)
+      {
+         if (Hit(packet.Rays[lane], tMin, Infinity, recs[lane]))
+         {
+            hits |= 1u << lane;
+         }
+      }
+
+      return hits;
+   }
+
+   // Appends every point between tMin and tMax where r crosses the surface of this object, in any order, in a single
+   // traversal. Media take the parts of a ray inside their boundary from these. By default it walks from hit to hit,
+   // stepping past each so that sides meeting at an edge count once.
+   virtual void BoundaryCrossings(const Ray& r, double tMin, double tMax, std::vector<BoundaryCrossing>& crossings) const
+   {
+      HitRecord rec;
+      while (Hit(r, tMin, tMax, rec))
+      {
+         crossings.push_back({ rec.t, rec.bFrontFace });
+         tMin = rec.t + HittableConstants::CrossingStep;
+      }
+   }
+
+   // Bounds of the part of this object inside clipBox. Used by spatial split BVH builds.
+   virtual bool ClippedBoundingBox(double time0, double time1, const AABB& clipBox, AABB& outputBox) const
+   {
+      if (!BoundingBox(time0, time1, outputBox))
+      {
+         return false;
+      }
+
+      outputBox = AABB::Intersection(outputBox, clipBox);
+      return !outputBox.IsEmpty();
+   }
+
 };
\ No newline at end of file
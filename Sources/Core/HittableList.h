@@ -19,7 +19,7 @@ public:
 
    void Add(std::shared_ptr<Hittable> object)
    {
-      m_objects.push_back(object);
+      m_objects.push_back(std::move(object));
    }
 
    std::vector<std::shared_ptr<Hittable>>& GetObjects() { return m_objects; }
@@ -44,6 +44,14 @@ public:
       return bHitAnything;
    }
 
+   void BoundaryCrossings(const Ray& r, double tMin, double tMax, std::vector<BoundaryCrossing>& crossings) const override
+   {
+      for (const auto& object : m_objects)
+      {
+         object->BoundaryCrossings(r, tMin, tMax, crossings);
+      }
+   }
+
    bool BoundingBox(double time0, double time1, AABB& outputBox) const override
    {
       if (m_objects.empty())
@@ -58,9 +66,11 @@ public:
       {
          if (!object->BoundingBox(time0, time1, tempBox))
          {
-            outputBox = bFirstBox ? tempBox : AABB::SurroundingBox(tempBox, outputBox);
-            bFirstBox = false;
+            return false;
          }
+
+         outputBox = bFirstBox ? tempBox : AABB::SurroundingBox(tempBox, outputBox);
+         bFirstBox = false;
       }
 
       return true;
@@ -1,12 +1,14 @@
 #pragma once
 #include <Core/Texture.h>
+#include <string_view>
 
 namespace ImageTextureConstants
 {
    constexpr int BytesPerPixel = 3;
 }
 
-class ImageTexture : public Texture
+// Pixels of an image texture, looked up by Texture records of type Image.
+class ImageTexture
 {
 public:
    ImageTexture() = default;
@@ -24,12 +26,15 @@ public:
       }
    }
 
-   virtual ~ImageTexture()
+   ImageTexture(const ImageTexture&) = delete;
+   ImageTexture& operator=(const ImageTexture&) = delete;
+
+   ~ImageTexture()
    {
-      delete m_data;
+      stbi_image_free(m_data);
    }
 
-   Color Value(double u, double v, const Point3& p) const override
+   Color Value(double u, double v) const
    {
       if (m_data == nullptr)
       {
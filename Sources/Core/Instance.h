@@ -12,6 +12,7 @@ public:
 
    bool Hit(const Ray& r, double tMin, double tMax, HitRecord& rec) const override
    {
+      RT_STAT_INCREMENT(StatCounter::InstanceTests);
       Ray movedRay = Ray(r.Origin - m_displacement, r.Direction, r.Time);
       if (!m_src->Hit(movedRay, tMin, tMax, rec))
       {
@@ -23,6 +24,12 @@ public:
       return true;
    }
 
+   void BoundaryCrossings(const Ray& r, double tMin, double tMax, std::vector<BoundaryCrossing>& crossings) const override
+   {
+      RT_STAT_INCREMENT(StatCounter::InstanceTests);
+      m_src->BoundaryCrossings(Ray(r.Origin - m_displacement, r.Direction, r.Time), tMin, tMax, crossings);
+   }
+
    bool BoundingBox(double time0, double time1, AABB& outputBox) const override
    {
       if (!m_src->BoundingBox(time0, time1, outputBox))
@@ -30,7 +37,7 @@ public:
          return false;
       }
 
-      outputBox = AABB(outputBox.Minimum + m_displacement, outputBox.Maximum = m_displacement);
+      outputBox = AABB(outputBox.Minimum + m_displacement, outputBox.Maximum + m_displacement);
       return true;
    }
 
@@ -76,20 +83,14 @@ public:
             }
          }
       }
+
+      m_boundingBox = AABB(min, max);
    }
 
    bool Hit(const Ray& r, double tMin, double tMax, HitRecord& rec) const override
    {
-      Point3 origin = r.Origin;
-      Vec3 direction = r.Direction;
-
-      origin[0] = m_cosTheta * r.Origin[0] - m_sinTheta * r.Origin[2];
-      origin[2] = m_sinTheta * r.Origin[0] + m_cosTheta * r.Origin[2];
-
-      direction[0] = m_cosTheta * r.Direction[0] - m_sinTheta * r.Direction[2];
-      direction[2] = m_sinTheta * r.Direction[0] + m_cosTheta * r.Direction[2];
-
-      Ray rotatedRay = Ray(origin, direction, r.Time);
+      RT_STAT_INCREMENT(StatCounter::InstanceTests);
+      Ray rotatedRay = RotatedRay(r);
       if (!m_src->Hit(rotatedRay, tMin, tMax, rec))
       {
          return false;
@@ -110,12 +111,34 @@ public:
       return true;
    }
 
+   void BoundaryCrossings(const Ray& r, double tMin, double tMax, std::vector<BoundaryCrossing>& crossings) const override
+   {
+      RT_STAT_INCREMENT(StatCounter::InstanceTests);
+      m_src->BoundaryCrossings(RotatedRay(r), tMin, tMax, crossings);
+   }
+
    bool BoundingBox(double time0, double time1, AABB& outputBox) const override
    {
       outputBox = m_boundingBox;
       return m_bHasBox;
    }
 
+private:
+   // r in the space of the source object, passing through the rotated points at the same t.
+   Ray RotatedRay(const Ray& r) const
+   {
+      Point3 origin = r.Origin;
+      Vec3 direction = r.Direction;
+
+      origin[0] = m_cosTheta * r.Origin[0] - m_sinTheta * r.Origin[2];
+      origin[2] = m_sinTheta * r.Origin[0] + m_cosTheta * r.Origin[2];
+
+      direction[0] = m_cosTheta * r.Direction[0] - m_sinTheta * r.Direction[2];
+      direction[2] = m_sinTheta * r.Direction[0] + m_cosTheta * r.Direction[2];
+
+      return Ray(origin, direction, r.Time);
+   }
+
 private:
    std::shared_ptr<Hittable> m_src;
    double m_sinTheta;
@@ -0,0 +1,64 @@
+#pragma once
+#include <Core/CoreMinimal.h>
+#include <Core/Camera.h>
+#include <Core/Color.h>
+#include <Core/Hittable.h>
+#include <Core/MaterialTable.h>
+#include <Core/Profiler.h>
+#include <Core/RenderFeatures.h>
+#include <Core/Sampler.h>
+#include <Core/Statistics.h>
+
+enum class IntegratorType : uint32_t
+{
+   Megakernel = 0, // One path at a time, from camera to the end
+   Wavefront,      // Batches of paths in stages, sorted by material before shading
+   Count
+};
+
+namespace IntegratorConstants
+{
+   constexpr size_t IntegratorCount = static_cast<size_t>(IntegratorType::Count);
+   constexpr const char* IntegratorNames[IntegratorCount] = { "Megakernel", "Wavefront" };
+}
+
+// Radiance along r, at most maximumDepth rays long. Throughput is carried forward rather than returned through
+// recursion, in the same order of operations as WavefrontIntegrator, so both give the same bits. Without Emissives in
+// Features no material emits, and emission isn't looked up.
+template<uint32_t Features = RenderFeatureConstants::AllFeatures>
+Color RayColor(const Ray& r, const Color& background, const Hittable& world, const MaterialTable& materials,
+   int maximumDepth, Sampler& sampler)
+{
+   Color radiance(0.0, 0.0, 0.0);
+   Color throughput(1.0, 1.0, 1.0);
+   Ray ray = r;
+   for (int depth = maximumDepth; depth > 0; --depth)
+   {
+      RT_STAT_INCREMENT(StatCounter::Rays);
+      ++RenderProfiler::ThreadCounters().Rays;
+      HitRecord rec;
+      if (!world.Hit(ray, 0.001, Infinity, rec))
+      {
+         radiance += throughput * background;
+         break;
+      }
+
+      ScatterRecord srec;
+      if constexpr (HasFeature(Features, RenderFeature::Emissives))
+      {
+         radiance += throughput * materials.Emitted(rec.Material, rec.u, rec.v, rec.p);
+      }
+
+      RT_STAT_INCREMENT(StatCounter::ScatterCalls);
+      sampler.StartBounce();
+      if (!materials.Scatter<Features>(rec.Material, ray, rec, sampler, srec))
+      {
+         break;
+      }
+
+      throughput *= srec.Attenuation;
+      ray = srec.Scattered;
+   }
+
+   return radiance;
+}
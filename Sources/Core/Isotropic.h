@@ -1,29 +1,31 @@
 #pragma once
 #include <Math/Ray.h>
+#include <Math/Sampling.h>
 #include <Core/Hittable.h>
 #include <Core/Material.h>
-#include <Core/Texture.h>
+#include <Core/Sampler.h>
 
-class Isotropic : public Material
+class Isotropic
 {
 public:
-   Isotropic(std::shared_ptr<Texture> albedo) :
-      m_albedo(albedo)
+   static bool Scatter(const Color& albedo, const Ray& rayIn, const HitRecord& rec, Sampler& sampler, ScatterRecord& srec)
    {
+      // Phase function is sampled exactly, so the single scattering albedo is the whole weight.
+      srec.Scattered = Ray(rec.p, SampleUniformSphere(sampler.Get2D()), rayIn.Time);
+      srec.Attenuation = albedo;
+      srec.PDF = UniformSpherePDF();
+      srec.bSpecular = false;
+      return true;
    }
 
-   Isotropic(Color albedo) :
-      m_albedo(std::make_shared<SolidColorTexture>(albedo))
+   static Color Eval(const Color& albedo)
    {
+      return albedo * UniformSpherePDF();
    }
 
-   bool Scatter(const Ray& rayIn, const HitRecord& rec, Color& attenuation, Ray& scattered) const override
+   static double PDF()
    {
-      scattered = Ray(rec.p, RandomInUnitSphere(), rayIn.Time);
-      attenuation = m_albedo->Value(rec.u, rec.v, rec.p);
-      return true;
+      return UniformSpherePDF();
    }
 
-private:
-   std::shared_ptr<Texture> m_albedo;
 };
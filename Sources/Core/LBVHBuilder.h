@@ -0,0 +1,499 @@
+#pragma once
+#include <Core/BVHBuildTypes.h>
+#include <atomic>
+#include <bit>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+namespace LBVHConstants
+{
+   constexpr uint32_t InvalidNode = 0xffffffff;
+   constexpr size_t RadixBits = 8;
+   constexpr size_t RadixBuckets = 1 << RadixBits;
+   constexpr size_t MaxTreeletLeaves = 7;
+}
+
+template <typename KeyType>
+struct MortonPrimitive
+{
+public:
+   KeyType Code;
+   uint32_t PrimitiveIndex;
+
+};
+
+// Linear BVH builder after Karras, "Maximizing Parallelism in the Construction of BVHs, Octrees, and k-d Trees" (2012).
+// Primitive centroids are sorted by Morton code and every internal node is emitted independently in linear time.
+// Optional treelet restructuring after Karras and Aila, "Fast Parallel Construction of High-Quality BVHs" (2013).
+template <typename KeyType>
+class LBVHBuilder
+{
+public:
+   static_assert(std::is_same_v<KeyType, uint32_t> || std::is_same_v<KeyType, uint64_t>, "Morton code must be 32 or 64 bits.");
+   static constexpr int BitsPerAxis = std::is_same_v<KeyType, uint32_t> ? 10 : 21; // 30 or 63 bits in total.
+
+   LBVHBuilder(std::vector<BVHPrimitiveInfo> primitives, bool bRestructureTreelets) :
+      m_primitives(std::move(primitives)),
+      m_bRestructureTreelets(bRestructureTreelets)
+   {
+   }
+
+   FlatBVHData Build()
+   {
+      FlatBVHData result;
+      if (m_primitives.empty())
+      {
+         return result;
+      }
+
+      ComputeMortonCodes();
+      RadixSort();
+      EmitHierarchy();
+      ComputeBoundsBottomUp();
+
+      result.Nodes.reserve(m_nodes.size());
+      result.PrimitiveIndices.reserve(m_primitives.size());
+      Flatten(result, RootIndex());
+      return result;
+   }
+
+private:
+   struct Node
+   {
+      AABB Bounds;
+      double Cost = 0.0;
+      uint32_t Left = LBVHConstants::InvalidNode;
+      uint32_t Right = LBVHConstants::InvalidNode;
+      uint32_t Parent = LBVHConstants::InvalidNode;
+      uint32_t PrimitiveCount = 0;
+   };
+
+   // Internal nodes occupy [0, n - 1), leaves occupy [n - 1, 2n - 1). Root is internal node 0 unless n == 1.
+   size_t InternalCount() const { return m_sorted.size() - 1; }
+   uint32_t LeafNodeIndex(size_t sortedIndex) const { return static_cast<uint32_t>(InternalCount() + sortedIndex); }
+   bool IsLeafNode(uint32_t node) const { return node >= InternalCount(); }
+   uint32_t RootIndex() const { return m_sorted.size() == 1 ? LeafNodeIndex(0) : 0; }
+
+   static KeyType ExpandBits(KeyType value)
+   {
+      if constexpr (std::is_same_v<KeyType, uint32_t>)
+      {
+         value = (value | (value << 16)) & 0x030000FF;
+         value = (value | (value << 8)) & 0x0300F00F;
+         value = (value | (value << 4)) & 0x030C30C3;
+         value = (value | (value << 2)) & 0x09249249;
+      }
+      else
+      {
+         value &= 0x1FFFFF;
+         value = (value | (value << 32)) & 0x1F00000000FFFFull;
+         value = (value | (value << 16)) & 0x1F0000FF0000FFull;
+         value = (value | (value << 8)) & 0x100F00F00F00F00Full;
+         value = (value | (value << 4)) & 0x10C30C30C30C30C3ull;
+         value = (value | (value << 2)) & 0x1249249249249249ull;
+      }
+
+      return value;
+   }
+
+   void ComputeMortonCodes()
+   {
+      AABB centroidBounds = AABB::Empty();
+      for (const auto& info : m_primitives)
+      {
+         centroidBounds = AABB::SurroundingBox(centroidBounds, AABB(info.Centroid, info.Centroid));
+      }
+
+      constexpr double MortonScale = static_cast<double>(1 << BitsPerAxis);
+      const Vec3 extent = centroidBounds.Maximum - centroidBounds.Minimum;
+      const auto count = static_cast<int64_t>(m_primitives.size());
+      m_sorted.resize(m_primitives.size());
+
+#pragma omp parallel for
+      for (int64_t idx = 0; idx < count; ++idx)
+      {
+         KeyType code = 0;
+         for (int axis = 0; axis < 3; ++axis)
+         {
+            double offset = extent[axis] > 0.0 ? (m_primitives[idx].Centroid[axis] - centroidBounds.Minimum[axis]) / extent[axis] : 0.0;
+            auto quantized = static_cast<KeyType>(std::clamp(offset * MortonScale, 0.0, MortonScale - 1.0));
+            code |= ExpandBits(quantized) << axis;
+         }
+
+         m_sorted[idx] = MortonPrimitive<KeyType>{ code, static_cast<uint32_t>(idx) };
+      }
+   }
+
+   // LSD radix sort; every pass computes per-thread histograms over contiguous chunks, so scattering stays stable.
+   void RadixSort()
+   {
+      constexpr size_t KeyBits = 3 * BitsPerAxis;
+      constexpr size_t Passes = (KeyBits + LBVHConstants::RadixBits - 1) / LBVHConstants::RadixBits;
+
+      std::vector<MortonPrimitive<KeyType>> temp(m_sorted.size());
+      const auto count = static_cast<int64_t>(m_sorted.size());
+      for (size_t pass = 0; pass < Passes; ++pass)
+      {
+         const size_t shift = pass * LBVHConstants::RadixBits;
+         std::vector<std::vector<size_t>> histograms;
+
+#pragma omp parallel
+         {
+#ifdef _OPENMP
+            const int threadCount = omp_get_num_threads();
+            const int thread = omp_get_thread_num();
+#else
+            const int threadCount = 1;
+            const int thread = 0;
+#endif
+
+#pragma omp single
+            histograms.assign(threadCount, std::vector<size_t>(LBVHConstants::RadixBuckets, 0));
+
+            const int64_t chunkBegin = count * thread / threadCount;
+            const int64_t chunkEnd = count * (thread + 1) / threadCount;
+            auto& histogram = histograms[thread];
+            for (int64_t idx = chunkBegin; idx < chunkEnd; ++idx)
+            {
+               ++histogram[(m_sorted[idx].Code >> shift) & (LBVHConstants::RadixBuckets - 1)];
+            }
+
+#pragma omp barrier
+#pragma omp single
+            {
+               size_t offset = 0;
+               for (size_t bucket = 0; bucket < LBVHConstants::RadixBuckets; ++bucket)
+               {
+                  for (auto& threadHistogram : histograms)
+                  {
+                     size_t bucketCount = threadHistogram[bucket];
+                     threadHistogram[bucket] = offset;
+                     offset += bucketCount;
+                  }
+               }
+            }
+
+            for (int64_t idx = chunkBegin; idx < chunkEnd; ++idx)
+            {
+               temp[histogram[(m_sorted[idx].Code >> shift) & (LBVHConstants::RadixBuckets - 1)]++] = m_sorted[idx];
+            }
+         }
+
+         std::swap(m_sorted, temp);
+      }
+   }
+
+   // Length of common prefix of sorted keys i and j; ties are broken by index so that every key is unique.
+   int Delta(int64_t i, int64_t j) const
+   {
+      if (j < 0 || j >= static_cast<int64_t>(m_sorted.size()))
+      {
+         return -1;
+      }
+
+      KeyType diff = m_sorted[i].Code ^ m_sorted[j].Code;
+      if (diff == 0)
+      {
+         return static_cast<int>(8 * sizeof(KeyType)) + std::countl_zero(static_cast<uint64_t>(i ^ j));
+      }
+
+      return std::countl_zero(diff);
+   }
+
+   void EmitHierarchy()
+   {
+      m_nodes.assign(2 * m_sorted.size() - 1, Node());
+      const auto internalCount = static_cast<int64_t>(InternalCount());
+
+#pragma omp parallel for
+      for (int64_t i = 0; i < internalCount; ++i)
+      {
+         // Direction of the range covered by this node.
+         const int64_t d = (Delta(i, i + 1) - Delta(i, i - 1)) > 0 ? 1 : -1;
+         const int deltaMin = Delta(i, i - d);
+
+         int64_t lengthMax = 2;
+         while (Delta(i, i + lengthMax * d) > deltaMin)
+         {
+            lengthMax *= 2;
+         }
+
+         int64_t length = 0;
+         for (int64_t step = lengthMax / 2; step >= 1; step /= 2)
+         {
+            if (Delta(i, i + (length + step) * d) > deltaMin)
+            {
+               length += step;
+            }
+         }
+
+         const int64_t j = i + length * d;
+         const int deltaNode = Delta(i, j);
+
+         // Binary search the split position.
+         int64_t split = 0;
+         int64_t divisor = 2;
+         int64_t step = (length + divisor - 1) / divisor;
+         while (true)
+         {
+            if (Delta(i, i + (split + step) * d) > deltaNode)
+            {
+               split += step;
+            }
+
+            if (step == 1)
+            {
+               break;
+            }
+
+            divisor *= 2;
+            step = (length + divisor - 1) / divisor;
+         }
+
+         const int64_t gamma = i + split * d + std::min<int64_t>(d, 0);
+         const uint32_t left = (std::min(i, j) == gamma) ? LeafNodeIndex(gamma) : static_cast<uint32_t>(gamma);
+         const uint32_t right = (std::max(i, j) == gamma + 1) ? LeafNodeIndex(gamma + 1) : static_cast<uint32_t>(gamma + 1);
+
+         m_nodes[i].Left = left;
+         m_nodes[i].Right = right;
+         m_nodes[left].Parent = static_cast<uint32_t>(i);
+         m_nodes[right].Parent = static_cast<uint32_t>(i);
+      }
+   }
+
+   // Walks up from every leaf; the second thread to reach an internal node finishes it, so each node is processed
+   // exactly once after both of its subtrees are done. Treelet restructuring happens in the same pass.
+   void ComputeBoundsBottomUp()
+   {
+      const auto leafCount = static_cast<int64_t>(m_sorted.size());
+      std::vector<std::atomic<uint32_t>> visits(InternalCount());
+      for (auto& visit : visits)
+      {
+         visit.store(0, std::memory_order_relaxed);
+      }
+
+#pragma omp parallel for
+      for (int64_t idx = 0; idx < leafCount; ++idx)
+      {
+         uint32_t node = LeafNodeIndex(idx);
+         const auto& info = m_primitives[m_sorted[idx].PrimitiveIndex];
+         m_nodes[node].Bounds = info.Bounds;
+         m_nodes[node].PrimitiveCount = 1;
+         m_nodes[node].Cost = info.Bounds.SurfaceArea();
+
+         node = m_nodes[node].Parent;
+         while (node != LBVHConstants::InvalidNode)
+         {
+            if (visits[node].fetch_add(1, std::memory_order_acq_rel) == 0)
+            {
+               break;
+            }
+
+            UpdateNode(node);
+            if (m_bRestructureTreelets)
+            {
+               RestructureTreelet(node);
+            }
+
+            node = m_nodes[node].Parent;
+         }
+      }
+   }
+
+   void UpdateNode(uint32_t node)
+   {
+      auto& current = m_nodes[node];
+      const auto& left = m_nodes[current.Left];
+      const auto& right = m_nodes[current.Right];
+      current.Bounds = AABB::SurroundingBox(left.Bounds, right.Bounds);
+      current.PrimitiveCount = left.PrimitiveCount + right.PrimitiveCount;
+      current.Cost = BVHBuildConstants::TraversalCost * current.Bounds.SurfaceArea() + left.Cost + right.Cost;
+   }
+
+   // Finds the SAH-optimal topology of a treelet of up to seven leaves by dynamic programming over leaf subsets.
+   void RestructureTreelet(uint32_t root)
+   {
+      uint32_t leaves[LBVHConstants::MaxTreeletLeaves];
+      uint32_t internals[LBVHConstants::MaxTreeletLeaves - 1];
+      size_t leafCount = 2;
+      size_t internalCount = 1;
+      leaves[0] = m_nodes[root].Left;
+      leaves[1] = m_nodes[root].Right;
+      internals[0] = root;
+
+      while (leafCount < LBVHConstants::MaxTreeletLeaves)
+      {
+         // Expand the treelet leaf with the largest surface area.
+         size_t expand = LBVHConstants::MaxTreeletLeaves;
+         double maxArea = -1.0;
+         for (size_t idx = 0; idx < leafCount; ++idx)
+         {
+            if (!IsLeafNode(leaves[idx]) && m_nodes[leaves[idx]].Bounds.SurfaceArea() > maxArea)
+            {
+               maxArea = m_nodes[leaves[idx]].Bounds.SurfaceArea();
+               expand = idx;
+            }
+         }
+
+         if (expand == LBVHConstants::MaxTreeletLeaves)
+         {
+            break;
+         }
+
+         const uint32_t expanded = leaves[expand];
+         internals[internalCount++] = expanded;
+         leaves[expand] = m_nodes[expanded].Left;
+         leaves[leafCount++] = m_nodes[expanded].Right;
+      }
+
+      if (leafCount < 3)
+      {
+         return;
+      }
+
+      const size_t subsetCount = size_t(1) << leafCount;
+      double area[1 << LBVHConstants::MaxTreeletLeaves];
+      double cost[1 << LBVHConstants::MaxTreeletLeaves];
+      uint32_t partition[1 << LBVHConstants::MaxTreeletLeaves];
+      for (size_t subset = 1; subset < subsetCount; ++subset)
+      {
+         AABB bounds = AABB::Empty();
+         for (size_t idx = 0; idx < leafCount; ++idx)
+         {
+            if (subset & (size_t(1) << idx))
+            {
+               bounds = AABB::SurroundingBox(bounds, m_nodes[leaves[idx]].Bounds);
+            }
+         }
+
+         area[subset] = bounds.SurfaceArea();
+      }
+
+      for (size_t idx = 0; idx < leafCount; ++idx)
+      {
+         cost[size_t(1) << idx] = m_nodes[leaves[idx]].Cost;
+      }
+
+      // Subsets in increasing order guarantee that every proper subset is solved before its superset.
+      for (size_t subset = 1; subset < subsetCount; ++subset)
+      {
+         if (std::has_single_bit(subset))
+         {
+            continue;
+         }
+
+         double bestCost = Infinity;
+         uint32_t bestPartition = 0;
+         const size_t lowestBit = subset & (~subset + 1);
+         for (size_t part = (subset - 1) & subset; part != 0; part = (part - 1) & subset)
+         {
+            // Only consider partitions containing the lowest leaf, others are mirrored duplicates.
+            if ((part & lowestBit) == 0)
+            {
+               continue;
+            }
+
+            double partitionCost = cost[part] + cost[subset ^ part];
+            if (partitionCost < bestCost)
+            {
+               bestCost = partitionCost;
+               bestPartition = static_cast<uint32_t>(part);
+            }
+         }
+
+         cost[subset] = BVHBuildConstants::TraversalCost * area[subset] + bestCost;
+         partition[subset] = bestPartition;
+      }
+
+      const size_t fullSet = subsetCount - 1;
+      if (cost[fullSet] >= m_nodes[root].Cost)
+      {
+         return;
+      }
+
+      size_t nextInternal = 1;
+      ReconstructTreelet(root, fullSet, leaves, internals, nextInternal, partition);
+   }
+
+   uint32_t ReconstructTreelet(uint32_t node, size_t subset, const uint32_t* leaves, const uint32_t* internals, size_t& nextInternal, const uint32_t* partition)
+   {
+      auto childOf = [&](size_t childSubset) -> uint32_t
+      {
+         if (std::has_single_bit(childSubset))
+         {
+            return leaves[std::countr_zero(childSubset)];
+         }
+
+         return ReconstructTreelet(internals[nextInternal++], childSubset, leaves, internals, nextInternal, partition);
+      };
+
+      const size_t leftSubset = partition[subset];
+      const uint32_t left = childOf(leftSubset);
+      const uint32_t right = childOf(subset ^ leftSubset);
+      m_nodes[node].Left = left;
+      m_nodes[node].Right = right;
+      m_nodes[left].Parent = node;
+      m_nodes[right].Parent = node;
+      UpdateNode(node);
+      return node;
+   }
+
+   void GatherPrimitives(FlatBVHData& data, uint32_t node) const
+   {
+      if (IsLeafNode(node))
+      {
+         data.PrimitiveIndices.push_back(m_primitives[m_sorted[node - InternalCount()].PrimitiveIndex].Index);
+         return;
+      }
+
+      GatherPrimitives(data, m_nodes[node].Left);
+      GatherPrimitives(data, m_nodes[node].Right);
+   }
+
+   uint32_t Flatten(FlatBVHData& data, uint32_t node)
+   {
+      const auto& source = m_nodes[node];
+      uint32_t flatIndex = static_cast<uint32_t>(data.Nodes.size());
+      data.Nodes.emplace_back();
+
+      // Collapse small subtrees into a single leaf when SAH says that's cheaper.
+      const double leafCost = source.PrimitiveCount * source.Bounds.SurfaceArea();
+      if (IsLeafNode(node) || (source.PrimitiveCount <= BVHBuildConstants::MaxPrimitivesInLeaf && leafCost <= source.Cost))
+      {
+         auto& leaf = data.Nodes[flatIndex];
+         leaf.Bounds = source.Bounds;
+         leaf.Offset = static_cast<uint32_t>(data.PrimitiveIndices.size());
+         leaf.PrimitiveCount = static_cast<uint16_t>(source.PrimitiveCount);
+         GatherPrimitives(data, node);
+         return flatIndex;
+      }
+
+      // Traversal visits the first child first for rays going in positive direction along the axis.
+      const int axis = source.Bounds.MaximumExtent();
+      uint32_t first = source.Left;
+      uint32_t second = source.Right;
+      if (m_nodes[second].Bounds.Centroid()[axis] < m_nodes[first].Bounds.Centroid()[axis])
+      {
+         std::swap(first, second);
+      }
+
+      const AABB bounds = source.Bounds;
+      Flatten(data, first);
+      uint32_t secondChild = Flatten(data, second);
+
+      auto& interior = data.Nodes[flatIndex];
+      interior.Bounds = bounds;
+      interior.Offset = secondChild;
+      interior.Axis = static_cast<uint8_t>(axis);
+      return flatIndex;
+   }
+
+private:
+   std::vector<BVHPrimitiveInfo> m_primitives;
+   std::vector<MortonPrimitive<KeyType>> m_sorted;
+   std::vector<Node> m_nodes;
+   bool m_bRestructureTreelets = false;
+
+};
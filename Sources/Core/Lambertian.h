@@ -2,35 +2,32 @@
 #include <Core/CoreMinimal.h>
 #include <Core/Hittable.h>
 #include <Core/Material.h>
-#include <Core/Texture.h>
+#include <Core/Sampler.h>
+#include <Math/Sampling.h>
 
-class Lambertian : public Material
+class Lambertian
 {
 public:
-   Lambertian(const Color& albedo) :
-      Albedo(std::make_shared<SolidColorTexture>(albedo))
+   static bool Scatter(const Color& albedo, const Ray& rayIn, const HitRecord& rec, Sampler& sampler, ScatterRecord& srec)
    {
+      // Cosine-weighted, so the cosine and 1/pi of the BRDF cancel against the density and only albedo remains.
+      const Vec3 scatterDirection = OrthonormalBasis(rec.n).ToWorld(SampleCosineHemisphere(sampler.Get2D()));
+      srec.Scattered = Ray(rec.p, scatterDirection, rayIn.Time);
+      srec.Attenuation = albedo;
+      srec.PDF = CosineHemispherePDF(Dot(scatterDirection, rec.n));
+      srec.bSpecular = false;
+      return srec.PDF > 0.0;
    }
 
-   Lambertian(std::shared_ptr<Texture> albedo) :
-      Albedo(albedo)
+   static Color Eval(const Color& albedo, const HitRecord& rec, const Vec3& direction)
    {
+      const double cosine = Dot(UnitVectorOf(direction), rec.n);
+      return cosine > 0.0 ? albedo * (cosine / Pi) : Color();
    }
 
-   bool Scatter(const Ray& rayIn, const HitRecord& rec, Color& attenuation, Ray& scattered) const override
+   static double PDF(const HitRecord& rec, const Vec3& direction)
    {
-      auto scatterDirection = RandomInHemisphere(rec.n);
-      if (scatterDirection.IsNearZero())
-      {
-         scatterDirection = rec.n;
-      }
-
-      scattered = Ray(rec.p, scatterDirection, rayIn.Time);
-      attenuation = Albedo->Value(rec.u, rec.v, rec.p);
-      return true;
+      return CosineHemispherePDF(Dot(UnitVectorOf(direction), rec.n));
    }
 
-public:
-   std::shared_ptr<Texture> Albedo;
-
 };
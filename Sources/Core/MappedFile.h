@@ -0,0 +1,113 @@
+#pragma once
+#include <Core/CoreMinimal.h>
+#include <filesystem>
+
+#ifdef _WIN32
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <Windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+// Read-only memory mapping of a whole file.
+class MappedFile
+{
+public:
+   MappedFile() = default;
+   MappedFile(const std::filesystem::path& path)
+   {
+#ifdef _WIN32
+      m_file = CreateFileW(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+      if (m_file == INVALID_HANDLE_VALUE)
+      {
+         return;
+      }
+
+      LARGE_INTEGER fileSize;
+      if (!GetFileSizeEx(m_file, &fileSize) || fileSize.QuadPart == 0)
+      {
+         return;
+      }
+
+      m_mapping = CreateFileMappingW(m_file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+      if (m_mapping == nullptr)
+      {
+         return;
+      }
+
+      m_data = static_cast<const uint8_t*>(MapViewOfFile(m_mapping, FILE_MAP_READ, 0, 0, 0));
+      m_size = m_data != nullptr ? static_cast<size_t>(fileSize.QuadPart) : 0;
+#else
+      m_file = open(path.c_str(), O_RDONLY);
+      if (m_file < 0)
+      {
+         return;
+      }
+
+      struct stat fileStat;
+      if (fstat(m_file, &fileStat) != 0 || fileStat.st_size == 0)
+      {
+         return;
+      }
+
+      void* data = mmap(nullptr, static_cast<size_t>(fileStat.st_size), PROT_READ, MAP_PRIVATE, m_file, 0);
+      if (data == MAP_FAILED)
+      {
+         return;
+      }
+
+      m_data = static_cast<const uint8_t*>(data);
+      m_size = static_cast<size_t>(fileStat.st_size);
+#endif
+   }
+
+   MappedFile(const MappedFile&) = delete;
+   MappedFile& operator=(const MappedFile&) = delete;
+
+   ~MappedFile()
+   {
+#ifdef _WIN32
+      if (m_data != nullptr)
+      {
+         UnmapViewOfFile(m_data);
+      }
+      if (m_mapping != nullptr)
+      {
+         CloseHandle(m_mapping);
+      }
+      if (m_file != INVALID_HANDLE_VALUE)
+      {
+         CloseHandle(m_file);
+      }
+#else
+      if (m_data != nullptr)
+      {
+         munmap(const_cast<uint8_t*>(m_data), m_size);
+      }
+      if (m_file >= 0)
+      {
+         close(m_file);
+      }
+#endif
+   }
+
+   bool IsValid() const { return m_data != nullptr; }
+   const uint8_t* Data() const { return m_data; }
+   size_t Size() const { return m_size; }
+
+private:
+#ifdef _WIN32
+   HANDLE m_file = INVALID_HANDLE_VALUE;
+   HANDLE m_mapping = nullptr;
+#else
+   int m_file = -1;
+#endif
+   const uint8_t* m_data = nullptr;
+   size_t m_size = 0;
+
+};
@@ -1,13 +1,40 @@
 #pragma once
 #include <Core/CoreMinimal.h>
 #include <Core/Color.h>
+#include <Math/Ray.h>
 
 struct HitRecord;
-class Ray;
-class Material
+class Sampler;
+
+struct ScatterRecord
+{
+public:
+   Ray Scattered;
+   Color Attenuation; // Eval / PDF of the scattered direction; what the path throughput is multiplied by
+   double PDF = 0.0;  // Solid angle density of the scattered direction, zero for specular
+   bool bSpecular = false; // Delta distribution or perturbed mirror, which Eval and PDF can't express
+
+};
+
+enum class MaterialType : uint32_t
+{
+   Lambertian = 0,
+   Metal,
+   Dielectric,
+   DiffuseLight,
+   Isotropic
+};
+
+// Tagged record of a material in a MaterialTable, which evaluates it by switching on the type. Each type is a class of
+// static functions of its parameters: Scatter samples a scattered direction, drawing from sampler in the dimensions
+// of the current bounce; Eval is the BSDF times cosine (phase function for media) towards a direction, zero for
+// specular materials; PDF is the density with which Scatter picks it.
+struct Material
 {
 public:
-   virtual Color Emitted(double u, double v, const Point3& p) const { return Color(); }
-   virtual bool Scatter(const Ray& rayIn, const HitRecord& rec, Color& attenuation, Ray& scattered) const = 0;
+   MaterialType Type = MaterialType::Lambertian;
+   uint32_t Texture = 0; // Lambertian, Isotropic: albedo, DiffuseLight: emission
+   Color Albedo; // Metal
+   double Parameter = 0.0; // Metal: fuzz, Dielectric: index of refraction
 
-};
\ No newline at end of file
+};
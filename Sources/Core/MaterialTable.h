@@ -0,0 +1,227 @@
+#pragma once
+#include <Core/CoreMinimal.h>
+#include <Core/Dielectric.h>
+#include <Core/Hittable.h>
+#include <Core/ImageTexture.h>
+#include <Core/Isotropic.h>
+#include <Core/Lambertian.h>
+#include <Core/Material.h>
+#include <Core/Metal.h>
+#include <Core/RenderFeatures.h>
+#include <Core/Sampler.h>
+#include <Core/Texture.h>
+#include <string>
+#include <string_view>
+
+// Materials and textures of a scene, as tagged records in flat arrays. Primitives and hit records refer to materials
+// by index, materials and checkers to textures by index, so evaluating a material is a switch on its type and at most
+// a walk down the array; no virtual calls and no reference counts on the way. Add methods return the index of what
+// they added. Eval and PDF are not called yet; they are there for light sampling, which needs the scattering of a
+// material towards directions it did not sample itself.
+class MaterialTable
+{
+public:
+   uint32_t AddTexture(const Texture& texture)
+   {
+      m_textures.push_back(texture);
+      return static_cast<uint32_t>(m_textures.size() - 1);
+   }
+
+   uint32_t AddSolidTexture(const Color& albedo)
+   {
+      Texture texture;
+      texture.Type = TextureType::Solid;
+      texture.Albedo = albedo;
+      return AddTexture(texture);
+   }
+
+   uint32_t AddCheckerTexture(uint32_t even, uint32_t odd)
+   {
+      Texture texture;
+      texture.Type = TextureType::Checker;
+      texture.Even = even;
+      texture.Odd = odd;
+      return AddTexture(texture);
+   }
+
+   uint32_t AddCheckerTexture(const Color& even, const Color& odd)
+   {
+      const uint32_t evenTexture = AddSolidTexture(even);
+      return AddCheckerTexture(evenTexture, AddSolidTexture(odd));
+   }
+
+   uint32_t AddImageTexture(std::string_view fileName)
+   {
+      // Copied into a string, as the image loader wants a terminated path.
+      m_images.push_back(std::make_unique<ImageTexture>(std::string(fileName)));
+      Texture texture;
+      texture.Type = TextureType::Image;
+      texture.Image = static_cast<uint32_t>(m_images.size() - 1);
+      return AddTexture(texture);
+   }
+
+   uint32_t AddMaterial(const Material& material)
+   {
+      m_materials.push_back(material);
+      return static_cast<uint32_t>(m_materials.size() - 1);
+   }
+
+   uint32_t AddLambertian(uint32_t albedo)
+   {
+      return AddTexturedMaterial(MaterialType::Lambertian, albedo);
+   }
+
+   uint32_t AddLambertian(const Color& albedo)
+   {
+      return AddLambertian(AddSolidTexture(albedo));
+   }
+
+   uint32_t AddMetal(const Color& albedo, double fuzz/* Roughness */)
+   {
+      Material material;
+      material.Type = MaterialType::Metal;
+      material.Albedo = albedo;
+      material.Parameter = fuzz < 1.0 ? fuzz : 1.0;
+      return AddMaterial(material);
+   }
+
+   uint32_t AddDielectric(double ior)
+   {
+      Material material;
+      material.Type = MaterialType::Dielectric;
+      material.Parameter = ior;
+      return AddMaterial(material);
+   }
+
+   uint32_t AddDiffuseLight(uint32_t emit)
+   {
+      return AddTexturedMaterial(MaterialType::DiffuseLight, emit);
+   }
+
+   uint32_t AddDiffuseLight(const Color& emit)
+   {
+      return AddDiffuseLight(AddSolidTexture(emit));
+   }
+
+   uint32_t AddIsotropic(uint32_t albedo)
+   {
+      return AddTexturedMaterial(MaterialType::Isotropic, albedo);
+   }
+
+   uint32_t AddIsotropic(const Color& albedo)
+   {
+      return AddIsotropic(AddSolidTexture(albedo));
+   }
+
+   size_t MaterialCount() const { return m_materials.size(); }
+
+   // Features render kernels need for the materials of the table.
+   uint32_t GetFeatures() const
+   {
+      uint32_t features = 0;
+      for (const Material& material : m_materials)
+      {
+         features |= material.Type == MaterialType::Isotropic ? FeatureBit(RenderFeature::Volumes) : 0;
+         features |= material.Type == MaterialType::DiffuseLight ? FeatureBit(RenderFeature::Emissives) : 0;
+      }
+
+      return features;
+   }
+
+   Color Value(uint32_t texture, double u, double v, const Point3& p) const
+   {
+      // Squares of nested checkers are decided by the same point, so the parity is computed once.
+      const Texture* record = &m_textures[texture];
+      if (record->Type == TextureType::Checker)
+      {
+         const bool bOdd = CheckerTexture::IsOdd(p);
+         do
+         {
+            record = &m_textures[bOdd ? record->Odd : record->Even];
+         } while (record->Type == TextureType::Checker);
+      }
+
+      switch (record->Type)
+      {
+      case TextureType::Image:
+         return m_images[record->Image]->Value(u, v);
+      case TextureType::Solid:
+      default:
+         return record->Albedo;
+      }
+   }
+
+   Color Emitted(uint32_t material, double u, double v, const Point3& p) const
+   {
+      const Material& record = m_materials[material];
+      return record.Type == MaterialType::DiffuseLight ? Value(record.Texture, u, v, p) : Color();
+   }
+
+   // Kernels compiled without Volumes leave out the phase function of media, which their tables have none of.
+   template<uint32_t Features = RenderFeatureConstants::AllFeatures>
+   bool Scatter(uint32_t material, const Ray& rayIn, const HitRecord& rec, Sampler& sampler, ScatterRecord& srec) const
+   {
+      const Material& record = m_materials[material];
+      switch (record.Type)
+      {
+      case MaterialType::Metal:
+         return Metal::Scatter(record.Albedo, record.Parameter, rayIn, rec, sampler, srec);
+      case MaterialType::Dielectric:
+         return Dielectric::Scatter(record.Parameter, rayIn, rec, sampler, srec);
+      case MaterialType::DiffuseLight:
+         return false;
+      case MaterialType::Isotropic:
+         if constexpr (HasFeature(Features, RenderFeature::Volumes))
+         {
+            return Isotropic::Scatter(Value(record.Texture, rec.u, rec.v, rec.p), rayIn, rec, sampler, srec);
+         }
+         [[fallthrough]];
+      case MaterialType::Lambertian:
+      default:
+         return Lambertian::Scatter(Value(record.Texture, rec.u, rec.v, rec.p), rayIn, rec, sampler, srec);
+      }
+   }
+
+   Color Eval(uint32_t material, [[maybe_unused]] const Ray& rayIn, const HitRecord& rec, const Vec3& direction) const
+   {
+      const Material& record = m_materials[material];
+      switch (record.Type)
+      {
+      case MaterialType::Lambertian:
+         return Lambertian::Eval(Value(record.Texture, rec.u, rec.v, rec.p), rec, direction);
+      case MaterialType::Isotropic:
+         return Isotropic::Eval(Value(record.Texture, rec.u, rec.v, rec.p));
+      default:
+         return Color();
+      }
+   }
+
+   double PDF(uint32_t material, [[maybe_unused]] const Ray& rayIn, const HitRecord& rec, const Vec3& direction) const
+   {
+      const Material& record = m_materials[material];
+      switch (record.Type)
+      {
+      case MaterialType::Lambertian:
+         return Lambertian::PDF(rec, direction);
+      case MaterialType::Isotropic:
+         return Isotropic::PDF();
+      default:
+         return 0.0;
+      }
+   }
+
+private:
+   uint32_t AddTexturedMaterial(MaterialType type, uint32_t texture)
+   {
+      Material material;
+      material.Type = type;
+      material.Texture = texture;
+      return AddMaterial(material);
+   }
+
+private:
+   std::vector<Texture> m_textures;
+   std::vector<Material> m_materials;
+   std::vector<std::unique_ptr<ImageTexture>> m_images;
+
+};
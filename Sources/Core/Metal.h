@@ -2,27 +2,29 @@
 #include <Core/CoreMinimal.h>
 #include <Core/Material.h>
 #include <Core/Hittable.h>
+#include <Core/Sampler.h>
 #include <Math/Ray.h>
+#include <Math/Sampling.h>
 
-class Metal : public Material
+class Metal
 {
 public:
-   Metal(const Color& albedo, double fuzz/* Roughness */) :
-      Albedo(albedo),
-      Fuzz(fuzz < 1.0 ? fuzz : 1.0)
-   {
-   }
-
-   bool Scatter(const Ray& rayIn, const HitRecord& rec, Color& attenuation, Ray& scattered) const override
+   static bool Scatter(const Color& albedo, double fuzz/* Roughness */, const Ray& rayIn, const HitRecord& rec, Sampler& sampler,
+      ScatterRecord& srec)
    {
       Vec3 reflected = Reflect(UnitVectorOf(rayIn.Direction), rec.n);
-      scattered = Ray(rec.p, reflected + Fuzz*RandomInHemisphere(rec.n), rayIn.Time);
-      attenuation = Albedo;
-      return (Dot(scattered.Direction, rec.n) > 0.0);
-   }
+      const Point2 direction = sampler.Get2D();
+      Vec3 fuzzOffset = SampleUniformBall(direction, sampler.Get1D());
+      if (Dot(fuzzOffset, rec.n) < 0.0)
+      {
+         fuzzOffset = -fuzzOffset;
+      }
 
-public:
-   Color Albedo;
-   double Fuzz;
+      srec.Scattered = Ray(rec.p, reflected + fuzz*fuzzOffset, rayIn.Time);
+      srec.Attenuation = albedo;
+      srec.PDF = 0.0;
+      srec.bSpecular = true;
+      return (Dot(srec.Scattered.Direction, rec.n) > 0.0);
+   }
 
 };
@@ -1,27 +1,41 @@
 #pragma once
 #include <Core/CoreMinimal.h>
 #include <Core/Hittable.h>
+#include <Core/Sphere.h>
 #include <Math/Ray.h>
 
-class Material;
 class MovingSphere : public Hittable
 {
 public:
    MovingSphere() = default;
-   MovingSphere(Point3 center0, Point3 center1, double time0, double time1, double rad, std::shared_ptr<Material> matPtr) :
+   MovingSphere(Point3 center0, Point3 center1, double time0, double time1, double rad, uint32_t material) :
       Center0(center0), Center1(center1),
       Time0(time0), Time1(time1),
       Radius(rad),
-      MatPtr(matPtr)
+      Material(material)
    {
    }
 
    bool Hit(const Ray& r, double tMin, double tMax, HitRecord& rec) const override
    {
-      Vec3 centerToOrigin = r.Origin - this->Center(r.Time);
+      RT_STAT_INCREMENT(StatCounter::MovingSphereTests);
+      return Intersect(Center(r.Time), Radius, Material, r, tMin, tMax, rec);
+   }
+
+   void BoundaryCrossings(const Ray& r, double tMin, double tMax, std::vector<BoundaryCrossing>& crossings) const override
+   {
+      RT_STAT_INCREMENT(StatCounter::MovingSphereTests);
+      Sphere::Crossings(Center(r.Time), Radius, r, tMin, tMax, crossings);
+   }
+
+   // Intersection with the sphere at its position at time of the ray.
+   static bool Intersect(const Point3& center, double radius, uint32_t material,
+      const Ray& r, double tMin, double tMax, HitRecord& rec)
+   {
+      Vec3 centerToOrigin = r.Origin - center;
       auto a = r.Direction.SquaredLength();
       auto halfB = Dot(centerToOrigin, r.Direction);
-      auto c = centerToOrigin.SquaredLength() - Radius * Radius;
+      auto c = centerToOrigin.SquaredLength() - radius * radius;
 
       auto discriminant = halfB * halfB - a * c;
       if (discriminant < 0.0)
@@ -43,13 +57,18 @@ public:
 
       rec.t = root;
       rec.p = r.At(rec.t);
-      auto outwardNormal = (rec.p - Center(r.Time)) / Radius;
+      auto outwardNormal = (rec.p - center) / radius;
       rec.SetFaceNormal(r, outwardNormal);
-      rec.MatPtr = MatPtr;
+      rec.Material = material;
       return true;
    }
 
-   Point3 Center(double currentTime) const { return Center0 + (((currentTime - Time0) / (Time1 - Time0)) * (Center1 - Center0)); }
+   static Point3 CenterAt(const Point3& center0, const Point3& center1, double time0, double time1, double currentTime)
+   {
+      return center0 + (((currentTime - time0) / (time1 - time0)) * (center1 - center0));
+   }
+
+   Point3 Center(double currentTime) const { return CenterAt(Center0, Center1, Time0, Time1, currentTime); }
 
    bool BoundingBox(double time0, double time1, AABB& outputBox) const override
    {
@@ -66,6 +85,6 @@ public:
    Point3 Center0, Center1;
    double Time0 = 0.0, Time1 = 0.0;
    double Radius = 1.0;
-   std::shared_ptr<Material> MatPtr;
+   uint32_t Material = 0;
 
 };
\ No newline at end of file
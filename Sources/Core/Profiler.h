@@ -0,0 +1,298 @@
+#pragma once
+#include <Core/CoreMinimal.h>
+#include <chrono>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <type_traits>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+enum class RenderPhase : uint32_t
+{
+   SceneBuild = 0,
+   BVHBuild,
+   Render,
+   ImageWrite,
+   Count
+};
+
+namespace ProfilerConstants
+{
+   constexpr size_t PhaseCount = static_cast<size_t>(RenderPhase::Count);
+   constexpr const char* PhaseNames[PhaseCount] = { "sceneBuild", "bvhBuild", "render", "imageWrite" };
+   constexpr uint32_t JsonVersion = 1;
+}
+
+struct RayCounters
+{
+public:
+   uint64_t Samples = 0;
+   uint64_t Rays = 0; // Primary and secondary rays
+
+};
+
+struct ThreadTiming
+{
+public:
+   double BusySeconds = 0.0;
+   RayCounters Counters;
+
+};
+
+// Measures render phases with a monotonic clock. Phases may nest (e.g. BVH builds inside scene build); time is
+// only accumulated to the innermost running phase, so every phase reports exclusive time.
+class RenderProfiler
+{
+public:
+   using Clock = std::chrono::steady_clock;
+
+   class ScopedPhase
+   {
+   public:
+      ScopedPhase(RenderPhase phase) :
+         m_phase(phase)
+      {
+         RenderProfiler::Instance().BeginPhase(phase);
+      }
+
+      ~ScopedPhase()
+      {
+         RenderProfiler::Instance().EndPhase(m_phase);
+      }
+
+   private:
+      RenderPhase m_phase;
+
+   };
+
+   static RenderProfiler& Instance()
+   {
+      static RenderProfiler instance;
+      return instance;
+   }
+
+   // Counters of the calling render thread.
+   static RayCounters& ThreadCounters()
+   {
+      thread_local RayCounters counters;
+      return counters;
+   }
+
+   static int ThreadIndex()
+   {
+#ifdef _OPENMP
+      return omp_get_thread_num();
+#else
+      return 0;
+#endif
+   }
+
+   void BeginPhase(RenderPhase phase)
+   {
+      const auto now = Clock::now();
+      if (!m_phaseStack.empty())
+      {
+         Accumulate(m_phaseStack.back(), now);
+      }
+
+      m_phaseStack.push_back(phase);
+      m_phaseStart = now;
+   }
+
+   void EndPhase(RenderPhase phase)
+   {
+      const auto now = Clock::now();
+      if (m_phaseStack.empty() || m_phaseStack.back() != phase)
+      {
+         std::cerr << "Unbalanced profiler phase '" << ProfilerConstants::PhaseNames[static_cast<size_t>(phase)] << "'.\n";
+         return;
+      }
+
+      Accumulate(phase, now);
+      m_phaseStack.pop_back();
+      m_phaseStart = now;
+   }
+
+   double GetPhaseSeconds(RenderPhase phase) const { return m_phaseSeconds[static_cast<size_t>(phase)]; }
+
+   // Drops everything measured so far; used when one process renders several scenes.
+   void Reset()
+   {
+      std::fill(std::begin(m_phaseSeconds), std::end(m_phaseSeconds), 0.0);
+      m_phaseStack.clear();
+      m_threads.clear();
+      m_settings.clear();
+   }
+
+   void ResetThreads(int threadCount)
+   {
+      m_threads.assign(threadCount, ThreadTiming());
+   }
+
+   // Called by every render thread when it runs out of work in a render pass. Passes add up.
+   void RecordThread(int threadIndex, double busySeconds, const RayCounters& counters)
+   {
+      if (threadIndex >= 0 && static_cast<size_t>(threadIndex) < m_threads.size())
+      {
+         m_threads[threadIndex].BusySeconds += busySeconds;
+         m_threads[threadIndex].Counters.Samples += counters.Samples;
+         m_threads[threadIndex].Counters.Rays += counters.Rays;
+      }
+   }
+
+   void SetSetting(const std::string& key, std::string_view value) { m_settings.emplace_back(key, QuoteJson(value)); }
+   void SetSetting(const std::string& key, const char* value) { SetSetting(key, std::string_view(value)); }
+   void SetSetting(const std::string& key, bool value) { m_settings.emplace_back(key, value ? "true" : "false"); }
+
+   template<typename T> requires std::is_arithmetic_v<T>
+   void SetSetting(const std::string& key, T value)
+   {
+      std::ostringstream stream;
+      stream << value;
+      m_settings.emplace_back(key, stream.str());
+   }
+
+   RayCounters GetTotalCounters() const
+   {
+      RayCounters total;
+      for (const auto& thread : m_threads)
+      {
+         total.Samples += thread.Counters.Samples;
+         total.Rays += thread.Counters.Rays;
+      }
+
+      return total;
+   }
+
+   void PrintSummary(std::ostream& stream) const
+   {
+      const auto total = GetTotalCounters();
+      const double renderSeconds = GetPhaseSeconds(RenderPhase::Render);
+      stream << std::fixed << std::setprecision(3);
+      for (size_t phase = 0; phase < ProfilerConstants::PhaseCount; ++phase)
+      {
+         stream << std::left << std::setw(12) << ProfilerConstants::PhaseNames[phase] << " : " << m_phaseSeconds[phase] << " s\n";
+      }
+
+      stream << "Rays         : " << total.Rays << " (" << total.Samples << " primary, " << total.Rays - total.Samples << " secondary)\n";
+      stream << "Throughput   : " << PerSecond(total.Rays, renderSeconds) / 1e6 << " Mrays/s, "
+         << PerSecond(total.Samples, renderSeconds) / 1e6 << " Msamples/s\n";
+      stream << std::defaultfloat;
+   }
+
+   bool WriteJson(const std::string& path) const
+   {
+      const auto total = GetTotalCounters();
+      const double renderSeconds = GetPhaseSeconds(RenderPhase::Render);
+      double totalSeconds = 0.0;
+      for (double seconds : m_phaseSeconds)
+      {
+         totalSeconds += seconds;
+      }
+
+      std::ofstream stream(path);
+      if (!stream)
+      {
+         std::cerr << "Failed to write timing report '" << path << "'.\n";
+         return false;
+      }
+
+      stream << std::setprecision(9);
+      stream << "{\n";
+      stream << "  \"version\": " << ProfilerConstants::JsonVersion << ",\n";
+      stream << "  \"settings\": {";
+      for (size_t idx = 0; idx < m_settings.size(); ++idx)
+      {
+         stream << (idx == 0 ? "\n" : ",\n") << "    \"" << m_settings[idx].first << "\": " << m_settings[idx].second;
+      }
+      stream << (m_settings.empty() ? "},\n" : "\n  },\n");
+
+      stream << "  \"phases\": {\n";
+      for (size_t phase = 0; phase < ProfilerConstants::PhaseCount; ++phase)
+      {
+         stream << "    \"" << ProfilerConstants::PhaseNames[phase] << "\": " << m_phaseSeconds[phase] << ",\n";
+      }
+      stream << "    \"total\": " << totalSeconds << "\n  },\n";
+
+      stream << "  \"rays\": {\n";
+      stream << "    \"primary\": " << total.Samples << ",\n";
+      stream << "    \"secondary\": " << total.Rays - total.Samples << ",\n";
+      stream << "    \"total\": " << total.Rays << "\n  },\n";
+
+      stream << "  \"throughput\": {\n";
+      stream << "    \"primaryRaysPerSecond\": " << PerSecond(total.Samples, renderSeconds) << ",\n";
+      stream << "    \"secondaryRaysPerSecond\": " << PerSecond(total.Rays - total.Samples, renderSeconds) << ",\n";
+      stream << "    \"raysPerSecond\": " << PerSecond(total.Rays, renderSeconds) << ",\n";
+      stream << "    \"samplesPerSecond\": " << PerSecond(total.Samples, renderSeconds) << "\n  },\n";
+
+      stream << "  \"threads\": [";
+      for (size_t idx = 0; idx < m_threads.size(); ++idx)
+      {
+         const auto& thread = m_threads[idx];
+         stream << (idx == 0 ? "\n" : ",\n") << "    { \"index\": " << idx
+            << ", \"busySeconds\": " << thread.BusySeconds
+            << ", \"utilization\": " << (renderSeconds > 0.0 ? thread.BusySeconds / renderSeconds : 0.0)
+            << ", \"rays\": " << thread.Counters.Rays
+            << ", \"samples\": " << thread.Counters.Samples << " }";
+      }
+      stream << (m_threads.empty() ? "]\n" : "\n  ]\n");
+      stream << "}\n";
+      return static_cast<bool>(stream);
+   }
+
+   static double SecondsBetween(Clock::time_point begin, Clock::time_point end)
+   {
+      return std::chrono::duration<double>(end - begin).count();
+   }
+
+private:
+   RenderProfiler() = default;
+
+   void Accumulate(RenderPhase phase, Clock::time_point now)
+   {
+      m_phaseSeconds[static_cast<size_t>(phase)] += SecondsBetween(m_phaseStart, now);
+   }
+
+   static double PerSecond(uint64_t count, double seconds)
+   {
+      return seconds > 0.0 ? static_cast<double>(count) / seconds : 0.0;
+   }
+
+   // value as a JSON string, with quotes, backslashes (as in Windows paths) and control characters escaped.
+   static std::string QuoteJson(std::string_view value)
+   {
+      std::ostringstream stream;
+      stream << '"';
+      for (const char character : value)
+      {
+         if (character == '"' || character == '\\')
+         {
+            stream << '\\' << character;
+         }
+         else if (static_cast<unsigned char>(character) < 0x20)
+         {
+            stream << "\\u" << std::hex << std::setw(4) << std::setfill('0') << static_cast<int>(character) << std::dec;
+         }
+         else
+         {
+            stream << character;
+         }
+      }
+
+      stream << '"';
+      return stream.str();
+   }
+
+private:
+   double m_phaseSeconds[ProfilerConstants::PhaseCount] = {};
+   std::vector<RenderPhase> m_phaseStack;
+   Clock::time_point m_phaseStart;
+   std::vector<ThreadTiming> m_threads;
+   std::vector<std::pair<std::string, std::string>> m_settings;
+
+};
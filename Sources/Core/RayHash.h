@@ -0,0 +1,32 @@
+#pragma once
+#include <Core/CoreMinimal.h>
+#include <Math/Ray.h>
+#include <bit>
+
+// Uniform numbers in (0, 1] from the bits of a ray and a seed of the medium it enters. Media draw their free-flight
+// distances from them rather than from a random generator, so they depend only on the path that reaches the medium,
+// never on the order paths are traced in.
+class RayHashSequence
+{
+public:
+   RayHashSequence(const Ray& r, uint64_t seed) :
+      m_state(MixBits(seed))
+   {
+      const double values[7] = { r.Origin.x, r.Origin.y, r.Origin.z, r.Direction.x, r.Direction.y, r.Direction.z, r.Time };
+      for (double value : values)
+      {
+         m_state = MixBits(m_state ^ std::bit_cast<uint64_t>(value));
+      }
+   }
+
+   double Next()
+   {
+      const double value = ((m_state >> 11) + 1) * 0x1p-53;
+      m_state = MixBits(m_state + 0x9e3779b97f4a7c15ull);
+      return value;
+   }
+
+private:
+   uint64_t m_state;
+
+};
@@ -0,0 +1,120 @@
+#pragma once
+#include <Core/CoreMinimal.h>
+#include <Math/AABB.h>
+#include <Math/Ray.h>
+
+namespace RayReorderConstants
+{
+   constexpr uint32_t BitsPerAxis = 7; // Origins fall in 2^BitsPerAxis cells along each axis of their bounds
+   constexpr uint32_t KeyBits = 3 * BitsPerAxis + 3;
+   constexpr uint32_t RadixBits = 8;
+   constexpr uint32_t RadixBuckets = 1 << RadixBits;
+   constexpr uint32_t Passes = (KeyBits + RadixBits - 1) / RadixBits;
+}
+
+// Orders rays for memory coherence, after Pharr et al. 1997, "Rendering Complex Scenes with Memory-Coherent Ray
+// Tracing", and Garanzha and Loop 2010, "Fast Ray Sorting and Breadth-First Packet Traversal for GPU Ray Tracing".
+// The key of a ray is its direction octant above the Morton code of the cell its origin falls in, so rays which leave
+// the same region in the same general direction end up next to each other and visit the same nodes and primitives
+// while they are still cached. Sorting is a stable LSD radix sort, linear in the number of rays.
+class RayReorderer
+{
+public:
+   // Sorts indices by the key of rayOf(index), the ray an index stands for.
+   template<typename RayOf>
+   void Sort(std::vector<uint32_t>& indices, RayOf&& rayOf)
+   {
+      if (indices.empty())
+      {
+         return;
+      }
+
+      Point3 minimum(Infinity, Infinity, Infinity);
+      Point3 maximum(-Infinity, -Infinity, -Infinity);
+      for (uint32_t index : indices)
+      {
+         const Point3 origin = rayOf(index).Origin;
+         for (int axis = 0; axis < 3; ++axis)
+         {
+            minimum[axis] = std::min(minimum[axis], origin[axis]);
+            maximum[axis] = std::max(maximum[axis], origin[axis]);
+         }
+      }
+
+      // Histograms of every digit are counted along with the keys, which saves a pass over them per digit.
+      constexpr double CellScale = static_cast<double>(1 << RayReorderConstants::BitsPerAxis);
+      Vec3 scale;
+      for (int axis = 0; axis < 3; ++axis)
+      {
+         scale[axis] = maximum[axis] > minimum[axis] ? CellScale / (maximum[axis] - minimum[axis]) : 0.0;
+      }
+
+      uint32_t histograms[RayReorderConstants::Passes][RayReorderConstants::RadixBuckets] = {};
+      m_keys.resize(indices.size());
+      for (size_t idx = 0; idx < indices.size(); ++idx)
+      {
+         const Ray ray = rayOf(indices[idx]);
+         uint32_t key = 0;
+         for (int axis = 0; axis < 3; ++axis)
+         {
+            const auto cell = static_cast<uint32_t>(std::min((ray.Origin[axis] - minimum[axis]) * scale[axis], CellScale - 1.0));
+            key |= ExpandBits(cell) << axis;
+            key |= static_cast<uint32_t>(ray.Direction[axis] < 0.0) << (3 * RayReorderConstants::BitsPerAxis + axis);
+         }
+
+         m_keys[idx] = key;
+         for (uint32_t pass = 0; pass < RayReorderConstants::Passes; ++pass)
+         {
+            ++histograms[pass][(key >> (pass * RayReorderConstants::RadixBits)) & (RayReorderConstants::RadixBuckets - 1)];
+         }
+      }
+
+      m_sortedIndices.resize(indices.size());
+      m_sortedKeys.resize(indices.size());
+      for (uint32_t pass = 0; pass < RayReorderConstants::Passes; ++pass)
+      {
+         // A digit all keys share leaves the order as it is.
+         uint32_t* offsets = histograms[pass];
+         const uint32_t shift = pass * RayReorderConstants::RadixBits;
+         if (offsets[(m_keys[0] >> shift) & (RayReorderConstants::RadixBuckets - 1)] == indices.size())
+         {
+            continue;
+         }
+
+         uint32_t offset = 0;
+         for (uint32_t bucket = 0; bucket < RayReorderConstants::RadixBuckets; ++bucket)
+         {
+            const uint32_t count = offsets[bucket];
+            offsets[bucket] = offset;
+            offset += count;
+         }
+
+         for (size_t idx = 0; idx < indices.size(); ++idx)
+         {
+            const uint32_t target = offsets[(m_keys[idx] >> shift) & (RayReorderConstants::RadixBuckets - 1)]++;
+            m_sortedIndices[target] = indices[idx];
+            m_sortedKeys[target] = m_keys[idx];
+         }
+
+         indices.swap(m_sortedIndices);
+         m_keys.swap(m_sortedKeys);
+      }
+   }
+
+private:
+   // Spreads the low 10 bits of value to every third bit.
+   static uint32_t ExpandBits(uint32_t value)
+   {
+      value = (value | (value << 16)) & 0x030000FF;
+      value = (value | (value << 8)) & 0x0300F00F;
+      value = (value | (value << 4)) & 0x030C30C3;
+      value = (value | (value << 2)) & 0x09249249;
+      return value;
+   }
+
+private:
+   std::vector<uint32_t> m_keys; // Key of every index, in the order of the indices
+   std::vector<uint32_t> m_sortedIndices;
+   std::vector<uint32_t> m_sortedKeys;
+
+};
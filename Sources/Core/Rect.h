@@ -3,44 +3,54 @@
 #include <Core/Material.h>
 #include <Math/AABB.h>
 
+// Intersection with rectangle [a0, a1] x [b0, b1] on plane where axis K equals k. Outward normal points along +K.
+template<int AxisA, int AxisB, int AxisK>
+inline bool HitAxisAlignedRect(double a0, double a1, double b0, double b1, double k, uint32_t material,
+   const Ray& r, double tMin, double tMax, HitRecord& rec)
+{
+   double t = (k - r.Origin[AxisK]) / r.Direction[AxisK];
+   if (t >= tMin && t <= tMax)
+   {
+      double a = r.Origin[AxisA] + (t * r.Direction[AxisA]);
+      double b = r.Origin[AxisB] + (t * r.Direction[AxisB]);
+
+      bool bHitAAxis = (a >= a0 && a <= a1);
+      bool bHitBAxis = (b >= b0 && b <= b1);
+      if (bHitAAxis && bHitBAxis)
+      {
+         rec.u = (a - a0) / (a1 - a0);
+         rec.v = (b - b0) / (b1 - b0);
+         rec.t = t;
+
+         Vec3 outwardNormal;
+         outwardNormal[AxisK] = 1.0;
+         rec.SetFaceNormal(r, outwardNormal);
+         rec.Material = material;
+         rec.p = r.At(t);
+         return true;
+      }
+   }
+   return false;
+}
+
 class XYRect : public Hittable
 {
 public:
    XYRect() = default;
-   XYRect(double x0, double x1, double y0, double y1, double k, std::shared_ptr<Material> matPtr) :
+   XYRect(double x0, double x1, double y0, double y1, double k, uint32_t material) :
       m_x0(x0),
       m_x1(x1),
       m_y0(y0),
       m_y1(y1),
       m_k(k),
-      m_matPtr(matPtr)
+      m_material(material)
    {
    }
 
    bool Hit(const Ray& r, double tMin, double tMax, HitRecord& rec) const override
    {
-      double t = (m_k - r.Origin.z) / r.Direction.z;
-      if (t >= tMin && t <= tMax)
-      {
-         double x = r.Origin.x + (t * r.Direction.x);
-         double y = r.Origin.y + (t * r.Direction.y);
-
-         bool bHitXAxis = (x >= m_x0 && x <= m_x1);
-         bool bHitYAxis = (y >= m_y0 && y <= m_y1);
-         if (bHitXAxis && bHitYAxis)
-         {
-            rec.u = (x - m_x0) / (m_x1 - m_x0);
-            rec.v = (y - m_y0) / (m_y1 - m_y0);
-            rec.t = t;
-
-            Vec3 outwardNormal = Vec3(0.0, 0.0, 1.0);
-            rec.SetFaceNormal(r, outwardNormal);
-            rec.MatPtr = m_matPtr;
-            rec.p = r.At(t);
-            return true;
-         }
-      }
-      return false;
+      RT_STAT_INCREMENT(StatCounter::XYRectTests);
+      return HitAxisAlignedRect<0, 1, 2>(m_x0, m_x1, m_y0, m_y1, m_k, m_material, r, tMin, tMax, rec);
    }
 
    bool BoundingBox(double time0, double time1, AABB& outputBox) const override
@@ -51,7 +61,7 @@ public:
    }
 
 private:
-   std::shared_ptr<Material> m_matPtr;
+   uint32_t m_material = 0;
    double m_x0 = -0.5;
    double m_x1 = 0.5;
    double m_y0 = -0.5;
@@ -64,40 +74,20 @@ class XZRect : public Hittable
 {
 public:
    XZRect() = default;
-   XZRect(double x0, double x1, double z0, double z1, double k, std::shared_ptr<Material> matPtr) :
+   XZRect(double x0, double x1, double z0, double z1, double k, uint32_t material) :
       m_x0(x0),
       m_x1(x1),
       m_z0(z0),
       m_z1(z1),
       m_k(k),
-      m_matPtr(matPtr)
+      m_material(material)
    {
    }
 
    bool Hit(const Ray & r, double tMin, double tMax, HitRecord & rec) const override
    {
-      double t = (m_k - r.Origin.y) / r.Direction.y;
-      if (t >= tMin && t <= tMax)
-      {
-         double x = r.Origin.x + (t * r.Direction.x);
-         double z = r.Origin.z + (t * r.Direction.z);
-
-         bool bHitXAxis = (x >= m_x0 && x <= m_x1);
-         bool bHitZAxis = (z >= m_z0 && z <= m_z1);
-         if (bHitXAxis && bHitZAxis)
-         {
-            rec.u = (x - m_x0) / (m_x1 - m_x0);
-            rec.v = (z - m_z0) / (m_z1 - m_z0);
-            rec.t = t;
-
-            Vec3 outwardNormal = Vec3(0.0, 1.0, 0.0);
-            rec.SetFaceNormal(r, outwardNormal);
-            rec.MatPtr = m_matPtr;
-            rec.p = r.At(t);
-            return true;
-         }
-      }
-      return false;
+      RT_STAT_INCREMENT(StatCounter::XZRectTests);
+      return HitAxisAlignedRect<0, 2, 1>(m_x0, m_x1, m_z0, m_z1, m_k, m_material, r, tMin, tMax, rec);
    }
 
    bool BoundingBox(double time0, double time1, AABB & outputBox) const override
@@ -108,7 +98,7 @@ public:
    }
 
 private:
-   std::shared_ptr<Material> m_matPtr;
+   uint32_t m_material = 0;
    double m_x0 = -0.5;
    double m_x1 = 0.5;
    double m_z0 = -0.5;
@@ -121,40 +111,20 @@ class YZRect : public Hittable
 {
 public:
    YZRect() = default;
-   YZRect(double y0, double y1, double z0, double z1, double k, std::shared_ptr<Material> matPtr) :
+   YZRect(double y0, double y1, double z0, double z1, double k, uint32_t material) :
       m_y0(y0),
       m_y1(y1),
       m_z0(z0),
       m_z1(z1),
       m_k(k),
-      m_matPtr(matPtr)
+      m_material(material)
    {
    }
 
    bool Hit(const Ray& r, double tMin, double tMax, HitRecord& rec) const override
    {
-      double t = (m_k - r.Origin.x) / r.Direction.x;
-      if (t >= tMin && t <= tMax)
-      {
-         double y = r.Origin.y + (t * r.Direction.y);
-         double z = r.Origin.z + (t * r.Direction.z);
-
-         bool bHitYAxis = (y >= m_y0 && y <= m_y1);
-         bool bHitZAxis = (z >= m_z0 && z <= m_z1);
-         if (bHitYAxis && bHitZAxis)
-         {
-            rec.u = (y - m_y0) / (m_y1 - m_y0);
-            rec.v = (z - m_z0) / (m_z1 - m_z0);
-            rec.t = t;
-
-            Vec3 outwardNormal = Vec3(1.0, 0.0, 0.0);
-            rec.SetFaceNormal(r, outwardNormal);
-            rec.MatPtr = m_matPtr;
-            rec.p = r.At(t);
-            return true;
-         }
-      }
-      return false;
+      RT_STAT_INCREMENT(StatCounter::YZRectTests);
+      return HitAxisAlignedRect<1, 2, 0>(m_y0, m_y1, m_z0, m_z1, m_k, m_material, r, tMin, tMax, rec);
    }
 
    bool BoundingBox(double time0, double time1, AABB& outputBox) const override
@@ -165,7 +135,7 @@ public:
    }
 
 private:
-   std::shared_ptr<Material> m_matPtr;
+   uint32_t m_material = 0;
    double m_y0 = -0.5;
    double m_y1 = 0.5;
    double m_z0 = -0.5;
@@ -0,0 +1,151 @@
+#pragma once
+#include <Core/CoreMinimal.h>
+#include <Core/Profiler.h>
+
+namespace RenderBudgetConstants
+{
+   // First pass only measures how fast the scene renders, so it is kept as short as possible.
+   constexpr int CalibrationSamplesPerPixel = 1;
+   // Fraction of the remaining time held back against error of the estimate.
+   constexpr double SafetyMargin = 0.05;
+   // Passes take half of the samples which fit in the remaining time, so the estimate is refined by every pass,
+   // until this few are left and the last pass takes all of them.
+   constexpr int FinalPassSamplesPerPixel = 8;
+   // Held back for writing output images after rendering; an 800x800 PNG takes a fraction of it.
+   constexpr double OutputReserveSeconds = 0.5;
+}
+
+// Chooses samples per pixel of every pass of a render which has to be done by a deadline. Every pass covers the
+// whole image, so its time is a fixed cost (seeding pixels, merging into the framebuffer) plus a nearly constant time
+// per sample per pixel; both are fitted by least squares to the passes so far and predict the next one. Use BeginPass
+// as planner of Renderer::Render and EndPass once a pass is done.
+class RenderBudget
+{
+public:
+   using Clock = RenderProfiler::Clock;
+
+public:
+   // maximumSamplesPerPass of zero places no limit on passes but the budget itself.
+   RenderBudget(Clock::time_point deadline, int maximumSamplesPerPixel, int maximumSamplesPerPass) :
+      m_deadline(deadline),
+      m_maximumSamplesPerPixel(maximumSamplesPerPixel),
+      m_maximumSamplesPerPass(maximumSamplesPerPass)
+   {
+   }
+
+   // Samples per pixel of the next pass, zero when no more fit before the deadline. Calibration pass always runs,
+   // so that there is an image even if the budget was spent before rendering.
+   int BeginPass()
+   {
+      m_passBegin = Clock::now();
+      const int remainingSamples = m_maximumSamplesPerPixel - m_completedSamples;
+      if (m_completedSamples == 0)
+      {
+         m_passSamples = std::min(RenderBudgetConstants::CalibrationSamplesPerPixel, remainingSamples);
+         return m_passSamples;
+      }
+
+      // Samples of a single pass which would end right at the deadline, less the margin.
+      const double remainingSeconds = RenderProfiler::SecondsBetween(m_passBegin, m_deadline) * (1.0 - RenderBudgetConstants::SafetyMargin);
+      const double affordable = (remainingSeconds - m_passSeconds) / m_sampleSeconds;
+      const int affordableSamples = static_cast<int>(std::clamp(std::floor(affordable), 0.0, static_cast<double>(remainingSamples)));
+      m_passSamples = affordableSamples;
+      if (m_passSamples > RenderBudgetConstants::FinalPassSamplesPerPixel)
+      {
+         m_passSamples = std::max(RenderBudgetConstants::FinalPassSamplesPerPixel, m_passSamples / 2);
+      }
+
+      if (m_maximumSamplesPerPass > 0)
+      {
+         m_passSamples = std::min(m_passSamples, m_maximumSamplesPerPass);
+      }
+
+      if (m_passSamples == 0)
+      {
+         return 0;
+      }
+
+      // Remaining passes take about as long as the affordable samples in passes of this size.
+      const int remainingPasses = (affordableSamples + m_passSamples - 1) / m_passSamples;
+      m_predictedSamples = m_completedSamples + affordableSamples;
+      m_predictedFinish = m_passBegin + ToDuration(remainingPasses * m_passSeconds + affordableSamples * m_sampleSeconds);
+      if (!m_bPlanned)
+      {
+         m_plannedSamples = m_predictedSamples;
+         m_plannedFinish = m_predictedFinish;
+         m_bPlanned = true;
+      }
+
+      return m_passSamples;
+   }
+
+   void EndPass()
+   {
+      const double seconds = RenderProfiler::SecondsBetween(m_passBegin, Clock::now());
+      const double samples = m_passSamples;
+      ++m_passCount;
+      m_sumSamples += samples;
+      m_sumSeconds += seconds;
+      m_sumSamplesSquared += samples * samples;
+      m_sumSamplesSeconds += samples * seconds;
+      m_completedSamples += m_passSamples;
+      m_passSamples = 0;
+
+      // Until passes of different sizes were measured, the fixed cost is counted as part of the samples.
+      const double samplesVariance = m_passCount * m_sumSamplesSquared - m_sumSamples * m_sumSamples;
+      const double slope = samplesVariance > 0.0 ? (m_passCount * m_sumSamplesSeconds - m_sumSamples * m_sumSeconds) / samplesVariance : 0.0;
+      if (slope > 0.0)
+      {
+         m_sampleSeconds = slope;
+         m_passSeconds = std::max(0.0, (m_sumSeconds - slope * m_sumSamples) / m_passCount);
+      }
+      else
+      {
+         m_sampleSeconds = m_sumSeconds / std::max(1.0, m_sumSamples);
+         m_passSeconds = 0.0;
+      }
+   }
+
+   int GetCompletedSamples() const { return m_completedSamples; }
+   double GetSecondsPerSample() const { return m_sampleSeconds; }
+   double GetSecondsPerPass() const { return m_passSeconds; }
+
+   // Plan made right after calibration; false until then.
+   bool HasPlan() const { return m_bPlanned; }
+   int GetPlannedSamples() const { return m_plannedSamples; }
+   Clock::time_point GetPlannedFinish() const { return m_plannedFinish; }
+
+   // Latest prediction, made before the last pass.
+   int GetPredictedSamples() const { return m_predictedSamples; }
+   Clock::time_point GetPredictedFinish() const { return m_predictedFinish; }
+
+private:
+   static Clock::duration ToDuration(double seconds)
+   {
+      return std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(seconds));
+   }
+
+private:
+   Clock::time_point m_deadline;
+   int m_maximumSamplesPerPixel = 0;
+   int m_maximumSamplesPerPass = 0;
+   Clock::time_point m_passBegin;
+   int m_passSamples = 0;
+   int m_completedSamples = 0;
+
+   // Least squares fit of pass time to samples per pixel
+   int m_passCount = 0;
+   double m_sumSamples = 0.0;
+   double m_sumSeconds = 0.0;
+   double m_sumSamplesSquared = 0.0;
+   double m_sumSamplesSeconds = 0.0;
+   double m_sampleSeconds = 0.0;
+   double m_passSeconds = 0.0;
+
+   bool m_bPlanned = false;
+   int m_plannedSamples = 0;
+   Clock::time_point m_plannedFinish;
+   int m_predictedSamples = 0;
+   Clock::time_point m_predictedFinish;
+
+};
@@ -0,0 +1,117 @@
+#pragma once
+#include <Core/CoreMinimal.h>
+#include <Core/AtomicFile.h>
+#include <Core/Framebuffer.h>
+#include <Core/Renderer.h>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <string_view>
+
+namespace RenderCheckpointConstants
+{
+   constexpr char Magic[8] = { 'R', 'T', 'C', 'K', 'P', 'T', '\0', '\0' };
+   constexpr uint32_t Version = 3;
+}
+
+struct RenderCheckpointHeader
+{
+public:
+   char Magic[8];
+   uint32_t Version;
+   uint32_t CompletedPasses;
+   int32_t ImageWidth;
+   int32_t ImageHeight;
+   int32_t SamplesPerPixel;
+   int32_t SamplesPerPass;
+   int32_t MaximumDepth;
+   uint32_t Sampler;
+   uint32_t bTrackVariance;
+   uint64_t Seed;
+   uint64_t SceneHash;
+
+};
+
+// Framebuffer of a render in progress, saved between passes. Samples are derived from (seed, pixel, sample index),
+// so the seed and the sample counts of the framebuffer restore them exactly; a resumed render produces the same image
+// as one that was never interrupted.
+class RenderCheckpoint
+{
+public:
+   // Identifies the scene and camera, so that a checkpoint is never resumed with a different one.
+   static uint64_t HashSceneKey(std::string_view key)
+   {
+      // FNV-1a
+      uint64_t hash = 14695981039346656037ull;
+      for (char character : key)
+      {
+         hash ^= static_cast<uint8_t>(character);
+         hash *= 1099511628211ull;
+      }
+
+      return hash;
+   }
+
+   static bool Write(const std::filesystem::path& path, const RenderSettings& settings, const Renderer& renderer,
+      uint64_t sceneHash, int completedPasses, const Framebuffer& framebuffer)
+   {
+      const RenderCheckpointHeader header = MakeHeader(settings, renderer, sceneHash, completedPasses);
+
+      // A crash while writing keeps the previous checkpoint.
+      return WriteFileAtomically(path, "checkpoint", [&](std::ofstream& stream)
+         {
+            stream.write(reinterpret_cast<const char*>(&header), sizeof(header));
+            framebuffer.Write(stream);
+         });
+   }
+
+   // Fails when the checkpoint can't be read or was written with other settings or another scene.
+   static bool Load(const std::filesystem::path& path, const RenderSettings& settings, const Renderer& renderer,
+      uint64_t sceneHash, Framebuffer& framebuffer, int& completedPasses)
+   {
+      std::ifstream stream(path, std::ios::binary);
+      RenderCheckpointHeader header;
+      if (!stream.read(reinterpret_cast<char*>(&header), sizeof(header)))
+      {
+         std::cerr << "Failed to read checkpoint '" << path.string() << "'.\n";
+         return false;
+      }
+
+      const RenderCheckpointHeader expected = MakeHeader(settings, renderer, sceneHash, header.CompletedPasses);
+      if (std::memcmp(&header, &expected, sizeof(header)) != 0 || header.CompletedPasses > static_cast<uint32_t>(renderer.GetPassCount()))
+      {
+         std::cerr << "Checkpoint '" << path.string() << "' was written by a render of different scene or settings.\n";
+         return false;
+      }
+
+      if (!framebuffer.Read(stream) || stream.peek() != std::ifstream::traits_type::eof())
+      {
+         std::cerr << "Checkpoint '" << path.string() << "' is truncated or corrupted.\n";
+         return false;
+      }
+
+      completedPasses = static_cast<int>(header.CompletedPasses);
+      return true;
+   }
+
+private:
+   static RenderCheckpointHeader MakeHeader(const RenderSettings& settings, const Renderer& renderer, uint64_t sceneHash, uint32_t completedPasses)
+   {
+      RenderCheckpointHeader header;
+      std::memset(&header, 0, sizeof(header));
+      std::memcpy(header.Magic, RenderCheckpointConstants::Magic, sizeof(header.Magic));
+      header.Version = RenderCheckpointConstants::Version;
+      header.CompletedPasses = completedPasses;
+      header.ImageWidth = settings.ImageWidth;
+      header.ImageHeight = settings.ImageHeight;
+      header.SamplesPerPixel = settings.SamplesPerPixel;
+      header.SamplesPerPass = renderer.GetSamplesPerPass();
+      header.MaximumDepth = settings.MaximumDepth;
+      header.Sampler = static_cast<uint32_t>(settings.Sampler);
+      header.bTrackVariance = settings.bTrackVariance ? 1 : 0;
+      header.Seed = settings.Seed;
+      header.SceneHash = sceneHash;
+      return header;
+   }
+
+};
@@ -0,0 +1,65 @@
+#pragma once
+#include <Core/CoreMinimal.h>
+#include <string>
+
+// Features a scene may use, which render kernels are compiled with or without. A kernel compiled without a feature
+// skips its work entirely, so a static scene seen through a pinhole camera pays nothing for motion blur or a lens.
+// Kernels take a mask of features as a template parameter; the one to run is picked when rendering starts.
+enum class RenderFeature : uint32_t
+{
+   MotionBlur = 0, // Shutter of the camera is open for a while
+   DepthOfField,   // Camera has a lens
+   Volumes,        // Isotropic materials of participating media
+   Emissives,      // Diffuse lights
+   Count
+};
+
+namespace RenderFeatureConstants
+{
+   constexpr size_t FeatureCount = static_cast<size_t>(RenderFeature::Count);
+   constexpr const char* FeatureNames[FeatureCount] = { "MotionBlur", "DepthOfField", "Volumes", "Emissives" };
+   constexpr uint32_t AllFeatures = (1u << FeatureCount) - 1;
+}
+
+constexpr uint32_t FeatureBit(RenderFeature feature)
+{
+   return 1u << static_cast<uint32_t>(feature);
+}
+
+constexpr bool HasFeature(uint32_t features, RenderFeature feature)
+{
+   return (features & FeatureBit(feature)) != 0;
+}
+
+// Names of the features of a mask, separated by '|'; "None" for none.
+inline std::string FeatureNamesOf(uint32_t features)
+{
+   std::string names;
+   for (size_t idx = 0; idx < RenderFeatureConstants::FeatureCount; ++idx)
+   {
+      if (HasFeature(features, static_cast<RenderFeature>(idx)))
+      {
+         names += (names.empty() ? "" : "|");
+         names += RenderFeatureConstants::FeatureNames[idx];
+      }
+   }
+
+   return names.empty() ? "None" : names;
+}
+
+// Calls function.template operator()<Mask>() with Mask equal to features, one instantiation per combination.
+template<uint32_t Mask = 0, typename Function>
+void DispatchRenderFeatures(uint32_t features, Function&& function)
+{
+   if constexpr (Mask <= RenderFeatureConstants::AllFeatures)
+   {
+      if (features == Mask)
+      {
+         function.template operator()<Mask>();
+      }
+      else
+      {
+         DispatchRenderFeatures<Mask + 1>(features, std::forward<Function>(function));
+      }
+   }
+}
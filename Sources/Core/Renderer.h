@@ -0,0 +1,214 @@
+#pragma once
+#include <Core/CoreMinimal.h>
+#include <Core/Color.h>
+#include <Core/Camera.h>
+#include <Core/Framebuffer.h>
+#include <Core/Hittable.h>
+#include <Core/Integrator.h>
+#include <Core/Profiler.h>
+#include <Core/RenderFeatures.h>
+#include <Core/Sampler.h>
+#include <Core/Statistics.h>
+#include <Core/WavefrontIntegrator.h>
+#include <functional>
+
+struct RenderSettings
+{
+public:
+   int ImageWidth = 800;
+   int ImageHeight = 800;
+   int SamplesPerPixel = 8192;
+   int MaximumDepth = 50;
+   int SamplesPerPass = 0; // Zero to take every sample in a single pass
+   uint64_t Seed = 0;
+   SamplerType Sampler = SamplerType::Sobol;
+   IntegratorType Integrator = IntegratorType::Megakernel;
+   int PacketSize = 0; // Camera rays per packet of the wavefront integrator, zero to trace them one by one
+   bool bReorderRays = false; // Sort secondary rays of the wavefront integrator by origin and direction before tracing
+   bool bSpecializeKernels = true; // Render with kernels compiled for the features the scene uses, rather than all of them
+   bool bTrackVariance = false;
+   bool bReportProgress = true;
+
+};
+
+// Renders scanlines in parallel, in one or more passes of SamplesPerPass samples each. Samples are indexed by
+// (pixel, sample, dimension), counting samples of earlier passes, and participating media draw from a hash of the
+// ray. So the image depends only on the settings and never on the thread count, scheduling, the integrator, or whether
+// the passes ran in one process or were resumed from a checkpoint.
+class Renderer
+{
+public:
+   Renderer(const RenderSettings& settings) :
+      m_settings(settings)
+   {
+   }
+
+   Framebuffer Render(const Camera& camera, const Hittable& world, const MaterialTable& materials, const Color& background) const
+   {
+      Framebuffer framebuffer(m_settings.ImageWidth, m_settings.ImageHeight, m_settings.bTrackVariance);
+      Render(camera, world, materials, background, framebuffer, 0, nullptr);
+      return framebuffer;
+   }
+
+   // Renders passes from firstPass on into framebuffer. onPassDone is called with the number of completed passes
+   // after each pass, and stops rendering by returning false.
+   void Render(const Camera& camera, const Hittable& world, const MaterialTable& materials, const Color& background,
+      Framebuffer& framebuffer, int firstPass, const std::function<bool(int)>& onPassDone) const
+   {
+      Render(camera, world, materials, background, framebuffer, firstPass, [this](int pass) { return GetSamplesOfPass(pass); },
+         onPassDone);
+   }
+
+   // Same, with samples per pixel of every pass chosen by planPass right before the pass; zero ends rendering.
+   void Render(const Camera& camera, const Hittable& world, const MaterialTable& materials, const Color& background,
+      Framebuffer& framebuffer, int firstPass, const std::function<int(int)>& planPass, const std::function<bool(int)>& onPassDone) const
+   {
+      const int imageWidth = m_settings.ImageWidth;
+      const int imageHeight = m_settings.ImageHeight;
+
+#if RT_ENABLE_STATS
+      Statistics::Initialize(imageWidth, imageHeight);
+#endif
+
+#ifdef _OPENMP
+      const int threadCount = omp_get_max_threads();
+#else
+      const int threadCount = 1;
+#endif
+      auto& profiler = RenderProfiler::Instance();
+      profiler.SetSetting("imageWidth", imageWidth);
+      profiler.SetSetting("imageHeight", imageHeight);
+      profiler.SetSetting("samplesPerPixel", m_settings.SamplesPerPixel);
+      profiler.SetSetting("samplesPerPass", GetSamplesPerPass());
+      profiler.SetSetting("maximumDepth", m_settings.MaximumDepth);
+      profiler.SetSetting("seed", m_settings.Seed);
+      profiler.SetSetting("sampler", SamplerConstants::SamplerNames[static_cast<size_t>(m_settings.Sampler)]);
+      profiler.SetSetting("integrator", IntegratorConstants::IntegratorNames[static_cast<size_t>(m_settings.Integrator)]);
+      profiler.SetSetting("packetSize", m_settings.PacketSize);
+      profiler.SetSetting("reorderRays", m_settings.bReorderRays);
+      const uint32_t features = m_settings.bSpecializeKernels ? camera.GetFeatures() | materials.GetFeatures() : RenderFeatureConstants::AllFeatures;
+      profiler.SetSetting("features", FeatureNamesOf(features));
+      profiler.SetSetting("threads", threadCount);
+      profiler.ResetThreads(threadCount);
+      RenderProfiler::ScopedPhase phase(RenderPhase::Render);
+
+      for (int pass = firstPass; ; ++pass)
+      {
+         const int samplesPerPixel = planPass(pass);
+         if (samplesPerPixel <= 0)
+         {
+            break;
+         }
+
+         DispatchRenderFeatures(features, [&]<uint32_t Features>()
+            {
+               RenderPass<Features>(camera, world, materials, background, framebuffer, pass, samplesPerPixel);
+            });
+         if (onPassDone && !onPassDone(pass + 1))
+         {
+            break;
+         }
+      }
+
+      if (m_settings.bReportProgress)
+      {
+         std::cerr << "\nRendering Done\n";
+      }
+   }
+
+   int GetSamplesPerPass() const
+   {
+      return m_settings.SamplesPerPass > 0 ? std::min(m_settings.SamplesPerPass, m_settings.SamplesPerPixel) : m_settings.SamplesPerPixel;
+   }
+
+   int GetPassCount() const
+   {
+      return (m_settings.SamplesPerPixel + GetSamplesPerPass() - 1) / GetSamplesPerPass();
+   }
+
+   // Zero past the last pass.
+   int GetSamplesOfPass(int pass) const
+   {
+      return std::max(0, std::min(GetSamplesPerPass(), m_settings.SamplesPerPixel - pass * GetSamplesPerPass()));
+   }
+
+   const RenderSettings& GetSettings() const { return m_settings; }
+
+private:
+   template<uint32_t Features>
+   void RenderPass(const Camera& camera, const Hittable& world, const MaterialTable& materials, const Color& background,
+      Framebuffer& framebuffer, int pass, int samplesPerPixel) const
+   {
+      const int imageWidth = m_settings.ImageWidth;
+      const int imageHeight = m_settings.ImageHeight;
+      const CameraRayGenerator cameraRays(camera, imageWidth, imageHeight);
+      auto& profiler = RenderProfiler::Instance();
+
+#pragma omp parallel
+      {
+         double busySeconds = 0.0;
+         Sampler sampler(m_settings.Sampler, m_settings.SamplesPerPixel, m_settings.Seed);
+         WavefrontIntegrator wavefront(imageWidth, imageHeight, m_settings.MaximumDepth, m_settings.PacketSize, m_settings.bReorderRays);
+         auto& counters = RenderProfiler::ThreadCounters();
+         counters = RayCounters();
+
+#pragma omp for schedule(dynamic, 1) nowait
+         for (int dy = imageHeight - 1; dy >= 0; --dy)
+         {
+            auto scanlineBegin = RenderProfiler::Clock::now();
+            if (m_settings.bReportProgress)
+            {
+               std::cerr << "\rPass " << pass + 1 << ", Scanlines Reamining : " << dy << ' ' << std::flush;
+            }
+
+            if (m_settings.Integrator == IntegratorType::Wavefront)
+            {
+               wavefront.RenderScanline<Features>(cameraRays, world, materials, background, framebuffer, dy, samplesPerPixel, sampler, counters);
+            }
+            else
+            {
+               RenderScanline<Features>(cameraRays, world, materials, background, framebuffer, dy, samplesPerPixel, sampler, counters);
+            }
+
+            busySeconds += RenderProfiler::SecondsBetween(scanlineBegin, RenderProfiler::Clock::now());
+         }
+
+         profiler.RecordThread(RenderProfiler::ThreadIndex(), busySeconds, counters);
+      }
+   }
+
+   // Megakernel integrator: every sample of a pixel, one path at a time.
+   template<uint32_t Features>
+   void RenderScanline(const CameraRayGenerator& cameraRays, const Hittable& world, const MaterialTable& materials, const Color& background,
+      Framebuffer& framebuffer, int dy, int samplesPerPixel, Sampler& sampler, RayCounters& counters) const
+   {
+      const int imageWidth = m_settings.ImageWidth;
+      const int imageHeight = m_settings.ImageHeight;
+      for (int dx = 0; dx < imageWidth; ++dx)
+      {
+         const size_t pixelIndex = static_cast<size_t>(imageHeight - dy - 1) * imageWidth + dx;
+         const uint32_t firstSample = framebuffer.SampleCount(pixelIndex);
+#if RT_ENABLE_STATS
+         Statistics::BeginPixel();
+#endif
+         PixelSamples samples;
+         counters.Samples += samplesPerPixel;
+         for (int ds = 0; ds < samplesPerPixel; ++ds)
+         {
+            RT_STAT_INCREMENT(StatCounter::Samples);
+            sampler.StartPixelSample(dx, imageHeight - dy - 1, firstSample + ds);
+            const Ray r = cameraRays.Generate<Features>(dx, dy, sampler);
+            samples.Add(RayColor<Features>(r, background, world, materials, m_settings.MaximumDepth, sampler));
+         }
+
+         framebuffer.AddSamples(pixelIndex, samples);
+#if RT_ENABLE_STATS
+         Statistics::EndPixel(pixelIndex);
+#endif
+      }
+   }
+
+private:
+   RenderSettings m_settings;
+
+};
@@ -0,0 +1,182 @@
+#pragma once
+#include <Core/BVHBuildTypes.h>
+
+// Binned SAH builder.
+class SAHBVHBuilder
+{
+public:
+   SAHBVHBuilder(std::vector<BVHPrimitiveInfo> primitives) :
+      m_primitives(std::move(primitives))
+   {
+   }
+
+   FlatBVHData Build()
+   {
+      FlatBVHData result;
+      if (m_primitives.empty())
+      {
+         return result;
+      }
+
+      result.Nodes.reserve(2 * m_primitives.size());
+      result.PrimitiveIndices.reserve(m_primitives.size());
+      BuildRecursive(result, 0, m_primitives.size(), 0);
+      return result;
+   }
+
+private:
+   uint32_t BuildRecursive(FlatBVHData& data, size_t start, size_t end, size_t depth)
+   {
+      uint32_t nodeIndex = static_cast<uint32_t>(data.Nodes.size());
+      data.Nodes.emplace_back();
+
+      AABB bounds = AABB::Empty();
+      AABB centroidBounds = AABB::Empty();
+      for (size_t idx = start; idx < end; ++idx)
+      {
+         bounds = AABB::SurroundingBox(bounds, m_primitives[idx].Bounds);
+         centroidBounds = AABB::SurroundingBox(centroidBounds, AABB(m_primitives[idx].Centroid, m_primitives[idx].Centroid));
+      }
+
+      const size_t primitiveCount = end - start;
+      const int axis = centroidBounds.MaximumExtent();
+      const double axisMin = centroidBounds.Minimum[axis];
+      const double axisMax = centroidBounds.Maximum[axis];
+      if (primitiveCount == 1 || axisMax <= axisMin)
+      {
+         if (primitiveCount <= BVHBuildConstants::MaxPrimitivesInLeaf)
+         {
+            EmitLeaf(data, nodeIndex, bounds, start, end);
+            return nodeIndex;
+         }
+
+         // Every centroid is at the same position; fall back to split by count.
+         auto mid = start + primitiveCount / 2;
+         EmitInterior(data, nodeIndex, bounds, axis, start, mid, end, depth);
+         return nodeIndex;
+      }
+
+      // Close to the depth the traversal stack allows, split at the median so the subtree stays balanced.
+      if (depth + CountSplitDepth(primitiveCount) >= BVHBuildConstants::MaxDepth)
+      {
+         if (primitiveCount <= BVHBuildConstants::MaxPrimitivesInLeaf)
+         {
+            EmitLeaf(data, nodeIndex, bounds, start, end);
+            return nodeIndex;
+         }
+
+         auto mid = start + primitiveCount / 2;
+         std::nth_element(m_primitives.begin() + start, m_primitives.begin() + mid, m_primitives.begin() + end,
+            [axis](const BVHPrimitiveInfo& lhs, const BVHPrimitiveInfo& rhs)
+            {
+               return lhs.Centroid[axis] < rhs.Centroid[axis];
+            });
+
+         EmitInterior(data, nodeIndex, bounds, axis, start, mid, end, depth);
+         return nodeIndex;
+      }
+
+      struct Bucket
+      {
+         size_t Count = 0;
+         AABB Bounds = AABB::Empty();
+      };
+
+      Bucket buckets[BVHBuildConstants::NumBuckets];
+      auto bucketOf = [axis, axisMin, axisMax](const BVHPrimitiveInfo& info)
+      {
+         auto bucket = static_cast<size_t>(BVHBuildConstants::NumBuckets * ((info.Centroid[axis] - axisMin) / (axisMax - axisMin)));
+         return std::min(bucket, BVHBuildConstants::NumBuckets - 1);
+      };
+
+      for (size_t idx = start; idx < end; ++idx)
+      {
+         auto& bucket = buckets[bucketOf(m_primitives[idx])];
+         ++bucket.Count;
+         bucket.Bounds = AABB::SurroundingBox(bucket.Bounds, m_primitives[idx].Bounds);
+      }
+
+      // Sweep from both sides to evaluate every bucket boundary in linear time.
+      double rightArea[BVHBuildConstants::NumBuckets] = {};
+      size_t rightCount[BVHBuildConstants::NumBuckets] = {};
+      AABB accumulated = AABB::Empty();
+      size_t count = 0;
+      for (size_t bucket = BVHBuildConstants::NumBuckets - 1; bucket > 0; --bucket)
+      {
+         accumulated = AABB::SurroundingBox(accumulated, buckets[bucket].Bounds);
+         count += buckets[bucket].Count;
+         rightArea[bucket] = count > 0 ? accumulated.SurfaceArea() : 0.0;
+         rightCount[bucket] = count;
+      }
+
+      double minCost = Infinity;
+      size_t minCostSplit = 0;
+      accumulated = AABB::Empty();
+      count = 0;
+      for (size_t bucket = 0; bucket < BVHBuildConstants::NumBuckets - 1; ++bucket)
+      {
+         accumulated = AABB::SurroundingBox(accumulated, buckets[bucket].Bounds);
+         count += buckets[bucket].Count;
+         double leftArea = count > 0 ? accumulated.SurfaceArea() : 0.0;
+         double cost = count * leftArea + rightCount[bucket + 1] * rightArea[bucket + 1];
+         if (cost < minCost)
+         {
+            minCost = cost;
+            minCostSplit = bucket;
+         }
+      }
+
+      const double parentArea = bounds.SurfaceArea();
+      minCost = BVHBuildConstants::TraversalCost + (parentArea > 0.0 ? minCost / parentArea : 0.0);
+      const double leafCost = static_cast<double>(primitiveCount);
+      if (primitiveCount <= BVHBuildConstants::MaxPrimitivesInLeaf && leafCost <= minCost)
+      {
+         EmitLeaf(data, nodeIndex, bounds, start, end);
+         return nodeIndex;
+      }
+
+      auto midIter = std::partition(m_primitives.begin() + start, m_primitives.begin() + end,
+         [&bucketOf, minCostSplit](const BVHPrimitiveInfo& info)
+         {
+            return bucketOf(info) <= minCostSplit;
+         });
+
+      auto mid = static_cast<size_t>(midIter - m_primitives.begin());
+      if (mid == start || mid == end)
+      {
+         mid = start + primitiveCount / 2;
+      }
+
+      EmitInterior(data, nodeIndex, bounds, axis, start, mid, end, depth);
+      return nodeIndex;
+   }
+
+   void EmitLeaf(FlatBVHData& data, uint32_t nodeIndex, const AABB& bounds, size_t start, size_t end)
+   {
+      auto& node = data.Nodes[nodeIndex];
+      node.Bounds = bounds;
+      node.Offset = static_cast<uint32_t>(data.PrimitiveIndices.size());
+      node.PrimitiveCount = static_cast<uint16_t>(end - start);
+      for (size_t idx = start; idx < end; ++idx)
+      {
+         data.PrimitiveIndices.push_back(m_primitives[idx].Index);
+      }
+   }
+
+   void EmitInterior(FlatBVHData& data, uint32_t nodeIndex, const AABB& bounds, int axis, size_t start, size_t mid, size_t end, size_t depth)
+   {
+      BuildRecursive(data, start, mid, depth + 1);
+      uint32_t secondChild = BuildRecursive(data, mid, end, depth + 1);
+
+      // Node vector may have been reallocated by the recursive calls.
+      auto& node = data.Nodes[nodeIndex];
+      node.Bounds = bounds;
+      node.Offset = secondChild;
+      node.PrimitiveCount = 0;
+      node.Axis = static_cast<uint8_t>(axis);
+   }
+
+private:
+   std::vector<BVHPrimitiveInfo> m_primitives;
+
+};
@@ -0,0 +1,493 @@
+#pragma once
+#include <Core/BVHBuildTypes.h>
+
+namespace SBVHConstants
+{
+   constexpr size_t NumSpatialBins = 16;
+   constexpr size_t MaxSpatialSplitDepth = 64;
+   constexpr double DefaultDuplicationBudget = 0.3; // Up to 30% more references than primitives
+   constexpr double OverlapThreshold = 1e-5;        // Relative to the root surface area (alpha in Stich et al.)
+}
+
+// Spatial split BVH builder after Stich et al., "Spatial Splits in Bounding Volume Hierarchies" (2009).
+// Chooses between binned SAH object splits and spatial splits which clip primitive references against the split
+// plane. Spatial splits are only tried where object split children overlap noticeably and while the number of
+// references stays under the duplication budget.
+class SBVHBuilder
+{
+public:
+   SBVHBuilder(std::vector<BVHPrimitiveInfo> primitives, const std::vector<std::shared_ptr<Hittable>>& objects, double time0, double time1,
+      double duplicationBudget = SBVHConstants::DefaultDuplicationBudget) :
+      m_primitives(std::move(primitives)),
+      m_objects(objects),
+      m_time0(time0),
+      m_time1(time1),
+      m_maxReferences(static_cast<size_t>(m_primitives.size() * (1.0 + duplicationBudget)))
+   {
+   }
+
+   FlatBVHData Build()
+   {
+      FlatBVHData result;
+      if (m_primitives.empty())
+      {
+         return result;
+      }
+
+      std::vector<Reference> references;
+      references.reserve(m_primitives.size());
+      AABB rootBounds = AABB::Empty();
+      for (const auto& info : m_primitives)
+      {
+         references.push_back(Reference{ info.Index, info.Bounds });
+         rootBounds = AABB::SurroundingBox(rootBounds, info.Bounds);
+      }
+
+      m_referenceCount = references.size();
+      m_rootArea = rootBounds.SurfaceArea();
+      result.Nodes.reserve(2 * m_maxReferences);
+      result.PrimitiveIndices.reserve(m_maxReferences);
+      BuildRecursive(result, std::move(references), 0);
+      return result;
+   }
+
+   size_t GetReferenceCount() const { return m_referenceCount; }
+
+private:
+   struct Reference
+   {
+      uint32_t Index;
+      AABB Bounds;
+   };
+
+   struct ObjectSplit
+   {
+      double Cost = Infinity;
+      int Axis = 0;
+      size_t Bucket = 0;
+      double AxisMin = 0.0;
+      double AxisMax = 0.0;
+      AABB LeftBounds = AABB::Empty();
+      AABB RightBounds = AABB::Empty();
+   };
+
+   struct SpatialSplit
+   {
+      double Cost = Infinity;
+      int Axis = 0;
+      double Position = 0.0;
+   };
+
+   uint32_t BuildRecursive(FlatBVHData& data, std::vector<Reference> references, size_t depth)
+   {
+      uint32_t nodeIndex = static_cast<uint32_t>(data.Nodes.size());
+      data.Nodes.emplace_back();
+
+      AABB bounds = AABB::Empty();
+      AABB centroidBounds = AABB::Empty();
+      for (const auto& reference : references)
+      {
+         bounds = AABB::SurroundingBox(bounds, reference.Bounds);
+         Point3 centroid = reference.Bounds.Centroid();
+         centroidBounds = AABB::SurroundingBox(centroidBounds, AABB(centroid, centroid));
+      }
+
+      const size_t referenceCount = references.size();
+      if (referenceCount == 1)
+      {
+         EmitLeaf(data, nodeIndex, bounds, references);
+         return nodeIndex;
+      }
+
+      // Close to the depth the traversal stack allows, split by count so the subtree stays balanced.
+      if (depth + CountSplitDepth(referenceCount) >= BVHBuildConstants::MaxDepth)
+      {
+         if (referenceCount <= BVHBuildConstants::MaxPrimitivesInLeaf)
+         {
+            EmitLeaf(data, nodeIndex, bounds, references);
+            return nodeIndex;
+         }
+
+         std::vector<Reference> left;
+         std::vector<Reference> right;
+         PerformObjectSplit(references, ObjectSplit(), centroidBounds, left, right);
+         references.clear();
+         references.shrink_to_fit();
+         EmitInterior(data, nodeIndex, bounds, centroidBounds.MaximumExtent(), std::move(left), std::move(right), depth);
+         return nodeIndex;
+      }
+
+      const double area = bounds.SurfaceArea();
+      auto normalize = [area](double cost) { return BVHBuildConstants::TraversalCost + (area > 0.0 ? cost / area : 0.0); };
+
+      ObjectSplit objectSplit = FindObjectSplit(references, centroidBounds);
+      SpatialSplit spatialSplit;
+      if (depth < SBVHConstants::MaxSpatialSplitDepth && m_referenceCount < m_maxReferences && objectSplit.Cost < Infinity)
+      {
+         AABB overlap = AABB::Intersection(objectSplit.LeftBounds, objectSplit.RightBounds);
+         if (!overlap.IsEmpty() && overlap.SurfaceArea() > SBVHConstants::OverlapThreshold * m_rootArea)
+         {
+            spatialSplit = FindSpatialSplit(references, bounds);
+         }
+      }
+
+      const double leafCost = static_cast<double>(referenceCount);
+      const double objectCost = normalize(objectSplit.Cost);
+      const double spatialCost = normalize(spatialSplit.Cost);
+      if (referenceCount <= BVHBuildConstants::MaxPrimitivesInLeaf && leafCost <= std::min(objectCost, spatialCost))
+      {
+         EmitLeaf(data, nodeIndex, bounds, references);
+         return nodeIndex;
+      }
+
+      std::vector<Reference> left;
+      std::vector<Reference> right;
+      int axis = objectSplit.Axis;
+      if (spatialCost < objectCost && PerformSpatialSplit(references, spatialSplit, left, right))
+      {
+         axis = spatialSplit.Axis;
+      }
+      else
+      {
+         left.clear();
+         right.clear();
+         PerformObjectSplit(references, objectSplit, centroidBounds, left, right);
+         axis = objectSplit.Cost < Infinity ? objectSplit.Axis : centroidBounds.MaximumExtent();
+      }
+
+      references.clear();
+      references.shrink_to_fit();
+
+      EmitInterior(data, nodeIndex, bounds, axis, std::move(left), std::move(right), depth);
+      return nodeIndex;
+   }
+
+   void EmitInterior(FlatBVHData& data, uint32_t nodeIndex, const AABB& bounds, int axis,
+      std::vector<Reference> left, std::vector<Reference> right, size_t depth)
+   {
+      BuildRecursive(data, std::move(left), depth + 1);
+      uint32_t secondChild = BuildRecursive(data, std::move(right), depth + 1);
+
+      // Node vector may have been reallocated by the recursive calls.
+      auto& node = data.Nodes[nodeIndex];
+      node.Bounds = bounds;
+      node.Offset = secondChild;
+      node.PrimitiveCount = 0;
+      node.Axis = static_cast<uint8_t>(axis);
+   }
+
+   ObjectSplit FindObjectSplit(const std::vector<Reference>& references, const AABB& centroidBounds) const
+   {
+      ObjectSplit best;
+      best.Axis = centroidBounds.MaximumExtent();
+      best.AxisMin = centroidBounds.Minimum[best.Axis];
+      best.AxisMax = centroidBounds.Maximum[best.Axis];
+      if (best.AxisMax <= best.AxisMin)
+      {
+         return best;
+      }
+
+      size_t counts[BVHBuildConstants::NumBuckets] = {};
+      AABB bucketBounds[BVHBuildConstants::NumBuckets];
+      std::fill(std::begin(bucketBounds), std::end(bucketBounds), AABB::Empty());
+      for (const auto& reference : references)
+      {
+         size_t bucket = BucketOf(reference, best);
+         ++counts[bucket];
+         bucketBounds[bucket] = AABB::SurroundingBox(bucketBounds[bucket], reference.Bounds);
+      }
+
+      AABB rightBounds[BVHBuildConstants::NumBuckets];
+      size_t rightCounts[BVHBuildConstants::NumBuckets] = {};
+      AABB accumulated = AABB::Empty();
+      size_t count = 0;
+      for (size_t bucket = BVHBuildConstants::NumBuckets - 1; bucket > 0; --bucket)
+      {
+         accumulated = AABB::SurroundingBox(accumulated, bucketBounds[bucket]);
+         count += counts[bucket];
+         rightBounds[bucket] = accumulated;
+         rightCounts[bucket] = count;
+      }
+
+      accumulated = AABB::Empty();
+      count = 0;
+      for (size_t bucket = 0; bucket < BVHBuildConstants::NumBuckets - 1; ++bucket)
+      {
+         accumulated = AABB::SurroundingBox(accumulated, bucketBounds[bucket]);
+         count += counts[bucket];
+         const size_t rightCount = rightCounts[bucket + 1];
+         if (count == 0 || rightCount == 0)
+         {
+            continue;
+         }
+
+         double cost = count * accumulated.SurfaceArea() + rightCount * rightBounds[bucket + 1].SurfaceArea();
+         if (cost < best.Cost)
+         {
+            best.Cost = cost;
+            best.Bucket = bucket;
+            best.LeftBounds = accumulated;
+            best.RightBounds = rightBounds[bucket + 1];
+         }
+      }
+
+      return best;
+   }
+
+   static size_t BucketOf(const Reference& reference, const ObjectSplit& split)
+   {
+      double centroid = reference.Bounds.Centroid()[split.Axis];
+      auto bucket = static_cast<size_t>(BVHBuildConstants::NumBuckets * ((centroid - split.AxisMin) / (split.AxisMax - split.AxisMin)));
+      return std::min(bucket, BVHBuildConstants::NumBuckets - 1);
+   }
+
+   void PerformObjectSplit(std::vector<Reference>& references, const ObjectSplit& split, const AABB& centroidBounds,
+      std::vector<Reference>& left, std::vector<Reference>& right) const
+   {
+      if (split.Cost < Infinity)
+      {
+         for (const auto& reference : references)
+         {
+            (BucketOf(reference, split) <= split.Bucket ? left : right).push_back(reference);
+         }
+
+         if (!left.empty() && !right.empty())
+         {
+            return;
+         }
+
+         left.clear();
+         right.clear();
+      }
+
+      // Degenerate centroids; split by count.
+      const int axis = centroidBounds.MaximumExtent();
+      auto mid = references.begin() + references.size() / 2;
+      std::nth_element(references.begin(), mid, references.end(),
+         [axis](const Reference& lhs, const Reference& rhs)
+         {
+            return lhs.Bounds.Centroid()[axis] < rhs.Bounds.Centroid()[axis];
+         });
+
+      left.assign(references.begin(), mid);
+      right.assign(mid, references.end());
+   }
+
+   bool ClipReference(const Reference& reference, const AABB& clipBox, Reference& clipped) const
+   {
+      AABB clipRegion = AABB::Intersection(reference.Bounds, clipBox);
+      if (clipRegion.IsEmpty())
+      {
+         return false;
+      }
+
+      clipped.Index = reference.Index;
+      if (!m_objects[reference.Index]->ClippedBoundingBox(m_time0, m_time1, clipRegion, clipped.Bounds))
+      {
+         return false;
+      }
+
+      clipped.Bounds = AABB::Intersection(clipped.Bounds, clipRegion);
+      return !clipped.Bounds.IsEmpty();
+   }
+
+   SpatialSplit FindSpatialSplit(const std::vector<Reference>& references, const AABB& bounds) const
+   {
+      SpatialSplit best;
+      for (int axis = 0; axis < 3; ++axis)
+      {
+         const double axisMin = bounds.Minimum[axis];
+         const double binWidth = (bounds.Maximum[axis] - axisMin) / SBVHConstants::NumSpatialBins;
+         if (binWidth <= 0.0)
+         {
+            continue;
+         }
+
+         auto binOf = [axisMin, binWidth](double position)
+         {
+            auto bin = static_cast<int64_t>((position - axisMin) / binWidth);
+            return static_cast<size_t>(std::clamp<int64_t>(bin, 0, SBVHConstants::NumSpatialBins - 1));
+         };
+
+         size_t entries[SBVHConstants::NumSpatialBins] = {};
+         size_t exits[SBVHConstants::NumSpatialBins] = {};
+         AABB binBounds[SBVHConstants::NumSpatialBins];
+         std::fill(std::begin(binBounds), std::end(binBounds), AABB::Empty());
+         for (const auto& reference : references)
+         {
+            const size_t firstBin = binOf(reference.Bounds.Minimum[axis]);
+            const size_t lastBin = std::max(firstBin, binOf(reference.Bounds.Maximum[axis]));
+            for (size_t bin = firstBin; bin <= lastBin; ++bin)
+            {
+               AABB slab = bounds;
+               slab.Minimum[axis] = axisMin + bin * binWidth;
+               slab.Maximum[axis] = bin + 1 == SBVHConstants::NumSpatialBins ? bounds.Maximum[axis] : axisMin + (bin + 1) * binWidth;
+
+               Reference clipped;
+               if (ClipReference(reference, slab, clipped))
+               {
+                  binBounds[bin] = AABB::SurroundingBox(binBounds[bin], clipped.Bounds);
+               }
+            }
+
+            ++entries[firstBin];
+            ++exits[lastBin];
+         }
+
+         AABB rightBounds[SBVHConstants::NumSpatialBins];
+         size_t rightCounts[SBVHConstants::NumSpatialBins] = {};
+         AABB accumulated = AABB::Empty();
+         size_t count = 0;
+         for (size_t bin = SBVHConstants::NumSpatialBins - 1; bin > 0; --bin)
+         {
+            accumulated = AABB::SurroundingBox(accumulated, binBounds[bin]);
+            count += exits[bin];
+            rightBounds[bin] = accumulated;
+            rightCounts[bin] = count;
+         }
+
+         accumulated = AABB::Empty();
+         count = 0;
+         for (size_t bin = 0; bin < SBVHConstants::NumSpatialBins - 1; ++bin)
+         {
+            accumulated = AABB::SurroundingBox(accumulated, binBounds[bin]);
+            count += entries[bin];
+            const size_t rightCount = rightCounts[bin + 1];
+            if (count == 0 || rightCount == 0 || accumulated.IsEmpty() || rightBounds[bin + 1].IsEmpty())
+            {
+               continue;
+            }
+
+            double cost = count * accumulated.SurfaceArea() + rightCount * rightBounds[bin + 1].SurfaceArea();
+            if (cost < best.Cost)
+            {
+               best.Cost = cost;
+               best.Axis = axis;
+               best.Position = axisMin + (bin + 1) * binWidth;
+            }
+         }
+      }
+
+      return best;
+   }
+
+   bool PerformSpatialSplit(const std::vector<Reference>& references, const SpatialSplit& split,
+      std::vector<Reference>& left, std::vector<Reference>& right)
+   {
+      const int axis = split.Axis;
+      AABB leftBounds = AABB::Empty();
+      AABB rightBounds = AABB::Empty();
+      std::vector<const Reference*> straddling;
+      for (const auto& reference : references)
+      {
+         if (reference.Bounds.Maximum[axis] <= split.Position)
+         {
+            left.push_back(reference);
+            leftBounds = AABB::SurroundingBox(leftBounds, reference.Bounds);
+         }
+         else if (reference.Bounds.Minimum[axis] >= split.Position)
+         {
+            right.push_back(reference);
+            rightBounds = AABB::SurroundingBox(rightBounds, reference.Bounds);
+         }
+         else
+         {
+            straddling.push_back(&reference);
+         }
+      }
+
+      size_t leftCount = left.size() + straddling.size();
+      size_t rightCount = right.size() + straddling.size();
+      size_t duplicates = 0;
+      for (const Reference* reference : straddling)
+      {
+         AABB leftClip = reference->Bounds;
+         leftClip.Maximum[axis] = split.Position;
+         AABB rightClip = reference->Bounds;
+         rightClip.Minimum[axis] = split.Position;
+
+         Reference leftPart;
+         Reference rightPart;
+         const bool bHasLeft = ClipReference(*reference, leftClip, leftPart);
+         const bool bHasRight = ClipReference(*reference, rightClip, rightPart);
+         if (!bHasLeft || !bHasRight)
+         {
+            // Whole primitive lies on one side after exact clipping.
+            if (bHasLeft || !bHasRight)
+            {
+               left.push_back(bHasLeft ? leftPart : *reference);
+               leftBounds = AABB::SurroundingBox(leftBounds, left.back().Bounds);
+               --rightCount;
+            }
+            else
+            {
+               right.push_back(rightPart);
+               rightBounds = AABB::SurroundingBox(rightBounds, rightPart.Bounds);
+               --leftCount;
+            }
+
+            continue;
+         }
+
+         // Reference unsplitting: keep the whole reference on one side when that's cheaper than duplicating it.
+         const AABB splitLeft = AABB::SurroundingBox(leftBounds, leftPart.Bounds);
+         const AABB splitRight = AABB::SurroundingBox(rightBounds, rightPart.Bounds);
+         const AABB unsplitLeft = AABB::SurroundingBox(leftBounds, reference->Bounds);
+         const AABB unsplitRight = AABB::SurroundingBox(rightBounds, reference->Bounds);
+         const double duplicateCost = splitLeft.SurfaceArea() * leftCount + splitRight.SurfaceArea() * rightCount;
+         const double leftOnlyCost = unsplitLeft.SurfaceArea() * leftCount + rightBounds.SurfaceArea() * (rightCount - 1);
+         const double rightOnlyCost = leftBounds.SurfaceArea() * (leftCount - 1) + unsplitRight.SurfaceArea() * rightCount;
+         if (duplicateCost < leftOnlyCost && duplicateCost < rightOnlyCost)
+         {
+            left.push_back(leftPart);
+            right.push_back(rightPart);
+            leftBounds = splitLeft;
+            rightBounds = splitRight;
+            ++duplicates;
+         }
+         else if (leftOnlyCost < rightOnlyCost)
+         {
+            left.push_back(*reference);
+            leftBounds = unsplitLeft;
+            --rightCount;
+         }
+         else
+         {
+            right.push_back(*reference);
+            rightBounds = unsplitRight;
+            --leftCount;
+         }
+      }
+
+      const bool bProgress = left.size() < references.size() || right.size() < references.size();
+      if (left.empty() || right.empty() || !bProgress || m_referenceCount + duplicates > m_maxReferences)
+      {
+         return false;
+      }
+
+      m_referenceCount += duplicates;
+      return true;
+   }
+
+   void EmitLeaf(FlatBVHData& data, uint32_t nodeIndex, const AABB& bounds, const std::vector<Reference>& references)
+   {
+      auto& node = data.Nodes[nodeIndex];
+      node.Bounds = bounds;
+      node.Offset = static_cast<uint32_t>(data.PrimitiveIndices.size());
+      node.PrimitiveCount = static_cast<uint16_t>(references.size());
+      for (const auto& reference : references)
+      {
+         data.PrimitiveIndices.push_back(reference.Index);
+      }
+   }
+
+private:
+   std::vector<BVHPrimitiveInfo> m_primitives;
+   const std::vector<std::shared_ptr<Hittable>>& m_objects;
+   double m_time0 = 0.0;
+   double m_time1 = 0.0;
+   size_t m_maxReferences = 0;
+   size_t m_referenceCount = 0;
+   double m_rootArea = 0.0;
+
+};
@@ -0,0 +1,404 @@
+#pragma once
+#include <Core/CoreMinimal.h>
+#include <Math/Vec2.h>
+#include <array>
+
+enum class SamplerType : uint32_t
+{
+   Independent = 0,
+   Stratified,  // Kensler's correlated multi-jittered samples; needs the final number of samples per pixel
+   Sobol,       // Owen-scrambled Sobol (0,2)-sequence, progressive
+   BlueNoise,   // Same Sobol points in every pixel, rotated by a blue noise mask
+   Count
+};
+
+namespace SamplerConstants
+{
+   constexpr size_t SamplerCount = static_cast<size_t>(SamplerType::Count);
+   constexpr const char* SamplerNames[SamplerCount] = { "Independent", "Stratified", "Sobol", "BlueNoise" };
+
+   // Dimensions count draws, one per Get1D or Get2D: pixel, lens and time of the camera, then direction and one
+   // scalar (ball radius, Fresnel choice) per bounce.
+   constexpr int CameraDimensions = 3;
+   constexpr int BounceDimensions = 2;
+
+   constexpr int BlueNoiseMaskSize = 64; // Power of two
+   constexpr double BlueNoiseSigma = 1.5;
+   constexpr int BlueNoiseRadius = 6;
+   constexpr uint32_t BlueNoiseSeed = 0x5eed;
+}
+
+// XORed direction numbers of the second Sobol dimension for every byte of the index.
+constexpr std::array<std::array<uint32_t, 256>, 4> MakeSobolSecondDimensionTables()
+{
+   uint32_t directions[32] = {};
+   directions[0] = 1u << 31;
+   for (int bit = 1; bit < 32; ++bit)
+   {
+      directions[bit] = directions[bit - 1] ^ (directions[bit - 1] >> 1);
+   }
+
+   std::array<std::array<uint32_t, 256>, 4> tables = {};
+   for (int table = 0; table < 4; ++table)
+   {
+      for (uint32_t value = 0; value < 256; ++value)
+      {
+         for (int bit = 0; bit < 8; ++bit)
+         {
+            if (value & (1u << bit))
+            {
+               tables[table][value] ^= directions[table * 8 + bit];
+            }
+         }
+      }
+   }
+
+   return tables;
+}
+
+// Sample values indexed by (pixel, sample, dimension). A path always draws from the same dimensions, so camera, lens,
+// time and every bounce get their own well distributed set over the samples of a pixel, and samples don't depend on
+// which thread or pass took them. One sampler per thread.
+class Sampler
+{
+public:
+   Sampler(SamplerType type, int samplesPerPixel, uint64_t seed) :
+      m_type(type),
+      m_samplesPerPixel(static_cast<uint32_t>(std::max(1, samplesPerPixel))),
+      m_seed(MixBits(seed))
+   {
+   }
+
+   void StartPixelSample(int x, int y, uint32_t sampleIndex)
+   {
+      m_x = x;
+      m_y = y;
+      m_sampleIndex = sampleIndex;
+      m_pixelSeed = MixBits(m_seed ^ ((static_cast<uint64_t>(y) << 32) | static_cast<uint32_t>(x)));
+      m_dimension = 0;
+      m_bounce = 0;
+   }
+
+   // Skips to the dimensions of the next bounce, whatever the previous bounce drew.
+   void StartBounce()
+   {
+      m_dimension = SamplerConstants::CameraDimensions + m_bounce * SamplerConstants::BounceDimensions;
+      ++m_bounce;
+   }
+
+   // Picks up a path of a pixel sample at the given bounce, for integrators that advance many paths a bounce at a
+   // time. Draws the same values as StartPixelSample followed by bounce + 1 calls of StartBounce.
+   void ResumeBounce(int x, int y, uint32_t sampleIndex, int bounce)
+   {
+      StartPixelSample(x, y, sampleIndex);
+      m_bounce = bounce;
+      StartBounce();
+   }
+
+   // Leaves the next dimension undrawn, for code which doesn't need a value where the general case draws one.
+   void Skip()
+   {
+      ++m_dimension;
+   }
+
+   double Get1D()
+   {
+      const int dimension = m_dimension++;
+      switch (m_type)
+      {
+      case SamplerType::Stratified:
+      {
+         uint32_t seed = DimensionSeed(m_pixelSeed, dimension);
+         const uint32_t stratum = StratumSample(seed);
+         return (stratum + HashToUnit(stratum, seed * 0x02e5be93u)) / m_samplesPerPixel;
+      }
+      case SamplerType::Sobol:
+         return SobolSample(DimensionSeed(m_pixelSeed, dimension)).x;
+      case SamplerType::BlueNoise:
+         return Rotate(SobolSample(DimensionSeed(m_seed, dimension)).x, BlueNoise(dimension, 0));
+      case SamplerType::Independent:
+      default:
+         return ToUnit(static_cast<uint32_t>(IndependentBits(dimension)));
+      }
+   }
+
+   Point2 Get2D()
+   {
+      const int dimension = m_dimension++;
+      switch (m_type)
+      {
+      case SamplerType::Stratified:
+      {
+         // m x n grid of strata, each row and column also stratified (Kensler 2013).
+         uint32_t seed = DimensionSeed(m_pixelSeed, dimension);
+         const uint32_t sample = StratumSample(seed);
+         const uint32_t m = std::max(1u, static_cast<uint32_t>(std::sqrt(static_cast<double>(m_samplesPerPixel))));
+         const uint32_t n = (m_samplesPerPixel + m - 1) / m;
+         const uint32_t sx = Permute(sample % m, m, seed * 0xa511e9b3u);
+         const uint32_t sy = Permute(sample / m, n, seed * 0x63d83595u);
+         const double jx = HashToUnit(sample, seed * 0xa399d265u);
+         const double jy = HashToUnit(sample, seed * 0x711ad6a5u);
+         return Point2((sample % m + (sy + jx) / n) / m, (sample / m + (sx + jy) / m) / n);
+      }
+      case SamplerType::Sobol:
+         return SobolSample(DimensionSeed(m_pixelSeed, dimension));
+      case SamplerType::BlueNoise:
+      {
+         const Point2 sample = SobolSample(DimensionSeed(m_seed, dimension));
+         return Point2(Rotate(sample.x, BlueNoise(dimension, 0)), Rotate(sample.y, BlueNoise(dimension, 1)));
+      }
+      case SamplerType::Independent:
+      default:
+      {
+         const uint64_t bits = IndependentBits(dimension);
+         return Point2(ToUnit(static_cast<uint32_t>(bits)), ToUnit(static_cast<uint32_t>(bits >> 32)));
+      }
+      }
+   }
+
+   SamplerType GetType() const { return m_type; }
+
+private:
+   static double ToUnit(uint32_t bits)
+   {
+      return bits * 0x1p-32;
+   }
+
+   static uint32_t DimensionSeed(uint64_t seed, int dimension)
+   {
+      return static_cast<uint32_t>(MixBits(seed ^ (static_cast<uint64_t>(dimension) * 0x9e3779b97f4a7c15ull)));
+   }
+
+   uint64_t IndependentBits(int dimension) const
+   {
+      return MixBits(m_pixelSeed ^ MixBits((static_cast<uint64_t>(m_sampleIndex) << 32) | static_cast<uint32_t>(dimension)));
+   }
+
+   // Samples past the planned count start another round of strata with different permutations.
+   uint32_t StratumSample(uint32_t& seed) const
+   {
+      const uint32_t round = m_sampleIndex / m_samplesPerPixel;
+      seed ^= round * 0x9e3779b9u;
+      return Permute(m_sampleIndex % m_samplesPerPixel, m_samplesPerPixel, seed * 0x51633e2du);
+   }
+
+   // Kensler's hashed permutation of [0, length).
+   static uint32_t Permute(uint32_t idx, uint32_t length, uint32_t seed)
+   {
+      uint32_t mask = length - 1;
+      mask |= mask >> 1;
+      mask |= mask >> 2;
+      mask |= mask >> 4;
+      mask |= mask >> 8;
+      mask |= mask >> 16;
+      do
+      {
+         idx ^= seed;
+         idx *= 0xe170893du;
+         idx ^= seed >> 16;
+         idx ^= (idx & mask) >> 4;
+         idx ^= seed >> 8;
+         idx *= 0x0929eb3fu;
+         idx ^= seed >> 23;
+         idx ^= (idx & mask) >> 1;
+         idx *= 1 | seed >> 27;
+         idx *= 0x6935fa69u;
+         idx ^= (idx & mask) >> 11;
+         idx *= 0x74dcb303u;
+         idx ^= (idx & mask) >> 2;
+         idx *= 0x9e501cc3u;
+         idx ^= (idx & mask) >> 2;
+         idx *= 0xc860a3dfu;
+         idx &= mask;
+         idx ^= idx >> 5;
+      } while (idx >= length);
+
+      return (idx + seed) % length;
+   }
+
+   static double HashToUnit(uint32_t value, uint32_t seed)
+   {
+      return ToUnit(static_cast<uint32_t>(MixBits((static_cast<uint64_t>(seed) << 32) | value)));
+   }
+
+   static uint32_t ReverseBits(uint32_t value)
+   {
+      value = ((value >> 1) & 0x55555555u) | ((value & 0x55555555u) << 1);
+      value = ((value >> 2) & 0x33333333u) | ((value & 0x33333333u) << 2);
+      value = ((value >> 4) & 0x0f0f0f0fu) | ((value & 0x0f0f0f0fu) << 4);
+      value = ((value >> 8) & 0x00ff00ffu) | ((value & 0x00ff00ffu) << 8);
+      return (value >> 16) | (value << 16);
+   }
+
+   // Owen scrambling of the bits from the top, by Vegdahl's variant of the Laine-Karras hash on reversed bits.
+   static uint32_t NestedUniformScramble(uint32_t value, uint32_t seed)
+   {
+      value = ReverseBits(value);
+      value ^= value * 0x3d20adeau;
+      value += seed;
+      value *= (seed >> 16) | 1;
+      value ^= value * 0x05526c56u;
+      value ^= value * 0x53a22864u;
+      return ReverseBits(value);
+   }
+
+   // First two dimensions of Sobol; the first is the van der Corput sequence, the second comes from polynomial x + 1.
+   // Its generator matrix is applied a byte at a time.
+   static uint32_t SobolSecondDimension(uint32_t idx)
+   {
+      static constexpr auto tables = MakeSobolSecondDimensionTables();
+      return tables[0][idx & 0xff] ^ tables[1][(idx >> 8) & 0xff] ^ tables[2][(idx >> 16) & 0xff] ^ tables[3][idx >> 24];
+   }
+
+   // Every dimension shuffles the order of points by its own scramble of the sample index (Burley 2020), so that
+   // 2D sets of different dimensions are decorrelated while each stays a scrambled (0,2)-sequence.
+   Point2 SobolSample(uint32_t seed) const
+   {
+      const uint32_t idx = NestedUniformScramble(m_sampleIndex, seed);
+      const uint32_t x = NestedUniformScramble(ReverseBits(idx), static_cast<uint32_t>(MixBits(seed ^ 0x1ull)));
+      const uint32_t y = NestedUniformScramble(SobolSecondDimension(idx), static_cast<uint32_t>(MixBits(seed ^ 0x2ull)));
+      return Point2(ToUnit(x), ToUnit(y));
+   }
+
+   static double Rotate(double value, double offset)
+   {
+      value += offset;
+      return value >= 1.0 ? value - 1.0 : value;
+   }
+
+   // Mask value of the pixel, looked up at an offset picked by dimension and component so that dimensions
+   // don't share their rotations.
+   double BlueNoise(int dimension, int component) const
+   {
+      constexpr int size = SamplerConstants::BlueNoiseMaskSize;
+      const uint32_t offset = DimensionSeed(m_seed, dimension * 2 + component);
+      const int x = (m_x + static_cast<int>(offset)) & (size - 1);
+      const int y = (m_y + static_cast<int>(offset >> 16)) & (size - 1);
+      return BlueNoiseMask()[y * size + x];
+   }
+
+   // Tileable blue noise ranks in [0, 1) by Ulichney's void-and-cluster method, built once on first use.
+   static const std::vector<double>& BlueNoiseMask()
+   {
+      static const std::vector<double> mask = BuildBlueNoiseMask();
+      return mask;
+   }
+
+   static std::vector<double> BuildBlueNoiseMask()
+   {
+      constexpr int size = SamplerConstants::BlueNoiseMaskSize;
+      constexpr int radius = SamplerConstants::BlueNoiseRadius;
+      constexpr int pixelCount = size * size;
+      constexpr int kernelSize = 2 * radius + 1;
+      double kernel[kernelSize * kernelSize];
+      for (int dy = -radius; dy <= radius; ++dy)
+      {
+         for (int dx = -radius; dx <= radius; ++dx)
+         {
+            const double sigma = SamplerConstants::BlueNoiseSigma;
+            kernel[(dy + radius) * kernelSize + dx + radius] = std::exp(-(dx * dx + dy * dy) / (2.0 * sigma * sigma));
+         }
+      }
+
+      std::vector<uint8_t> pattern(pixelCount, 0);
+      std::vector<double> energy(pixelCount, 0.0);
+      auto splat = [&](std::vector<double>& target, int idx, double sign)
+      {
+         const int x = idx % size;
+         const int y = idx / size;
+         for (int dy = -radius; dy <= radius; ++dy)
+         {
+            for (int dx = -radius; dx <= radius; ++dx)
+            {
+               const int wrapped = ((y + dy) & (size - 1)) * size + ((x + dx) & (size - 1));
+               target[wrapped] += sign * kernel[(dy + radius) * kernelSize + dx + radius];
+            }
+         }
+      };
+
+      // Tightest cluster is the set pixel of highest energy, largest void the unset pixel of lowest.
+      auto findExtreme = [&](const std::vector<uint8_t>& bits, const std::vector<double>& values, uint8_t bit, bool bHighest)
+      {
+         int found = -1;
+         for (int idx = 0; idx < pixelCount; ++idx)
+         {
+            if (bits[idx] == bit && (found < 0 || (bHighest ? values[idx] > values[found] : values[idx] < values[found])))
+            {
+               found = idx;
+            }
+         }
+
+         return found;
+      };
+
+      // Own generator, so the mask is the same whatever the render seeds.
+      std::mt19937 generator(SamplerConstants::BlueNoiseSeed);
+      const int initialCount = pixelCount / 10;
+      for (int count = 0; count < initialCount; )
+      {
+         const int idx = static_cast<int>(generator() % pixelCount);
+         if (pattern[idx] == 0)
+         {
+            pattern[idx] = 1;
+            splat(energy, idx, 1.0);
+            ++count;
+         }
+      }
+
+      // Move points from clusters into voids until the pattern is evenly spread.
+      for (int iteration = 0; iteration < pixelCount; ++iteration)
+      {
+         const int cluster = findExtreme(pattern, energy, 1, true);
+         pattern[cluster] = 0;
+         splat(energy, cluster, -1.0);
+         const int largestVoid = findExtreme(pattern, energy, 0, false);
+         pattern[largestVoid] = 1;
+         splat(energy, largestVoid, 1.0);
+         if (largestVoid == cluster)
+         {
+            break;
+         }
+      }
+
+      std::vector<int> ranks(pixelCount, 0);
+      {
+         auto bits = pattern;
+         auto values = energy;
+         for (int rank = initialCount - 1; rank >= 0; --rank)
+         {
+            const int cluster = findExtreme(bits, values, 1, true);
+            bits[cluster] = 0;
+            splat(values, cluster, -1.0);
+            ranks[cluster] = rank;
+         }
+      }
+
+      for (int rank = initialCount; rank < pixelCount; ++rank)
+      {
+         const int largestVoid = findExtreme(pattern, energy, 0, false);
+         pattern[largestVoid] = 1;
+         splat(energy, largestVoid, 1.0);
+         ranks[largestVoid] = rank;
+      }
+
+      std::vector<double> mask(pixelCount);
+      for (int idx = 0; idx < pixelCount; ++idx)
+      {
+         mask[idx] = (ranks[idx] + 0.5) / pixelCount;
+      }
+
+      return mask;
+   }
+
+private:
+   SamplerType m_type;
+   uint32_t m_samplesPerPixel;
+   uint64_t m_seed;
+   uint64_t m_pixelSeed = 0;
+   int m_x = 0;
+   int m_y = 0;
+   uint32_t m_sampleIndex = 0;
+   int m_dimension = 0;
+   int m_bounce = 0;
+
+};
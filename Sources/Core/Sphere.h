@@ -4,19 +4,26 @@
 class Sphere : public Hittable
 {
 public:
-   Sphere(Point3 center, double radius, std::shared_ptr<Material> materialPtr) :
+   Sphere(Point3 center, double radius, uint32_t material) :
       Center(center),
       Radius(radius),
-      MaterialPtr(materialPtr)
+      Material(material)
    {
    }
 
    bool Hit(const Ray& r, double tMin, double tMax, HitRecord& rec) const override 
    {
-      Vec3 centerToOrigin = r.Origin - Center;
+      RT_STAT_INCREMENT(StatCounter::SphereTests);
+      return Intersect(Center, Radius, Material, r, tMin, tMax, rec);
+   }
+
+   static bool Intersect(const Point3& center, double radius, uint32_t material,
+      const Ray& r, double tMin, double tMax, HitRecord& rec)
+   {
+      Vec3 centerToOrigin = r.Origin - center;
       auto a = r.Direction.SquaredLength();
       auto halfB = Dot(centerToOrigin, r.Direction);
-      auto c = centerToOrigin.SquaredLength() - Radius * Radius;
+      auto c = centerToOrigin.SquaredLength() - radius * radius;
 
       auto discriminant = halfB * halfB - a * c;
       if (discriminant < 0.0)
@@ -37,14 +44,46 @@ public:
 
       rec.t = root;
       rec.p = r.At(rec.t);
-      Vec3 outwardNormal = (rec.p - Center) / Radius;
+      Vec3 outwardNormal = (rec.p - center) / radius;
       rec.SetFaceNormal(r, outwardNormal);
       Sphere::GetSphereUV(outwardNormal, rec.u, rec.v);
-      rec.MatPtr = MaterialPtr;
+      rec.Material = material;
 
       return true;
    }
 
+   void BoundaryCrossings(const Ray& r, double tMin, double tMax, std::vector<BoundaryCrossing>& crossings) const override
+   {
+      RT_STAT_INCREMENT(StatCounter::SphereTests);
+      Crossings(Center, Radius, r, tMin, tMax, crossings);
+   }
+
+   // Both roots of Intersect that lie between tMin and tMax, entering at the first. A ray which only touches the sphere
+   // doesn't cross it.
+   static void Crossings(const Point3& center, double radius, const Ray& r, double tMin, double tMax, std::vector<BoundaryCrossing>& crossings)
+   {
+      Vec3 centerToOrigin = r.Origin - center;
+      auto a = r.Direction.SquaredLength();
+      auto halfB = Dot(centerToOrigin, r.Direction);
+      auto c = centerToOrigin.SquaredLength() - radius * radius;
+
+      auto discriminant = halfB * halfB - a * c;
+      if (discriminant <= 0.0)
+      {
+         return;
+      }
+      auto sqrtDiscriminant = sqrt(discriminant);
+
+      const BoundaryCrossing roots[2] = { { (-halfB - sqrtDiscriminant) / a, true }, { (-halfB + sqrtDiscriminant) / a, false } };
+      for (const BoundaryCrossing& root : roots)
+      {
+         if (root.t >= tMin && root.t <= tMax)
+         {
+            crossings.push_back(root);
+         }
+      }
+   }
+
    bool BoundingBox(double time0, double time1, AABB& outputBox) const override
    {
       outputBox = AABB(
@@ -53,6 +92,36 @@ public:
       return true;
    }
 
+   bool ClippedBoundingBox(double time0, double time1, const AABB& clipBox, AABB& outputBox) const override
+   {
+      // Along every axis the sphere can't reach further than the circle left after removing
+      // the closest distance to the clip box in other two axes.
+      outputBox = clipBox;
+      for (int axis = 0; axis < 3; ++axis)
+      {
+         double squaredDistance = 0.0;
+         for (int other = 0; other < 3; ++other)
+         {
+            if (other != axis)
+            {
+               double closest = std::clamp(Center[other], clipBox.Minimum[other], clipBox.Maximum[other]);
+               squaredDistance += (closest - Center[other]) * (closest - Center[other]);
+            }
+         }
+
+         if (squaredDistance > Radius * Radius)
+         {
+            return false;
+         }
+
+         double halfExtent = std::sqrt(Radius * Radius - squaredDistance);
+         outputBox.Minimum[axis] = std::fmax(clipBox.Minimum[axis], Center[axis] - halfExtent);
+         outputBox.Maximum[axis] = std::fmin(clipBox.Maximum[axis], Center[axis] + halfExtent);
+      }
+
+      return !outputBox.IsEmpty();
+   }
+
    static void GetSphereUV(const Point3& p, double& u, double& v)
    {
       auto theta = std::acos(-p.y);
@@ -65,6 +134,6 @@ public:
 public:
    Point3 Center = Point3();
    double Radius = 1.0;
-   std::shared_ptr<class Material> MaterialPtr;
+   uint32_t Material = 0;
 
 };
\ No newline at end of file
@@ -0,0 +1,228 @@
+#pragma once
+#include <Core/CoreMinimal.h>
+#include <algorithm>
+#include <cstdint>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+#include <string>
+
+// Define RT_ENABLE_STATS=1 to count traversal work per pixel. When disabled every counter compiles to nothing.
+#ifndef RT_ENABLE_STATS
+#define RT_ENABLE_STATS 0
+#endif
+
+#if RT_ENABLE_STATS
+#define RT_STAT_INCREMENT(counter) Statistics::Increment(counter)
+#else
+#define RT_STAT_INCREMENT(counter) ((void)0)
+#endif
+
+enum class StatCounter : uint32_t
+{
+   Samples = 0,
+   Rays,
+   AABBTests,
+   SphereTests,
+   MovingSphereTests,
+   XYRectTests,
+   XZRectTests,
+   YZRectTests,
+   BoxTests,
+   InstanceTests,
+   ConstantMediumTests,
+   GridMediumTests,
+   ScatterCalls,
+   Count
+};
+
+namespace StatisticsConstants
+{
+   constexpr size_t CounterCount = static_cast<size_t>(StatCounter::Count);
+   constexpr const char* CounterNames[CounterCount] =
+   {
+      "Samples",
+      "Rays",
+      "AABBTests",
+      "SphereTests",
+      "MovingSphereTests",
+      "XYRectTests",
+      "XZRectTests",
+      "YZRectTests",
+      "BoxTests",
+      "InstanceTests",
+      "ConstantMediumTests",
+      "GridMediumTests",
+      "ScatterCalls"
+   };
+
+   // Heatmaps are normalized to this percentile, so a few outliers don't wash out the rest of the image.
+   constexpr double HeatmapPercentile = 0.99;
+}
+
+struct PixelStatistics
+{
+public:
+   uint64_t Counters[StatisticsConstants::CounterCount] = {};
+
+};
+
+// Per-pixel traversal counters. Each render thread counts into a thread local record which is moved into the
+// per-pixel buffer once the pixel is done, so counting never touches shared memory.
+class Statistics
+{
+public:
+   static void Increment(StatCounter counter)
+   {
+      ++Current().Counters[static_cast<size_t>(counter)];
+   }
+
+   static void Initialize(int width, int height)
+   {
+      auto& instance = Instance();
+      instance.m_width = width;
+      instance.m_height = height;
+      instance.m_pixels.assign(static_cast<size_t>(width) * height, PixelStatistics());
+   }
+
+   static void BeginPixel()
+   {
+      Current() = PixelStatistics();
+   }
+
+   static void EndPixel(size_t pixelIndex)
+   {
+      auto& instance = Instance();
+      if (pixelIndex < instance.m_pixels.size())
+      {
+         // Pixels rendered in several passes add up their counters.
+         auto& pixel = instance.m_pixels[pixelIndex];
+         for (size_t idx = 0; idx < StatisticsConstants::CounterCount; ++idx)
+         {
+            pixel.Counters[idx] += Current().Counters[idx];
+         }
+      }
+   }
+
+   // Writes one heatmap per non-zero counter as '<prefix><CounterName>.png' and a summary table to '<prefix>Summary.txt'.
+   static void Report(const std::string& prefix)
+   {
+      auto& instance = Instance();
+      if (instance.m_pixels.empty())
+      {
+         return;
+      }
+
+      uint64_t totals[StatisticsConstants::CounterCount] = {};
+      uint64_t maximums[StatisticsConstants::CounterCount] = {};
+      for (const auto& pixel : instance.m_pixels)
+      {
+         for (size_t counter = 0; counter < StatisticsConstants::CounterCount; ++counter)
+         {
+            totals[counter] += pixel.Counters[counter];
+            maximums[counter] = std::max(maximums[counter], pixel.Counters[counter]);
+         }
+      }
+
+      const double samples = static_cast<double>(std::max<uint64_t>(totals[static_cast<size_t>(StatCounter::Samples)], 1));
+      const double rays = static_cast<double>(std::max<uint64_t>(totals[static_cast<size_t>(StatCounter::Rays)], 1));
+      const double pixelCount = static_cast<double>(instance.m_pixels.size());
+
+      std::ostringstream table;
+      table << std::left << std::setw(22) << "Counter"
+         << std::right << std::setw(18) << "Total"
+         << std::setw(14) << "Per Sample"
+         << std::setw(14) << "Per Ray"
+         << std::setw(16) << "Pixel Mean"
+         << std::setw(16) << "Pixel Max" << '\n';
+      table << std::fixed << std::setprecision(3);
+      for (size_t counter = 0; counter < StatisticsConstants::CounterCount; ++counter)
+      {
+         table << std::left << std::setw(22) << StatisticsConstants::CounterNames[counter]
+            << std::right << std::setw(18) << totals[counter]
+            << std::setw(14) << totals[counter] / samples
+            << std::setw(14) << totals[counter] / rays
+            << std::setw(16) << totals[counter] / pixelCount
+            << std::setw(16) << maximums[counter] << '\n';
+      }
+      table << "Average path length : " << rays / samples << " rays per sample\n";
+
+      std::cout << table.str();
+      std::ofstream summary(prefix + "Summary.txt");
+      summary << table.str();
+
+      for (size_t counter = 0; counter < StatisticsConstants::CounterCount; ++counter)
+      {
+         if (totals[counter] > 0)
+         {
+            WriteHeatmap(prefix + StatisticsConstants::CounterNames[counter] + ".png", counter);
+         }
+      }
+   }
+
+private:
+   static Statistics& Instance()
+   {
+      static Statistics instance;
+      return instance;
+   }
+
+   static PixelStatistics& Current()
+   {
+      thread_local PixelStatistics current;
+      return current;
+   }
+
+   static void WriteHeatmap(const std::string& fileName, size_t counter)
+   {
+      const auto& instance = Instance();
+      std::vector<uint64_t> values;
+      values.reserve(instance.m_pixels.size());
+      for (const auto& pixel : instance.m_pixels)
+      {
+         values.push_back(pixel.Counters[counter]);
+      }
+
+      auto percentile = values.begin() + static_cast<size_t>(StatisticsConstants::HeatmapPercentile * (values.size() - 1));
+      std::nth_element(values.begin(), percentile, values.end());
+      const double normalization = static_cast<double>(std::max<uint64_t>(*percentile, 1));
+
+      constexpr int Channels = 3;
+      auto buffer = std::make_unique<unsigned char[]>(instance.m_pixels.size() * Channels);
+      for (size_t idx = 0; idx < instance.m_pixels.size(); ++idx)
+      {
+         double value = std::min(instance.m_pixels[idx].Counters[counter] / normalization, 1.0);
+         HeatColor(value, &buffer[idx * Channels]);
+      }
+
+      stbi_write_png(fileName.c_str(), instance.m_width, instance.m_height, Channels, buffer.get(), instance.m_width * Channels);
+   }
+
+   // Black -> purple -> red -> orange -> white ramp.
+   static void HeatColor(double value, unsigned char* output)
+   {
+      constexpr double Stops[5][3] =
+      {
+         { 0.0, 0.0, 0.0 },
+         { 0.3, 0.0, 0.5 },
+         { 0.8, 0.1, 0.3 },
+         { 1.0, 0.6, 0.0 },
+         { 1.0, 1.0, 1.0 }
+      };
+
+      double scaled = value * 4.0;
+      auto stop = std::min(static_cast<size_t>(scaled), size_t(3));
+      double fraction = scaled - stop;
+      for (size_t channel = 0; channel < 3; ++channel)
+      {
+         double color = Stops[stop][channel] + (Stops[stop + 1][channel] - Stops[stop][channel]) * fraction;
+         output[channel] = static_cast<unsigned char>(255.999 * std::clamp(color, 0.0, 1.0));
+      }
+   }
+
+private:
+   int m_width = 0;
+   int m_height = 0;
+   std::vector<PixelStatistics> m_pixels;
+
+};
@@ -2,63 +2,34 @@
 #include <Math/Vec3.h>
 #include <Core/Color.h>
 
-class Texture
+enum class TextureType : uint32_t
 {
-public:
-   virtual Color Value(double u, double v, const Point3& p) const = 0;
+   Solid = 0,
+   Checker,
+   Image
 };
 
-class SolidColorTexture : public Texture
+// Tagged record of a texture in a MaterialTable. Checkers refer to the textures of their squares by index in the same
+// table, image textures to their pixels by index in the images of the table.
+struct Texture
 {
 public:
-   SolidColorTexture() = default;
-   SolidColorTexture(const Color& color) :
-      ColorValue(color)
-   {
-   }
-
-   SolidColorTexture(double r, double g, double b) :
-      ColorValue(Color(r, g, b))
-   {
-   }
-
-   Color Value(double u, double v, const Point3& p) const override
-   {
-      return ColorValue;
-   }
-
-public:
-   Color ColorValue;
+   TextureType Type = TextureType::Solid;
+   uint32_t Even = 0; // Checker
+   uint32_t Odd = 0;
+   uint32_t Image = 0; // Image
+   Color Albedo; // Solid
 
 };
 
-class CheckerTexture : public Texture
+class CheckerTexture
 {
 public:
-   CheckerTexture(std::shared_ptr<Texture> even, std::shared_ptr<Texture> odd) :
-      EvenAlbedo(even), OddAlbedo(odd)
-   {
-   }
-
-   CheckerTexture(const Color& even, const Color& odd) :
-      EvenAlbedo(std::make_shared<SolidColorTexture>(even)),
-      OddAlbedo(std::make_shared<SolidColorTexture>(odd))
-   {
-   }
-
-   Color Value(double u, double v, const Point3& p) const override
+   // Whether p lies in an odd square of the pattern.
+   static bool IsOdd(const Point3& p)
    {
       auto sines = std::sin(10.0 * p.x) * std::sin(10.0 * p.y) * std::sin(10.0 * p.z);
-      if (sines < 0.0)
-      {
-         return OddAlbedo->Value(u, v, p);
-      }
-
-      return EvenAlbedo->Value(u, v, p);
+      return sines < 0.0;
    }
 
-public:
-   std::shared_ptr<Texture> EvenAlbedo;
-   std::shared_ptr<Texture> OddAlbedo;
-
-};
\ No newline at end of file
+};
@@ -0,0 +1,55 @@
+#pragma once
+#include <Core/CoreMinimal.h>
+#include <Core/HDRImage.h>
+
+enum class TonemapOperator : uint32_t
+{
+   Clamp = 0, // Clips at 1, as images were written before HDR output
+   Reinhard,
+   ACES,      // Narkowicz's fit of the ACES filmic curve
+   Count
+};
+
+namespace TonemapConstants
+{
+   constexpr size_t OperatorCount = static_cast<size_t>(TonemapOperator::Count);
+   constexpr const char* OperatorNames[OperatorCount] = { "Clamp", "Reinhard", "ACES" };
+   constexpr int Channels = 3;
+}
+
+struct TonemapSettings
+{
+public:
+   TonemapOperator Operator = TonemapOperator::Clamp;
+   double Exposure = 0.0; // In stops
+
+};
+
+// Maps linear radiance to gamma 2 corrected 8-bit RGB. Cheap compared to rendering, so it runs as a post pass over
+// the resolved framebuffer or over an HDR image written earlier.
+inline std::unique_ptr<unsigned char[]> Tonemap(const HDRImage& image, const TonemapSettings& settings)
+{
+   const double scale = std::exp2(settings.Exposure);
+   auto buffer = std::make_unique<unsigned char[]>(image.Pixels.size());
+   for (size_t idx = 0; idx < image.Pixels.size(); ++idx)
+   {
+      double value = std::max(0.0, scale * image.Pixels[idx]);
+      switch (settings.Operator)
+      {
+      case TonemapOperator::Reinhard:
+         value = value / (1.0 + value);
+         break;
+      case TonemapOperator::ACES:
+         value = (value * (2.51 * value + 0.03)) / (value * (2.43 * value + 0.59) + 0.14);
+         break;
+      case TonemapOperator::Clamp:
+      default:
+         break;
+      }
+
+      buffer[idx] = static_cast<unsigned char>(256.0 * std::clamp(std::sqrt(value), 0.0, 0.999));
+   }
+
+   return buffer;
+}
+
@@ -0,0 +1,393 @@
+#pragma once
+#include <Core/CoreMinimal.h>
+#include <Core/Framebuffer.h>
+#include <Core/Integrator.h>
+#include <Core/RayReordering.h>
+
+namespace WavefrontConstants
+{
+   // Paths in flight per thread, long enough for runs of the same material after sorting. Path and hit buffers take
+   // about 200 bytes a path, 3.2 MB in all, which spills out of a 2 MiB L2 into L3; on such a core CornellBox at
+   // 512x512 and 32 spp still renders in 18-19 s against 21-23 s with batches of 4096 paths that fit in L2.
+   constexpr size_t BatchSize = 16384;
+}
+
+// Components of Vec3 values in separate arrays.
+struct Vec3Array
+{
+public:
+   void Resize(size_t count)
+   {
+      X.resize(count);
+      Y.resize(count);
+      Z.resize(count);
+   }
+
+   Vec3 Get(size_t idx) const
+   {
+      return Vec3(X[idx], Y[idx], Z[idx]);
+   }
+
+   void Set(size_t idx, const Vec3& value)
+   {
+      X[idx] = value.x;
+      Y[idx] = value.y;
+      Z[idx] = value.z;
+   }
+
+public:
+   std::vector<double> X;
+   std::vector<double> Y;
+   std::vector<double> Z;
+
+};
+
+// Paths of a batch, a field per array.
+struct PathBuffer
+{
+public:
+   void Resize(size_t count)
+   {
+      Origins.Resize(count);
+      Directions.Resize(count);
+      Times.resize(count);
+      Throughputs.Resize(count);
+      Radiances.Resize(count);
+      Pixels.resize(count);
+      Samples.resize(count);
+      bAlive.resize(count);
+   }
+
+   Ray GetRay(size_t idx) const
+   {
+      return Ray(Origins.Get(idx), Directions.Get(idx), Times[idx]);
+   }
+
+   void SetRay(size_t idx, const Ray& ray)
+   {
+      Origins.Set(idx, ray.Origin);
+      Directions.Set(idx, ray.Direction);
+      Times[idx] = ray.Time;
+   }
+
+public:
+   Vec3Array Origins;
+   Vec3Array Directions;
+   std::vector<double> Times;
+   Vec3Array Throughputs;
+   Vec3Array Radiances;
+   std::vector<uint32_t> Pixels; // Column in the scanline
+   std::vector<uint32_t> Samples; // Sample index of the pixel
+   std::vector<uint8_t> bAlive;
+
+};
+
+// Closest hits of the paths of a batch, a field per array.
+struct HitBuffer
+{
+public:
+   void Resize(size_t count)
+   {
+      Points.Resize(count);
+      Normals.Resize(count);
+      Ts.resize(count);
+      Us.resize(count);
+      Vs.resize(count);
+      bFrontFaces.resize(count);
+      Materials.resize(count);
+   }
+
+   void Set(size_t idx, const HitRecord& rec)
+   {
+      Points.Set(idx, rec.p);
+      Normals.Set(idx, rec.n);
+      Ts[idx] = rec.t;
+      Us[idx] = rec.u;
+      Vs[idx] = rec.v;
+      bFrontFaces[idx] = rec.bFrontFace ? 1 : 0;
+      Materials[idx] = rec.Material;
+   }
+
+   // Without the material, which materials don't look at.
+   HitRecord Get(size_t idx) const
+   {
+      HitRecord rec;
+      rec.p = Points.Get(idx);
+      rec.n = Normals.Get(idx);
+      rec.t = Ts[idx];
+      rec.u = Us[idx];
+      rec.v = Vs[idx];
+      rec.bFrontFace = bFrontFaces[idx] != 0;
+      return rec;
+   }
+
+public:
+   Vec3Array Points;
+   Vec3Array Normals;
+   std::vector<double> Ts;
+   std::vector<double> Us;
+   std::vector<double> Vs;
+   std::vector<uint8_t> bFrontFaces;
+   std::vector<uint32_t> Materials; // Index in the MaterialTable of the scene
+
+};
+
+// Renders a scanline breadth first. Its paths are split into batches, and every bounce of a batch runs through
+// stages which each do one kind of work for all of its paths: Generate makes camera rays, Intersect finds closest hits
+// and retires paths that escaped, SortByMaterial groups hits so that Shade calls the code of one material back to
+// back, and Compact keeps the paths that scattered. Secondary rays may be sorted by RayReorderer before Intersect, which
+// changes the order they are traced in and nothing else. Paths draw the same sample dimensions and do the same
+// arithmetic as RayColor, so the image is identical to the one of the megakernel integrator. One instance per thread.
+class WavefrontIntegrator
+{
+public:
+   // Camera rays are traced in packets of packetSize rays, or one by one when it is below two. bReorderRays sorts
+   // secondary rays by origin and direction before they are traced.
+   WavefrontIntegrator(int imageWidth, int imageHeight, int maximumDepth, int packetSize, bool bReorderRays) :
+      m_imageWidth(imageWidth),
+      m_imageHeight(imageHeight),
+      m_maximumDepth(maximumDepth),
+      m_packetSize(std::clamp<size_t>(static_cast<size_t>(std::max(packetSize, 1)), 1, RayPacketConstants::MaximumSize)),
+      m_bReorderRays(bReorderRays)
+   {
+   }
+
+   // Scanline dy counts from the bottom, as in Renderer. Features are those of the kernels in Integrator.h.
+   template<uint32_t Features>
+   void RenderScanline(const CameraRayGenerator& cameraRays, const Hittable& world, const MaterialTable& materials, const Color& background,
+      Framebuffer& framebuffer, int dy, int samplesPerPixel, Sampler& sampler, RayCounters& counters)
+   {
+      if (m_paths.Times.empty())
+      {
+         m_paths.Resize(WavefrontConstants::BatchSize);
+         m_hits.Resize(WavefrontConstants::BatchSize);
+         m_active.reserve(WavefrontConstants::BatchSize);
+         m_shading.reserve(WavefrontConstants::BatchSize);
+      }
+
+      const int row = m_imageHeight - dy - 1;
+      const size_t rowBegin = static_cast<size_t>(row) * m_imageWidth;
+      const size_t pathCount = static_cast<size_t>(m_imageWidth) * samplesPerPixel;
+      m_pixelSamples.assign(m_imageWidth, PixelSamples());
+      counters.Samples += pathCount;
+      for (size_t batchBegin = 0; batchBegin < pathCount; batchBegin += WavefrontConstants::BatchSize)
+      {
+         const size_t batchSize = std::min(WavefrontConstants::BatchSize, pathCount - batchBegin);
+         Generate<Features>(cameraRays, framebuffer, dy, rowBegin, batchBegin, batchSize, samplesPerPixel, sampler);
+         for (int bounce = 0; bounce < m_maximumDepth && !m_active.empty(); ++bounce)
+         {
+            if (bounce == 0 && m_packetSize > 1)
+            {
+               IntersectPackets(world, background, rowBegin, counters);
+            }
+            else
+            {
+               if (bounce > 0 && m_bReorderRays)
+               {
+                  m_reorderer.Sort(m_active, [this](uint32_t path) { return m_paths.GetRay(path); });
+               }
+
+               Intersect(world, background, rowBegin, counters);
+            }
+
+            SortByMaterial(materials);
+            Shade<Features>(materials, row, rowBegin, bounce, sampler);
+            Compact();
+         }
+
+         // Paths are ordered by pixel, then sample, like the samples of a pixel in RenderPass.
+         for (size_t path = 0; path < batchSize; ++path)
+         {
+            m_pixelSamples[m_paths.Pixels[path]].Add(m_paths.Radiances.Get(path));
+         }
+      }
+
+      for (int dx = 0; dx < m_imageWidth; ++dx)
+      {
+         framebuffer.AddSamples(rowBegin + dx, m_pixelSamples[dx]);
+      }
+   }
+
+private:
+   template<uint32_t Features>
+   void Generate(const CameraRayGenerator& cameraRays, const Framebuffer& framebuffer, int dy, size_t rowBegin, size_t batchBegin,
+      size_t batchSize, int samplesPerPixel, Sampler& sampler)
+   {
+      const int row = m_imageHeight - dy - 1;
+      m_active.clear();
+      for (size_t path = 0; path < batchSize; ++path)
+      {
+         const int dx = static_cast<int>((batchBegin + path) / samplesPerPixel);
+         const uint32_t sampleIndex = framebuffer.SampleCount(rowBegin + dx) + static_cast<uint32_t>((batchBegin + path) % samplesPerPixel);
+#if RT_ENABLE_STATS
+         Statistics::BeginPixel();
+         RT_STAT_INCREMENT(StatCounter::Samples);
+         Statistics::EndPixel(rowBegin + dx);
+#endif
+         sampler.StartPixelSample(dx, row, sampleIndex);
+         m_paths.SetRay(path, cameraRays.Generate<Features>(dx, dy, sampler));
+         m_paths.Throughputs.Set(path, Color(1.0, 1.0, 1.0));
+         m_paths.Radiances.Set(path, Color(0.0, 0.0, 0.0));
+         m_paths.Pixels[path] = static_cast<uint32_t>(dx);
+         m_paths.Samples[path] = sampleIndex;
+         m_active.push_back(static_cast<uint32_t>(path));
+      }
+   }
+
+   void Intersect(const Hittable& world, const Color& background, [[maybe_unused]] size_t rowBegin, RayCounters& counters)
+   {
+      m_shading.clear();
+      counters.Rays += m_active.size();
+      for (uint32_t path : m_active)
+      {
+#if RT_ENABLE_STATS
+         Statistics::BeginPixel();
+         RT_STAT_INCREMENT(StatCounter::Rays);
+#endif
+         HitRecord rec;
+         const bool bHit = world.Hit(m_paths.GetRay(path), 0.001, Infinity, rec);
+#if RT_ENABLE_STATS
+         Statistics::EndPixel(rowBegin + m_paths.Pixels[path]);
+#endif
+         RecordHit(path, bHit, rec, background);
+      }
+   }
+
+   // Camera rays of consecutive paths start at the same pixel or its neighbours, coherent enough to be traced in
+   // packets. Traversal statistics of a packet are counted at the pixel of its first ray.
+   void IntersectPackets(const Hittable& world, const Color& background, [[maybe_unused]] size_t rowBegin, RayCounters& counters)
+   {
+      m_shading.clear();
+      counters.Rays += m_active.size();
+      Ray rays[RayPacketConstants::MaximumSize];
+      HitRecord recs[RayPacketConstants::MaximumSize];
+      for (size_t first = 0; first < m_active.size(); first += m_packetSize)
+      {
+         const size_t count = std::min(m_packetSize, m_active.size() - first);
+         for (size_t lane = 0; lane < count; ++lane)
+         {
+            rays[lane] = m_paths.GetRay(m_active[first + lane]);
+         }
+
+         m_packet.Set(rays, count);
+#if RT_ENABLE_STATS
+         Statistics::BeginPixel();
+         for (size_t lane = 0; lane < count; ++lane)
+         {
+            RT_STAT_INCREMENT(StatCounter::Rays);
+         }
+#endif
+         const uint32_t hits = world.HitPacket(m_packet, 0.001, recs);
+#if RT_ENABLE_STATS
+         Statistics::EndPixel(rowBegin + m_paths.Pixels[m_active[first]]);
+#endif
+         for (size_t lane = 0; lane < count; ++lane)
+         {
+            RecordHit(m_active[first + lane], (hits >> lane) & 1, recs[lane], background);
+         }
+      }
+   }
+
+   void RecordHit(uint32_t path, bool bHit, const HitRecord& rec, const Color& background)
+   {
+      if (bHit)
+      {
+         m_hits.Set(path, rec);
+         m_shading.push_back(path);
+      }
+      else
+      {
+         Color radiance = m_paths.Radiances.Get(path);
+         radiance += m_paths.Throughputs.Get(path) * background;
+         m_paths.Radiances.Set(path, radiance);
+         m_paths.bAlive[path] = 0;
+      }
+   }
+
+   // Counting sort on the index of the material in the table, linear in the number of paths and the number of
+   // materials. Paths of a material stay in path order, which keeps the rest of the work as coherent as it was.
+   void SortByMaterial(const MaterialTable& materials)
+   {
+      m_bucketOffsets.assign(materials.MaterialCount(), 0);
+      for (uint32_t path : m_shading)
+      {
+         ++m_bucketOffsets[m_hits.Materials[path]];
+      }
+
+      uint32_t offset = 0;
+      for (uint32_t& bucketOffset : m_bucketOffsets)
+      {
+         const uint32_t count = bucketOffset;
+         bucketOffset = offset;
+         offset += count;
+      }
+
+      m_sorted.resize(m_shading.size());
+      for (uint32_t path : m_shading)
+      {
+         m_sorted[m_bucketOffsets[m_hits.Materials[path]]++] = path;
+      }
+
+      m_shading.swap(m_sorted);
+   }
+
+   template<uint32_t Features>
+   void Shade(const MaterialTable& materials, int row, [[maybe_unused]] size_t rowBegin, int bounce, Sampler& sampler)
+   {
+      for (uint32_t path : m_shading)
+      {
+#if RT_ENABLE_STATS
+         Statistics::BeginPixel();
+         RT_STAT_INCREMENT(StatCounter::ScatterCalls);
+#endif
+         const uint32_t material = m_hits.Materials[path];
+         const HitRecord rec = m_hits.Get(path);
+         Color throughput = m_paths.Throughputs.Get(path);
+         if constexpr (HasFeature(Features, RenderFeature::Emissives))
+         {
+            Color radiance = m_paths.Radiances.Get(path);
+            radiance += throughput * materials.Emitted(material, rec.u, rec.v, rec.p);
+            m_paths.Radiances.Set(path, radiance);
+         }
+
+         ScatterRecord srec;
+         sampler.ResumeBounce(static_cast<int>(m_paths.Pixels[path]), row, m_paths.Samples[path], bounce);
+         if (materials.Scatter<Features>(material, m_paths.GetRay(path), rec, sampler, srec))
+         {
+            throughput *= srec.Attenuation;
+            m_paths.Throughputs.Set(path, throughput);
+            m_paths.SetRay(path, srec.Scattered);
+            m_paths.bAlive[path] = 1;
+         }
+         else
+         {
+            m_paths.bAlive[path] = 0;
+         }
+#if RT_ENABLE_STATS
+         Statistics::EndPixel(rowBegin + m_paths.Pixels[path]);
+#endif
+      }
+   }
+
+   void Compact()
+   {
+      m_active.erase(std::remove_if(m_active.begin(), m_active.end(), [this](uint32_t path) { return m_paths.bAlive[path] == 0; }), m_active.end());
+   }
+
+private:
+   int m_imageWidth = 0;
+   int m_imageHeight = 0;
+   int m_maximumDepth = 0;
+   size_t m_packetSize = 1;
+   bool m_bReorderRays = false;
+   PathBuffer m_paths;
+   HitBuffer m_hits;
+   std::vector<uint32_t> m_active; // Paths still traced, in path order unless reordered
+   std::vector<uint32_t> m_shading; // Paths which hit something, sorted by material
+   std::vector<uint32_t> m_sorted;
+   std::vector<uint32_t> m_bucketOffsets; // Per material of the table
+   std::vector<PixelSamples> m_pixelSamples;
+   RayPacket m_packet;
+   RayReorderer m_reorderer;
+
+};
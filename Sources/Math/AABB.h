@@ -1,4 +1,5 @@
 #pragma once
+#include <Core/Statistics.h>
 #include <Math/Ray.h>
 
 class AABB
@@ -13,6 +14,7 @@ public:
 
    bool Hit(const Ray& r, double tMin, double tMax) const
    {
+      RT_STAT_INCREMENT(StatCounter::AABBTests);
       for (size_t dim = 0; dim < 3; ++dim)
       {
          auto invD = 1.0 / r.Direction[dim];
@@ -35,6 +37,55 @@ public:
       return true;
    }
 
+   // Same slab test with reciprocal of direction computed once by caller, for testing one ray against many boxes.
+   bool Hit(const Ray& r, const Vec3& invDirection, double tMin, double tMax) const
+   {
+      RT_STAT_INCREMENT(StatCounter::AABBTests);
+      for (int dim = 0; dim < 3; ++dim)
+      {
+         auto t0 = (Minimum[dim] - r.Origin[dim]) * invDirection[dim];
+         auto t1 = (Maximum[dim] - r.Origin[dim]) * invDirection[dim];
+         if (invDirection[dim] < 0.0)
+         {
+            std::swap(t0, t1);
+         }
+
+         tMin = t0 > tMin ? t0 : tMin;
+         tMax = t1 < tMax ? t1 : tMax;
+         if (tMax <= tMin)
+         {
+            return false;
+         }
+      }
+
+      return true;
+   }
+
+   // Same slab test, narrowing [tMin, tMax] down to the part of the ray inside of the box.
+   bool Clip(const Ray& r, double& tMin, double& tMax) const
+   {
+      RT_STAT_INCREMENT(StatCounter::AABBTests);
+      for (int dim = 0; dim < 3; ++dim)
+      {
+         auto invD = 1.0 / r.Direction[dim];
+         auto t0 = (Minimum[dim] - r.Origin[dim]) * invD;
+         auto t1 = (Maximum[dim] - r.Origin[dim]) * invD;
+         if (invD < 0.0)
+         {
+            std::swap(t0, t1);
+         }
+
+         tMin = t0 > tMin ? t0 : tMin;
+         tMax = t1 < tMax ? t1 : tMax;
+         if (tMax <= tMin)
+         {
+            return false;
+         }
+      }
+
+      return true;
+   }
+
    static AABB SurroundingBox(const AABB& box0, const AABB& box1)
    {
       Point3 min(
@@ -50,6 +101,53 @@ public:
       return AABB(min, max);
    }
 
+   static AABB Intersection(const AABB& box0, const AABB& box1)
+   {
+      Point3 min(
+         std::fmax(box0.Minimum.x, box1.Minimum.x),
+         std::fmax(box0.Minimum.y, box1.Minimum.y),
+         std::fmax(box0.Minimum.z, box1.Minimum.z));
+
+      Point3 max(
+         std::fmin(box0.Maximum.x, box1.Maximum.x),
+         std::fmin(box0.Maximum.y, box1.Maximum.y),
+         std::fmin(box0.Maximum.z, box1.Maximum.z));
+
+      return AABB(min, max);
+   }
+
+   static AABB Empty()
+   {
+      return AABB(Point3(Infinity, Infinity, Infinity), Point3(-Infinity, -Infinity, -Infinity));
+   }
+
+   bool IsEmpty() const
+   {
+      return Minimum.x > Maximum.x || Minimum.y > Maximum.y || Minimum.z > Maximum.z;
+   }
+
+   Point3 Centroid() const
+   {
+      return 0.5 * (Minimum + Maximum);
+   }
+
+   double SurfaceArea() const
+   {
+      Vec3 d = Maximum - Minimum;
+      return 2.0 * (d.x * d.y + d.x * d.z + d.y * d.z);
+   }
+
+   int MaximumExtent() const
+   {
+      Vec3 d = Maximum - Minimum;
+      if (d.x > d.y && d.x > d.z)
+      {
+         return 0;
+      }
+
+      return d.y > d.z ? 1 : 2;
+   }
+
 public:
    Point3 Minimum;
    Point3 Maximum;
@@ -0,0 +1,142 @@
+#pragma once
+#include <Math/AABB.h>
+#include <Math/Ray.h>
+#include <cmath>
+
+namespace RayPacketConstants
+{
+   constexpr size_t MaximumSize = 16;
+   constexpr size_t Sizes[] = { 4, 8, 16 }; // Sizes traversed as packets; others are traced ray by ray
+}
+
+// Rays traced together, referenced in the caller's array and also stored lane by lane for box tests the compiler can
+// vectorize. In a coherent packet every ray has the same direction signs and no zero direction component, so traversal
+// can take one child order for all of them, and the whole packet is bounded by intervals of origins and reciprocal
+// directions for culling (Boulos et al. 2006, "Geometric and Arithmetic Culling Methods for Entire Ray Packets").
+struct RayPacket
+{
+public:
+   // Rays must outlive tracing of the packet.
+   void Set(const Ray* rays, size_t count)
+   {
+      Rays = rays;
+      Size = std::min(count, RayPacketConstants::MaximumSize);
+      bCoherent = Size > 0;
+      for (int dim = 0; dim < 3; ++dim)
+      {
+         bNegative[dim] = Size > 0 && rays[0].Direction[dim] < 0.0;
+         OriginMinimum[dim] = Infinity;
+         OriginMaximum[dim] = -Infinity;
+         InvDirectionMinimum[dim] = Infinity;
+         InvDirectionMaximum[dim] = -Infinity;
+      }
+
+      for (size_t lane = 0; lane < Size; ++lane)
+      {
+         for (int dim = 0; dim < 3; ++dim)
+         {
+            const double origin = rays[lane].Origin[dim];
+            const double invDirection = 1.0 / rays[lane].Direction[dim];
+            Origins[dim][lane] = origin;
+            InvDirections[dim][lane] = invDirection;
+            OriginMinimum[dim] = std::min(OriginMinimum[dim], origin);
+            OriginMaximum[dim] = std::max(OriginMaximum[dim], origin);
+            InvDirectionMinimum[dim] = std::min(InvDirectionMinimum[dim], invDirection);
+            InvDirectionMaximum[dim] = std::max(InvDirectionMaximum[dim], invDirection);
+            bCoherent = bCoherent && (rays[lane].Direction[dim] < 0.0) == bNegative[dim] &&
+               std::isfinite(invDirection) && std::signbit(invDirection) == bNegative[dim];
+         }
+      }
+   }
+
+   Vec3 GetInvDirection(size_t lane) const
+   {
+      return Vec3(InvDirections[0][lane], InvDirections[1][lane], InvDirections[2][lane]);
+   }
+
+   // False when no ray of a coherent packet hits box within [tMin, tMax]. Rounding is monotonic, so bounds computed
+   // from the interval ends bound what every ray computes in AABB::Hit; culling is conservative.
+   bool MayHit(const AABB& box, double tMin, double tMax) const
+   {
+      for (int dim = 0; dim < 3; ++dim)
+      {
+         const double nearPlane = bNegative[dim] ? box.Maximum[dim] : box.Minimum[dim];
+         const double farPlane = bNegative[dim] ? box.Minimum[dim] : box.Maximum[dim];
+         double nearLow = 0.0;
+         double nearHigh = 0.0;
+         double farLow = 0.0;
+         double farHigh = 0.0;
+         MultiplyIntervals(nearPlane - OriginMaximum[dim], nearPlane - OriginMinimum[dim],
+            InvDirectionMinimum[dim], InvDirectionMaximum[dim], nearLow, nearHigh);
+         MultiplyIntervals(farPlane - OriginMaximum[dim], farPlane - OriginMinimum[dim],
+            InvDirectionMinimum[dim], InvDirectionMaximum[dim], farLow, farHigh);
+         tMin = nearLow > tMin ? nearLow : tMin;
+         tMax = farHigh < tMax ? farHigh : tMax;
+         if (tMax <= tMin)
+         {
+            return false;
+         }
+      }
+
+      return true;
+   }
+
+   // Lanes of mask whose ray hits box before its own tMax, with the arithmetic of AABB::Hit. Lanes are the inner loop
+   // and selects replace branches, so the compiler vectorizes it.
+   template<size_t N>
+   uint32_t HitMask(const AABB& box, double tMin, const double* tMaxs, uint32_t mask) const
+   {
+      double laneMins[N];
+      double laneMaxs[N];
+      for (size_t lane = 0; lane < N; ++lane)
+      {
+         laneMins[lane] = tMin;
+         laneMaxs[lane] = tMaxs[lane];
+      }
+
+      for (int dim = 0; dim < 3; ++dim)
+      {
+         const double minimum = box.Minimum[dim];
+         const double maximum = box.Maximum[dim];
+         for (size_t lane = 0; lane < N; ++lane)
+         {
+            const double invDirection = InvDirections[dim][lane];
+            const double t0 = (minimum - Origins[dim][lane]) * invDirection;
+            const double t1 = (maximum - Origins[dim][lane]) * invDirection;
+            const double tNear = invDirection < 0.0 ? t1 : t0;
+            const double tFar = invDirection < 0.0 ? t0 : t1;
+            laneMins[lane] = tNear > laneMins[lane] ? tNear : laneMins[lane];
+            laneMaxs[lane] = tFar < laneMaxs[lane] ? tFar : laneMaxs[lane];
+         }
+      }
+
+      uint32_t hits = 0;
+      for (size_t lane = 0; lane < N; ++lane)
+      {
+         hits |= static_cast<uint32_t>(laneMaxs[lane] > laneMins[lane]) << lane;
+      }
+
+      return hits & mask;
+   }
+
+private:
+   static void MultiplyIntervals(double aLow, double aHigh, double bLow, double bHigh, double& low, double& high)
+   {
+      const double products[4] = { aLow * bLow, aLow * bHigh, aHigh * bLow, aHigh * bHigh };
+      low = std::min({ products[0], products[1], products[2], products[3] });
+      high = std::max({ products[0], products[1], products[2], products[3] });
+   }
+
+public:
+   const Ray* Rays = nullptr;
+   double Origins[3][RayPacketConstants::MaximumSize];
+   double InvDirections[3][RayPacketConstants::MaximumSize];
+   Vec3 OriginMinimum;
+   Vec3 OriginMaximum;
+   Vec3 InvDirectionMinimum;
+   Vec3 InvDirectionMaximum;
+   size_t Size = 0;
+   bool bNegative[3] = {};
+   bool bCoherent = false;
+
+};
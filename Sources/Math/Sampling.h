@@ -0,0 +1,234 @@
+#pragma once
+#include <Core/CoreMinimal.h>
+#include <Math/Vec2.h>
+#include <Math/Vec3.h>
+
+// Warps of uniform samples in [0, 1)^n into other domains, each with the density it samples. Unlike rejection
+// sampling, every warp consumes a fixed number of dimensions and has no data dependent loop, which samplers indexed
+// by dimension rely on. Directions of hemispheres and cones are local around +z; OrthonormalBasis moves them around a
+// normal.
+
+// Frame around a unit vector, built without branches (Duff et al. 2017).
+struct OrthonormalBasis
+{
+public:
+   OrthonormalBasis(const Vec3& normal) :
+      W(normal)
+   {
+      const double sign = std::copysign(1.0, normal.z);
+      const double a = -1.0 / (sign + normal.z);
+      const double b = normal.x * normal.y * a;
+      U = Vec3(1.0 + sign * normal.x * normal.x * a, sign * b, -sign * normal.x);
+      V = Vec3(b, sign + normal.y * normal.y * a, -normal.y);
+   }
+
+   Vec3 ToWorld(const Vec3& local) const
+   {
+      return local.x * U + local.y * V + local.z * W;
+   }
+
+   Vec3 ToLocal(const Vec3& world) const
+   {
+      return Vec3(Dot(world, U), Dot(world, V), Dot(world, W));
+   }
+
+public:
+   Vec3 U;
+   Vec3 V;
+   Vec3 W;
+
+};
+
+// Shirley and Chiu's concentric mapping; keeps strata of the square compact on the disk.
+inline Point2 SampleConcentricDisk(const Point2& u)
+{
+   const double ox = 2.0 * u.x - 1.0;
+   const double oy = 2.0 * u.y - 1.0;
+   if (ox == 0.0 && oy == 0.0)
+   {
+      return Point2(0.0, 0.0);
+   }
+
+   double r = 0.0;
+   double theta = 0.0;
+   if (std::abs(ox) > std::abs(oy))
+   {
+      r = ox;
+      theta = (Pi / 4.0) * (oy / ox);
+   }
+   else
+   {
+      r = oy;
+      theta = (Pi / 2.0) - (Pi / 4.0) * (ox / oy);
+   }
+
+   return Point2(r * std::cos(theta), r * std::sin(theta));
+}
+
+inline double UniformDiskPDF()
+{
+   return 1.0 / Pi;
+}
+
+inline Vec3 SampleUniformSphere(const Point2& u)
+{
+   const double z = 1.0 - 2.0 * u.x;
+   const double r = std::sqrt(std::max(0.0, 1.0 - z * z));
+   const double phi = 2.0 * Pi * u.y;
+   return Vec3(r * std::cos(phi), r * std::sin(phi), z);
+}
+
+inline double UniformSpherePDF()
+{
+   return 1.0 / (4.0 * Pi);
+}
+
+// Uniform in the volume of unit ball; radius is the cube root of the third dimension.
+inline Vec3 SampleUniformBall(const Point2& u, double uRadius)
+{
+   return std::cbrt(uRadius) * SampleUniformSphere(u);
+}
+
+inline double UniformBallPDF()
+{
+   return 3.0 / (4.0 * Pi);
+}
+
+inline Vec3 SampleUniformHemisphere(const Point2& u)
+{
+   const double z = u.x;
+   const double r = std::sqrt(std::max(0.0, 1.0 - z * z));
+   const double phi = 2.0 * Pi * u.y;
+   return Vec3(r * std::cos(phi), r * std::sin(phi), z);
+}
+
+inline double UniformHemispherePDF()
+{
+   return 1.0 / (2.0 * Pi);
+}
+
+// Malley's method: concentric disk sample projected up to the hemisphere.
+inline Vec3 SampleCosineHemisphere(const Point2& u)
+{
+   const Point2 d = SampleConcentricDisk(u);
+   const double z = std::sqrt(std::max(0.0, 1.0 - d.x * d.x - d.y * d.y));
+   return Vec3(d.x, d.y, z);
+}
+
+inline double CosineHemispherePDF(double cosTheta)
+{
+   return std::max(0.0, cosTheta) / Pi;
+}
+
+// Directions within cosThetaMax of +z, e.g. towards a sphere seen from outside.
+inline Vec3 SampleUniformCone(const Point2& u, double cosThetaMax)
+{
+   const double cosTheta = (1.0 - u.x) + u.x * cosThetaMax;
+   const double sinTheta = std::sqrt(std::max(0.0, 1.0 - cosTheta * cosTheta));
+   const double phi = 2.0 * Pi * u.y;
+   return Vec3(sinTheta * std::cos(phi), sinTheta * std::sin(phi), cosTheta);
+}
+
+inline double UniformConePDF(double cosThetaMax)
+{
+   return 1.0 / (2.0 * Pi * (1.0 - cosThetaMax));
+}
+
+// Barycentric coordinates uniform over a triangle, by Heitz's low distortion mapping; density is one over the area.
+inline Vec3 SampleUniformTriangle(const Point2& u)
+{
+   double b0 = 0.0;
+   double b1 = 0.0;
+   if (u.x < u.y)
+   {
+      b0 = u.x / 2.0;
+      b1 = u.y - b0;
+   }
+   else
+   {
+      b1 = u.y / 2.0;
+      b0 = u.x - b1;
+   }
+
+   return Vec3(b0, b1, 1.0 - b0 - b1);
+}
+
+// Point on rectangle corner + s * edgeX + t * edgeY (perpendicular edges) uniform in the solid angle it subtends
+// from reference, by Urena et al. 2013. pdf is the density per solid angle; falls back to uniform area sampling when
+// the rectangle is too small to be seen, reporting zero for a degenerate one.
+inline Point3 SampleSphericalRectangle(const Point3& reference, const Point3& corner, const Vec3& edgeX, const Vec3& edgeY,
+   const Point2& u, double& pdf)
+{
+   const double lengthX = edgeX.Length();
+   const double lengthY = edgeY.Length();
+   const Vec3 axisX = edgeX / lengthX;
+   const Vec3 axisY = edgeY / lengthY;
+   Vec3 axisZ = Cross(axisX, axisY);
+
+   // Local frame with the rectangle at negative z.
+   const Vec3 toCorner = corner - reference;
+   double z0 = Dot(toCorner, axisZ);
+   if (z0 > 0.0)
+   {
+      axisZ = -axisZ;
+      z0 = -z0;
+   }
+
+   const double x0 = Dot(toCorner, axisX);
+   const double y0 = Dot(toCorner, axisY);
+   const double x1 = x0 + lengthX;
+   const double y1 = y0 + lengthY;
+
+   // Normals of the planes through reference and each edge, and the internal angles between them.
+   const Vec3 v00(x0, y0, z0);
+   const Vec3 v01(x0, y1, z0);
+   const Vec3 v10(x1, y0, z0);
+   const Vec3 v11(x1, y1, z0);
+   const Vec3 n0 = UnitVectorOf(Cross(v00, v10));
+   const Vec3 n1 = UnitVectorOf(Cross(v10, v11));
+   const Vec3 n2 = UnitVectorOf(Cross(v11, v01));
+   const Vec3 n3 = UnitVectorOf(Cross(v01, v00));
+   auto angleBetween = [](const Vec3& a, const Vec3& b)
+   {
+      // Stable for nearly parallel unit vectors, unlike acos of the dot product.
+      if (Dot(a, b) < 0.0)
+      {
+         return Pi - 2.0 * std::asin(std::min(1.0, (a + b).Length() / 2.0));
+      }
+
+      return 2.0 * std::asin(std::min(1.0, (b - a).Length() / 2.0));
+   };
+
+   const double g0 = angleBetween(-n0, n1);
+   const double g1 = angleBetween(-n1, n2);
+   const double g2 = angleBetween(-n2, n3);
+   const double g3 = angleBetween(-n3, n0);
+   const double solidAngle = g0 + g1 + g2 + g3 - 2.0 * Pi;
+   const Point3 areaSample = corner + u.x * edgeX + u.y * edgeY;
+   if (!(solidAngle > 0.0) || !std::isfinite(solidAngle))
+   {
+      pdf = 0.0;
+      return areaSample;
+   }
+
+   pdf = 1.0 / solidAngle;
+   if (solidAngle < 1e-3)
+   {
+      return areaSample;
+   }
+
+   // Invert the solid angle of the sub-rectangle [x0, xu] for xu, then the cosine along y.
+   const double b0 = n0.z;
+   const double b1 = n2.z;
+   const double au = u.x * solidAngle - g2 - g3;
+   const double fu = (std::cos(au) * b0 - b1) / std::sin(au);
+   const double cu = std::clamp(std::copysign(1.0 / std::sqrt(fu * fu + b0 * b0), fu), -1.0 + 1e-12, 1.0 - 1e-12);
+   const double xu = std::clamp(-(cu * z0) / std::sqrt(1.0 - cu * cu), x0, x1);
+
+   const double distance = std::sqrt(xu * xu + z0 * z0);
+   const double h0 = y0 / std::sqrt(distance * distance + y0 * y0);
+   const double h1 = y1 / std::sqrt(distance * distance + y1 * y1);
+   const double hv = h0 + u.y * (h1 - h0);
+   const double yv = hv * hv < 1.0 - 1e-12 ? (hv * distance) / std::sqrt(1.0 - hv * hv) : y1;
+   return reference + xu * axisX + yv * axisY + z0 * axisZ;
+}
@@ -0,0 +1,33 @@
+#pragma once
+#include <Math/MathMinimal.h>
+
+// Points of 2D sample domains (pixel jitter, lens, directions before warping).
+class Vec2
+{
+public:
+   Vec2() : Vec2(0.0, 0.0)
+   {
+   }
+
+   Vec2(double xx, double yy) :
+      x(xx),
+      y(yy)
+   {
+   }
+
+   inline double operator[](int idx) const { return e[idx]; }
+   inline double& operator[](int idx) { return e[idx]; }
+
+public:
+   union
+   {
+      double e[2];
+      struct
+      {
+         double x;
+         double y;
+      };
+   };
+};
+
+using Point2 = Vec2;
@@ -199,52 +199,6 @@ inline Vec3 UnitVectorOf(const Vec3& v)
    return (v / v.Length());
 }
 
-inline Vec3 RandomInUnitSphere()
-{
-   while (true)
-   {
-      auto p = Vec3::Random(-1.0, 1.0);
-      if (p.SquaredLength() >= 1.0)
-      {
-         continue;
-      }
-
-      return p;
-   }
-}
-
-inline Vec3 RandomUnitVector()
-{
-   return UnitVectorOf(RandomInUnitSphere());
-}
-
-inline Vec3 RandomInHemisphere(const Vec3& normal)
-{
-   Vec3 inUnitSphere = RandomInUnitSphere();
-   if (Dot(inUnitSphere, normal) > 0.0) // Normal  Hemisphere  
-   {
-      return inUnitSphere;
-   }
-   else // Normal ݴ Hemisphere 
-   {
-      return -inUnitSphere;
-   }
-}
-
-inline Vec3 RandomInUnitDisk()
-{
-   while (true)
-   {
-      auto p = Vec3(RandomDouble(-1.0, 1.0), RandomDouble(-1.0, 1.0), 0.0);
-      if (p.SquaredLength() >= 1.0)
-      {
-         continue;
-      }
-
-      return p;
-   }
-}
-
 inline Vec3 Reflect(const Vec3& v, const Vec3& n)
 {
    return v - 2.0 * Dot(v, n) * n;
@@ -0,0 +1,506 @@
+#pragma once
+#include <Core/CoreMinimal.h>
+#include <Core/Box.h>
+#include <Core/ConstantMedium.h>
+#include <Core/FlatBVH.h>
+#include <Core/GridMedium.h>
+#include <Core/MappedFile.h>
+#include <Core/MaterialTable.h>
+#include <Core/MovingSphere.h>
+#include <Core/Rect.h>
+#include <Core/Sphere.h>
+#include <Scenes/SceneRecords.h>
+#include <cstring>
+#include <unordered_map>
+
+// Scene written by SceneCompiler, mapped into memory and traversed in place. Primitives are plain records
+// dispatched by type, so loading costs one validation pass over the file instead of parsing, allocating an object
+// per primitive and building BVHs.
+class CompiledScene : public Hittable
+{
+public:
+   static std::shared_ptr<CompiledScene> Load(const std::filesystem::path& path)
+   {
+      auto scene = std::shared_ptr<CompiledScene>(new CompiledScene());
+      scene->m_mapping = std::make_unique<MappedFile>(path);
+      if (!scene->m_mapping->IsValid())
+      {
+         std::cerr << "Failed to open compiled scene '" << path.string() << "'.\n";
+         return nullptr;
+      }
+
+      if (!scene->MapSections() || !scene->Validate())
+      {
+         std::cerr << "Invalid or corrupted compiled scene '" << path.string() << "'.\n";
+         return nullptr;
+      }
+
+      scene->CreateMaterials();
+      if (!scene->CreateVolumes())
+      {
+         return nullptr;
+      }
+
+      return scene;
+   }
+
+   static bool IsCompiledScene(const std::filesystem::path& path)
+   {
+      return path.extension() == ".rtscene";
+   }
+
+   bool Hit(const Ray& r, double tMin, double tMax, HitRecord& rec) const override
+   {
+      return HitGroup(m_header.WorldGroup, r, tMin, tMax, rec);
+   }
+
+   uint32_t HitPacket(const RayPacket& packet, double tMin, HitRecord* recs) const override
+   {
+      const SceneGroup& group = m_groups[m_header.WorldGroup];
+      if (group.NodeCount == 0)
+      {
+         return 0;
+      }
+
+      const ScenePrimitive* primitives = m_primitives + group.FirstPrimitive;
+      return FlatBVH::TracePacket(m_nodes + group.FirstNode, m_primitiveIndices + group.FirstIndex, packet, tMin, recs,
+         [this, primitives](uint32_t primitiveIdx, const Ray& r, double tMin, double tMax, HitRecord& rec)
+         {
+            return HitPrimitive(primitives[primitiveIdx], r, tMin, tMax, rec);
+         });
+   }
+
+   bool BoundingBox(double time0, double time1, AABB& outputBox) const override
+   {
+      const SceneGroup& world = m_groups[m_header.WorldGroup];
+      if (world.NodeCount == 0)
+      {
+         return false;
+      }
+
+      outputBox = m_nodes[world.FirstNode].Bounds;
+      return true;
+   }
+
+   std::vector<CameraPreset> GetCameras() const
+   {
+      std::vector<CameraPreset> cameras;
+      for (size_t idx = 0; idx < SectionCount(CompiledSceneSection::Cameras); ++idx)
+      {
+         const SceneCamera& record = m_cameras[idx];
+         CameraPreset camera;
+         camera.Name = record.Name;
+         camera.LookFrom = record.LookFrom;
+         camera.LookAt = record.LookAt;
+         camera.Up = record.Up;
+         camera.VerticalFOV = record.VerticalFOV;
+         camera.Aperture = record.Aperture;
+         camera.FocusDistance = record.FocusDistance;
+         camera.Projection = record.Projection;
+         cameras.push_back(std::move(camera));
+      }
+
+      return cameras;
+   }
+
+   const MaterialTable& GetMaterials() const { return m_materials; }
+   Color GetBackground() const { return m_header.Background; }
+
+   // Whether any primitive moves.
+   bool IsAnimated() const
+   {
+      for (size_t idx = 0; idx < SectionCount(CompiledSceneSection::Primitives); ++idx)
+      {
+         if (m_primitives[idx].Type == ScenePrimitiveType::MovingSphere)
+         {
+            return true;
+         }
+      }
+
+      return false;
+   }
+
+   size_t GetPrimitiveCount() const { return SectionCount(CompiledSceneSection::Primitives); }
+
+private:
+   CompiledScene() = default;
+
+   // Grids of volumes are not part of the file; they are read from their paths, within the bounds they had when the
+   // scene was compiled.
+   bool CreateVolumes()
+   {
+      for (size_t idx = 0; idx < SectionCount(CompiledSceneSection::Primitives); ++idx)
+      {
+         const ScenePrimitive& primitive = m_primitives[idx];
+         if (primitive.Type != ScenePrimitiveType::Volume)
+         {
+            continue;
+         }
+
+         DensityGridData grid;
+         if (!ReadVolFile(std::string(m_strings + primitive.Group, primitive.PathLength), grid))
+         {
+            return false;
+         }
+
+         const double* data = primitive.Data;
+         const AABB bounds(Point3(data[2], data[3], data[4]), Point3(data[5], data[6], data[7]));
+         std::shared_ptr<Hittable> volume;
+         if (data[1] != 0.0)
+         {
+            volume = std::make_shared<GridMedium<SparseGrid>>(bounds, SparseGrid(grid), data[0], primitive.Material);
+         }
+         else
+         {
+            volume = std::make_shared<GridMedium<DenseGrid>>(bounds, DenseGrid(grid), data[0], primitive.Material);
+         }
+
+         m_volumes.emplace(static_cast<uint32_t>(idx), std::move(volume));
+      }
+
+      return true;
+   }
+
+   bool HitGroup(uint32_t groupIdx, const Ray& r, double tMin, double tMax, HitRecord& rec) const
+   {
+      const SceneGroup& group = m_groups[groupIdx];
+      if (group.NodeCount == 0)
+      {
+         return false;
+      }
+
+      const ScenePrimitive* primitives = m_primitives + group.FirstPrimitive;
+      return FlatBVH::Traverse(m_nodes + group.FirstNode, m_primitiveIndices + group.FirstIndex, r, tMin, tMax, rec,
+         [this, primitives](uint32_t primitiveIdx, const Ray& r, double tMin, double tMax, HitRecord& rec)
+         {
+            return HitPrimitive(primitives[primitiveIdx], r, tMin, tMax, rec);
+         });
+   }
+
+   bool HitPrimitive(const ScenePrimitive& primitive, const Ray& r, double tMin, double tMax, HitRecord& rec) const
+   {
+      const double* data = primitive.Data;
+      switch (primitive.Type)
+      {
+      case ScenePrimitiveType::Sphere:
+         RT_STAT_INCREMENT(StatCounter::SphereTests);
+         return Sphere::Intersect(Point3(data[0], data[1], data[2]), data[3], primitive.Material, r, tMin, tMax, rec);
+      case ScenePrimitiveType::MovingSphere:
+         RT_STAT_INCREMENT(StatCounter::MovingSphereTests);
+         return MovingSphere::Intersect(
+            MovingSphere::CenterAt(Point3(data[0], data[1], data[2]), Point3(data[3], data[4], data[5]), data[6], data[7], r.Time),
+            data[8], primitive.Material, r, tMin, tMax, rec);
+      case ScenePrimitiveType::XYRect:
+         RT_STAT_INCREMENT(StatCounter::XYRectTests);
+         return HitAxisAlignedRect<0, 1, 2>(data[0], data[1], data[2], data[3], data[4], primitive.Material, r, tMin, tMax, rec);
+      case ScenePrimitiveType::XZRect:
+         RT_STAT_INCREMENT(StatCounter::XZRectTests);
+         return HitAxisAlignedRect<0, 2, 1>(data[0], data[1], data[2], data[3], data[4], primitive.Material, r, tMin, tMax, rec);
+      case ScenePrimitiveType::YZRect:
+         RT_STAT_INCREMENT(StatCounter::YZRectTests);
+         return HitAxisAlignedRect<1, 2, 0>(data[0], data[1], data[2], data[3], data[4], primitive.Material, r, tMin, tMax, rec);
+      case ScenePrimitiveType::Box:
+         RT_STAT_INCREMENT(StatCounter::BoxTests);
+         return Box::Intersect(Point3(data[0], data[1], data[2]), Point3(data[3], data[4], data[5]), primitive.Material, r, tMin, tMax, rec);
+      case ScenePrimitiveType::Instance:
+         RT_STAT_INCREMENT(StatCounter::InstanceTests);
+         return HitInstance(primitive, r, tMin, tMax, rec);
+      case ScenePrimitiveType::Medium:
+      {
+         RT_STAT_INCREMENT(StatCounter::ConstantMediumTests);
+         auto boundaryCrossings = [this, &primitive](const Ray& boundaryRay, double boundaryMin, double boundaryMax, std::vector<BoundaryCrossing>& crossings)
+         {
+            GroupCrossings(primitive.Group, boundaryRay, boundaryMin, boundaryMax, crossings);
+         };
+
+         return ConstantMedium::HitMedium(boundaryCrossings, -1.0 / data[0], primitive.Material, r, tMin, tMax, rec);
+      }
+      case ScenePrimitiveType::Volume:
+         return m_volumes.find(static_cast<uint32_t>(&primitive - m_primitives))->second->Hit(r, tMin, tMax, rec);
+      }
+
+      return false;
+   }
+
+   // Hits group in its local space, undoing translation and then rotation of the instance.
+   bool HitInstance(const ScenePrimitive& primitive, const Ray& r, double tMin, double tMax, HitRecord& rec) const
+   {
+      const double* data = primitive.Data;
+      const double cosTheta = data[1];
+      const double sinTheta = data[2];
+      if (!HitGroup(primitive.Group, InstanceRay(primitive, r), tMin, tMax, rec))
+      {
+         return false;
+      }
+
+      // Normal already faces against the local ray, so rotating it keeps it facing against the ray and bFrontFace stays valid.
+      rec.p = Point3(cosTheta * rec.p.x + sinTheta * rec.p.z + data[3], rec.p.y + data[4], -sinTheta * rec.p.x + cosTheta * rec.p.z + data[5]);
+      rec.n = Vec3(cosTheta * rec.n.x + sinTheta * rec.n.z, rec.n.y, -sinTheta * rec.n.x + cosTheta * rec.n.z);
+      return true;
+   }
+
+   // r in the local space of the group of an instance.
+   static Ray InstanceRay(const ScenePrimitive& primitive, const Ray& r)
+   {
+      const double* data = primitive.Data;
+      const double cosTheta = data[1];
+      const double sinTheta = data[2];
+      const Point3 origin = r.Origin - Vec3(data[3], data[4], data[5]);
+      return Ray(
+         Point3(cosTheta * origin.x - sinTheta * origin.z, origin.y, sinTheta * origin.x + cosTheta * origin.z),
+         Vec3(cosTheta * r.Direction.x - sinTheta * r.Direction.z, r.Direction.y, sinTheta * r.Direction.x + cosTheta * r.Direction.z),
+         r.Time);
+   }
+
+   // Crossings of the surfaces of a group between tMin and tMax, as Hittable::BoundaryCrossings, for media it bounds.
+   // Groups are built without spatial splits, so every primitive is visited once.
+   void GroupCrossings(uint32_t groupIdx, const Ray& r, double tMin, double tMax, std::vector<BoundaryCrossing>& crossings) const
+   {
+      const SceneGroup& group = m_groups[groupIdx];
+      if (group.NodeCount == 0)
+      {
+         return;
+      }
+
+      const ScenePrimitive* primitives = m_primitives + group.FirstPrimitive;
+      FlatBVH::VisitPrimitives(m_nodes + group.FirstNode, m_primitiveIndices + group.FirstIndex, r, tMin, tMax,
+         [this, primitives, &r, tMin, tMax, &crossings](uint32_t primitiveIdx)
+         {
+            PrimitiveCrossings(primitives[primitiveIdx], r, tMin, tMax, crossings);
+         });
+   }
+
+   void PrimitiveCrossings(const ScenePrimitive& primitive, const Ray& r, double tMin, double tMax, std::vector<BoundaryCrossing>& crossings) const
+   {
+      const double* data = primitive.Data;
+      switch (primitive.Type)
+      {
+      case ScenePrimitiveType::Sphere:
+         RT_STAT_INCREMENT(StatCounter::SphereTests);
+         Sphere::Crossings(Point3(data[0], data[1], data[2]), data[3], r, tMin, tMax, crossings);
+         break;
+      case ScenePrimitiveType::MovingSphere:
+         RT_STAT_INCREMENT(StatCounter::MovingSphereTests);
+         Sphere::Crossings(
+            MovingSphere::CenterAt(Point3(data[0], data[1], data[2]), Point3(data[3], data[4], data[5]), data[6], data[7], r.Time),
+            data[8], r, tMin, tMax, crossings);
+         break;
+      case ScenePrimitiveType::Box:
+         RT_STAT_INCREMENT(StatCounter::BoxTests);
+         Box::Crossings(Point3(data[0], data[1], data[2]), Point3(data[3], data[4], data[5]), r, tMin, tMax, crossings);
+         break;
+      case ScenePrimitiveType::Instance:
+         RT_STAT_INCREMENT(StatCounter::InstanceTests);
+         GroupCrossings(primitive.Group, InstanceRay(primitive, r), tMin, tMax, crossings);
+         break;
+      case ScenePrimitiveType::Medium:
+      case ScenePrimitiveType::Volume:
+         // Media have no surface to cross.
+         break;
+      default:
+      {
+         // A rect is crossed where it is hit.
+         HitRecord rec;
+         if (HitPrimitive(primitive, r, tMin, tMax, rec))
+         {
+            crossings.push_back({ rec.t, rec.bFrontFace });
+         }
+         break;
+      }
+      }
+   }
+
+   size_t SectionCount(CompiledSceneSection section) const
+   {
+      return static_cast<size_t>(m_header.Sections[static_cast<size_t>(section)].Count);
+   }
+
+   template<typename T>
+   const T* SectionData(CompiledSceneSection section) const
+   {
+      return reinterpret_cast<const T*>(m_mapping->Data() + m_header.Sections[static_cast<size_t>(section)].Offset);
+   }
+
+   bool MapSections()
+   {
+      if (m_mapping->Size() < sizeof(CompiledSceneHeader))
+      {
+         return false;
+      }
+
+      std::memcpy(&m_header, m_mapping->Data(), sizeof(m_header));
+      if (std::memcmp(m_header.Magic, CompiledSceneConstants::Magic, sizeof(m_header.Magic)) != 0 ||
+         m_header.Version != CompiledSceneConstants::Version)
+      {
+         return false;
+      }
+
+      const size_t elementSizes[CompiledSceneConstants::SectionCount] = {
+         sizeof(SceneCamera), sizeof(SceneTexture), sizeof(SceneMaterial), sizeof(ScenePrimitive),
+         sizeof(SceneGroup), sizeof(FlatBVHNode), sizeof(uint32_t), sizeof(char)
+      };
+
+      for (size_t idx = 0; idx < CompiledSceneConstants::SectionCount; ++idx)
+      {
+         const auto& section = m_header.Sections[idx];
+         if (section.Offset % CompiledSceneConstants::SectionAlignment != 0 ||
+            section.Offset > m_mapping->Size() ||
+            section.Count > (m_mapping->Size() - section.Offset) / elementSizes[idx])
+         {
+            return false;
+         }
+      }
+
+      m_cameras = SectionData<SceneCamera>(CompiledSceneSection::Cameras);
+      m_textureRecords = SectionData<SceneTexture>(CompiledSceneSection::Textures);
+      m_materialRecords = SectionData<SceneMaterial>(CompiledSceneSection::Materials);
+      m_primitives = SectionData<ScenePrimitive>(CompiledSceneSection::Primitives);
+      m_groups = SectionData<SceneGroup>(CompiledSceneSection::Groups);
+      m_nodes = SectionData<FlatBVHNode>(CompiledSceneSection::Nodes);
+      m_primitiveIndices = SectionData<uint32_t>(CompiledSceneSection::PrimitiveIndices);
+      m_strings = SectionData<char>(CompiledSceneSection::Strings);
+      return true;
+   }
+
+   // Checks every index so that traversal never reads outside of the file. Groups may only refer to groups defined
+   // before them, which rules out cycles.
+   bool Validate() const
+   {
+      const size_t textureCount = SectionCount(CompiledSceneSection::Textures);
+      const size_t materialCount = SectionCount(CompiledSceneSection::Materials);
+      const size_t primitiveCount = SectionCount(CompiledSceneSection::Primitives);
+      const size_t groupCount = SectionCount(CompiledSceneSection::Groups);
+      const size_t nodeCount = SectionCount(CompiledSceneSection::Nodes);
+      const size_t indexCount = SectionCount(CompiledSceneSection::PrimitiveIndices);
+      const size_t stringLength = SectionCount(CompiledSceneSection::Strings);
+      if (m_header.WorldGroup >= groupCount)
+      {
+         return false;
+      }
+
+      for (size_t idx = 0; idx < SectionCount(CompiledSceneSection::Cameras); ++idx)
+      {
+         if (std::memchr(m_cameras[idx].Name, '\0', sizeof(m_cameras[idx].Name)) == nullptr ||
+            m_cameras[idx].Projection >= CameraProjection::Count)
+         {
+            return false;
+         }
+      }
+
+      for (size_t idx = 0; idx < textureCount; ++idx)
+      {
+         const SceneTexture& texture = m_textureRecords[idx];
+         const bool bValid =
+            (texture.Type == SceneTextureType::Solid) ||
+            (texture.Type == SceneTextureType::Checker && texture.Even < idx && texture.Odd < idx) ||
+            (texture.Type == SceneTextureType::Image && static_cast<size_t>(texture.PathOffset) + texture.PathLength <= stringLength);
+         if (!bValid)
+         {
+            return false;
+         }
+      }
+
+      for (size_t idx = 0; idx < materialCount; ++idx)
+      {
+         const SceneMaterial& material = m_materialRecords[idx];
+         const bool bUsesTexture = material.Type != SceneMaterialType::Metal && material.Type != SceneMaterialType::Dielectric;
+         if (material.Type > SceneMaterialType::Isotropic || (bUsesTexture && material.Texture >= textureCount))
+         {
+            return false;
+         }
+      }
+
+      for (size_t groupIdx = 0; groupIdx < groupCount; ++groupIdx)
+      {
+         const SceneGroup& group = m_groups[groupIdx];
+         if (static_cast<size_t>(group.FirstPrimitive) + group.PrimitiveCount > primitiveCount ||
+            static_cast<size_t>(group.FirstNode) + group.NodeCount > nodeCount ||
+            static_cast<size_t>(group.FirstIndex) + group.IndexCount > indexCount ||
+            !ValidateFlatBVHNodes(m_nodes + group.FirstNode, group.NodeCount, group.IndexCount) ||
+            !ValidateFlatBVHPrimitiveIndices(m_primitiveIndices + group.FirstIndex, group.IndexCount, group.PrimitiveCount))
+         {
+            return false;
+         }
+
+         for (size_t idx = 0; idx < group.PrimitiveCount; ++idx)
+         {
+            const ScenePrimitive& primitive = m_primitives[group.FirstPrimitive + idx];
+            const bool bUsesGroup = primitive.Type == ScenePrimitiveType::Instance || primitive.Type == ScenePrimitiveType::Medium;
+            const bool bUsesPath = primitive.Type == ScenePrimitiveType::Volume;
+            if (primitive.Type > ScenePrimitiveType::Volume ||
+               (primitive.Type != ScenePrimitiveType::Instance && primitive.Material >= materialCount) ||
+               (bUsesGroup && primitive.Group >= groupIdx) ||
+               (bUsesPath && static_cast<size_t>(primitive.Group) + primitive.PathLength > stringLength))
+            {
+               return false;
+            }
+         }
+      }
+
+      return true;
+   }
+
+   // Records of the file are in the order they were added by the parser, so they keep their indices in the table.
+   void CreateMaterials()
+   {
+      const size_t textureCount = SectionCount(CompiledSceneSection::Textures);
+      for (size_t idx = 0; idx < textureCount; ++idx)
+      {
+         const SceneTexture& texture = m_textureRecords[idx];
+         switch (texture.Type)
+         {
+         case SceneTextureType::Checker:
+            m_materials.AddCheckerTexture(texture.Even, texture.Odd);
+            break;
+         case SceneTextureType::Image:
+            m_materials.AddImageTexture(std::string_view(m_strings + texture.PathOffset, texture.PathLength));
+            break;
+         case SceneTextureType::Solid:
+         default:
+            m_materials.AddSolidTexture(texture.Albedo);
+            break;
+         }
+      }
+
+      const size_t materialCount = SectionCount(CompiledSceneSection::Materials);
+      for (size_t idx = 0; idx < materialCount; ++idx)
+      {
+         const SceneMaterial& material = m_materialRecords[idx];
+         switch (material.Type)
+         {
+         case SceneMaterialType::Metal:
+            m_materials.AddMetal(material.Albedo, material.Parameter);
+            break;
+         case SceneMaterialType::Dielectric:
+            m_materials.AddDielectric(material.Parameter);
+            break;
+         case SceneMaterialType::DiffuseLight:
+            m_materials.AddDiffuseLight(material.Texture);
+            break;
+         case SceneMaterialType::Isotropic:
+            m_materials.AddIsotropic(material.Texture);
+            break;
+         case SceneMaterialType::Lambertian:
+         default:
+            m_materials.AddLambertian(material.Texture);
+            break;
+         }
+      }
+   }
+
+private:
+   std::unique_ptr<MappedFile> m_mapping;
+   CompiledSceneHeader m_header;
+   const SceneCamera* m_cameras = nullptr;
+   const SceneTexture* m_textureRecords = nullptr;
+   const SceneMaterial* m_materialRecords = nullptr;
+   const ScenePrimitive* m_primitives = nullptr;
+   const SceneGroup* m_groups = nullptr;
+   const FlatBVHNode* m_nodes = nullptr;
+   const uint32_t* m_primitiveIndices = nullptr;
+   const char* m_strings = nullptr;
+
+   MaterialTable m_materials;
+   std::unordered_map<uint32_t, std::shared_ptr<Hittable>> m_volumes; // By index of primitive
+
+};
@@ -0,0 +1,188 @@
+#pragma once
+#include <Core/CoreMinimal.h>
+#include <Core/Box.h>
+#include <Core/BVHCache.h>
+#include <Core/ConstantMedium.h>
+#include <Core/GridMedium.h>
+#include <Core/HittableList.h>
+#include <Core/Instance.h>
+#include <Core/MaterialTable.h>
+#include <Core/MovingSphere.h>
+#include <Core/Rect.h>
+#include <Core/Sphere.h>
+#include <Scenes/SceneRecords.h>
+
+struct SceneFileData
+{
+public:
+   std::unique_ptr<HittableList> World;
+   MaterialTable Materials;
+   std::vector<CameraPreset> Cameras;
+   Color Background;
+   bool bAnimated = false; // Has moving primitives
+
+};
+
+// Builds Hittable objects out of scene records, for rendering a scene file right after parsing it.
+class HittableSceneBuilder : public SceneSink
+{
+public:
+   HittableSceneBuilder(SceneFileData& output) :
+      m_output(output)
+   {
+      m_output.World = std::make_unique<HittableList>();
+      m_output.Materials = MaterialTable();
+      m_output.Cameras.clear();
+      m_output.Background = Color();
+      m_output.bAnimated = false;
+      m_containers.assign(1, m_output.World.get());
+   }
+
+   void SetBackground(const Color& background) override
+   {
+      m_output.Background = background;
+   }
+
+   void AddCamera(const CameraPreset& camera) override
+   {
+      m_output.Cameras.push_back(camera);
+   }
+
+   uint32_t AddTexture(const SceneTexture& texture, std::string_view imagePath) override
+   {
+      switch (texture.Type)
+      {
+      case SceneTextureType::Checker:
+         return m_output.Materials.AddCheckerTexture(texture.Even, texture.Odd);
+      case SceneTextureType::Image:
+         return m_output.Materials.AddImageTexture(imagePath);
+      case SceneTextureType::Solid:
+      default:
+         return m_output.Materials.AddSolidTexture(texture.Albedo);
+      }
+   }
+
+   uint32_t AddMaterial(const SceneMaterial& material) override
+   {
+      MaterialTable& materials = m_output.Materials;
+      switch (material.Type)
+      {
+      case SceneMaterialType::Metal:
+         return materials.AddMetal(material.Albedo, material.Parameter);
+      case SceneMaterialType::Dielectric:
+         return materials.AddDielectric(material.Parameter);
+      case SceneMaterialType::DiffuseLight:
+         return materials.AddDiffuseLight(material.Texture);
+      case SceneMaterialType::Isotropic:
+         return materials.AddIsotropic(material.Texture);
+      case SceneMaterialType::Lambertian:
+      default:
+         return materials.AddLambertian(material.Texture);
+      }
+   }
+
+   void AddPrimitive(const ScenePrimitive& primitive) override
+   {
+      const double* data = primitive.Data;
+      const uint32_t material = primitive.Material;
+      HittableList& container = *m_containers.back();
+      switch (primitive.Type)
+      {
+      case ScenePrimitiveType::Sphere:
+         container.Add(std::make_shared<Sphere>(Point3(data[0], data[1], data[2]), data[3], material));
+         break;
+      case ScenePrimitiveType::MovingSphere:
+         m_output.bAnimated = true;
+         container.Add(std::make_shared<MovingSphere>(Point3(data[0], data[1], data[2]), Point3(data[3], data[4], data[5]),
+            data[6], data[7], data[8], material));
+         break;
+      case ScenePrimitiveType::XYRect:
+         container.Add(std::make_shared<XYRect>(data[0], data[1], data[2], data[3], data[4], material));
+         break;
+      case ScenePrimitiveType::XZRect:
+         container.Add(std::make_shared<XZRect>(data[0], data[1], data[2], data[3], data[4], material));
+         break;
+      case ScenePrimitiveType::YZRect:
+         container.Add(std::make_shared<YZRect>(data[0], data[1], data[2], data[3], data[4], material));
+         break;
+      case ScenePrimitiveType::Box:
+         container.Add(std::make_shared<Box>(Point3(data[0], data[1], data[2]), Point3(data[3], data[4], data[5]), material));
+         break;
+      case ScenePrimitiveType::Instance:
+      {
+         std::shared_ptr<Hittable> instance = m_groups[primitive.Group];
+         if (data[0] != 0.0)
+         {
+            instance = std::make_shared<RotateY>(std::move(instance), data[0]);
+         }
+
+         const Vec3 displacement(data[3], data[4], data[5]);
+         if (displacement.x != 0.0 || displacement.y != 0.0 || displacement.z != 0.0)
+         {
+            instance = std::make_shared<Translate>(std::move(instance), displacement);
+         }
+
+         container.Add(std::move(instance));
+         break;
+      }
+      case ScenePrimitiveType::Medium:
+         container.Add(std::make_shared<ConstantMedium>(m_groups[primitive.Group], data[0], material));
+         break;
+      case ScenePrimitiveType::Volume:
+         // Volumes come through AddVolume, with the path of their grid.
+         break;
+      }
+   }
+
+   bool AddVolume(const ScenePrimitive& volume, std::string_view gridPath) override
+   {
+      DensityGridData grid;
+      if (!ReadVolFile(std::string(gridPath), grid))
+      {
+         return false;
+      }
+
+      const double density = volume.Data[0];
+      const bool bSparse = volume.Data[1] != 0.0;
+      HittableList& container = *m_containers.back();
+      if (bSparse)
+      {
+         container.Add(std::make_shared<GridMedium<SparseGrid>>(grid.Bounds, SparseGrid(grid), density, volume.Material));
+      }
+      else
+      {
+         container.Add(std::make_shared<GridMedium<DenseGrid>>(grid.Bounds, DenseGrid(grid), density, volume.Material));
+      }
+
+      return true;
+   }
+
+   void BeginGroup() override
+   {
+      m_openGroups.push_back(std::make_shared<HittableList>());
+      m_containers.push_back(m_openGroups.back().get());
+   }
+
+   uint32_t EndGroup(bool bBuildBVH) override
+   {
+      std::shared_ptr<HittableList> list = std::move(m_openGroups.back());
+      m_openGroups.pop_back();
+      m_containers.pop_back();
+
+      std::shared_ptr<Hittable> group = list;
+      if (bBuildBVH)
+      {
+         group = BVHCache::Instance().GetOrBuild(*list, 0.0, 1.0);
+      }
+
+      m_groups.push_back(std::move(group));
+      return static_cast<uint32_t>(m_groups.size() - 1);
+   }
+
+private:
+   SceneFileData& m_output;
+   std::vector<std::shared_ptr<Hittable>> m_groups;
+   std::vector<std::shared_ptr<HittableList>> m_openGroups;
+   std::vector<HittableList*> m_containers;
+
+};
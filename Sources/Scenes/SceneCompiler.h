@@ -0,0 +1,264 @@
+#pragma once
+#include <Core/CoreMinimal.h>
+#include <Core/AtomicFile.h>
+#include <Core/DensityGrid.h>
+#include <Core/SAHBVHBuilder.h>
+#include <Scenes/SceneRecords.h>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+
+// Compiles a parsed scene into a binary file which CompiledScene maps back without building anything but the small
+// texture and material tables. Every group gets its own SAH BVH over the records it holds, built when the group
+// ends; the world is built last, as the final group of the file.
+class SceneCompiler : public SceneSink
+{
+public:
+   SceneCompiler()
+   {
+      m_openGroups.emplace_back();
+   }
+
+   void SetBackground(const Color& background) override
+   {
+      m_background = background;
+   }
+
+   void AddCamera(const CameraPreset& camera) override
+   {
+      SceneCamera record;
+      const size_t nameLength = std::min(camera.Name.size(), sizeof(record.Name) - 1);
+      std::memcpy(record.Name, camera.Name.data(), nameLength);
+      record.LookFrom = camera.LookFrom;
+      record.LookAt = camera.LookAt;
+      record.Up = camera.Up;
+      record.VerticalFOV = camera.VerticalFOV;
+      record.Aperture = camera.Aperture;
+      record.FocusDistance = camera.FocusDistance;
+      record.Projection = camera.Projection;
+      m_cameras.push_back(record);
+   }
+
+   uint32_t AddTexture(const SceneTexture& texture, std::string_view imagePath) override
+   {
+      SceneTexture record = texture;
+      if (record.Type == SceneTextureType::Image)
+      {
+         record.PathOffset = static_cast<uint32_t>(m_strings.size());
+         record.PathLength = static_cast<uint32_t>(imagePath.size());
+         m_strings.append(imagePath);
+      }
+
+      m_textures.push_back(record);
+      return static_cast<uint32_t>(m_textures.size() - 1);
+   }
+
+   uint32_t AddMaterial(const SceneMaterial& material) override
+   {
+      m_materials.push_back(material);
+      return static_cast<uint32_t>(m_materials.size() - 1);
+   }
+
+   void AddPrimitive(const ScenePrimitive& primitive) override
+   {
+      // Instances and media of an empty group can never be hit.
+      if ((primitive.Type == ScenePrimitiveType::Instance || primitive.Type == ScenePrimitiveType::Medium) &&
+         m_groups[primitive.Group].NodeCount == 0)
+      {
+         return;
+      }
+
+      m_openGroups.back().push_back(primitive);
+   }
+
+   // Only the header of the grid is read, for its bounds; CompiledScene loads the voxels from the path.
+   bool AddVolume(const ScenePrimitive& volume, std::string_view gridPath) override
+   {
+      DensityGridData grid;
+      if (!ReadVolFile(std::string(gridPath), grid, true))
+      {
+         return false;
+      }
+
+      ScenePrimitive record = volume;
+      record.Group = static_cast<uint32_t>(m_strings.size());
+      record.PathLength = static_cast<uint32_t>(gridPath.size());
+      m_strings.append(gridPath);
+      for (int axis = 0; axis < 3; ++axis)
+      {
+         record.Data[2 + axis] = grid.Bounds.Minimum[axis];
+         record.Data[5 + axis] = grid.Bounds.Maximum[axis];
+      }
+
+      m_openGroups.back().push_back(record);
+      return true;
+   }
+
+   void BeginGroup() override
+   {
+      m_openGroups.emplace_back();
+   }
+
+   uint32_t EndGroup([[maybe_unused]] bool bBuildBVH) override
+   {
+      // Groups of compiled scene are always traversed through their own BVH.
+      std::vector<ScenePrimitive> primitives = std::move(m_openGroups.back());
+      m_openGroups.pop_back();
+
+      std::vector<BVHPrimitiveInfo> infos;
+      infos.reserve(primitives.size());
+      for (size_t idx = 0; idx < primitives.size(); ++idx)
+      {
+         infos.emplace_back(static_cast<uint32_t>(idx), PrimitiveBounds(primitives[idx]));
+      }
+
+      // The builder keeps the tree within BVHBuildConstants::MaxDepth, as CompiledScene::Load requires.
+      FlatBVHData data = SAHBVHBuilder(std::move(infos)).Build();
+
+      SceneGroup group;
+      group.FirstPrimitive = static_cast<uint32_t>(m_primitives.size());
+      group.PrimitiveCount = static_cast<uint32_t>(primitives.size());
+      group.FirstNode = static_cast<uint32_t>(m_nodes.size());
+      group.NodeCount = static_cast<uint32_t>(data.Nodes.size());
+      group.FirstIndex = static_cast<uint32_t>(m_primitiveIndices.size());
+      group.IndexCount = static_cast<uint32_t>(data.PrimitiveIndices.size());
+      m_groupBounds.push_back(data.Nodes.empty() ? AABB::Empty() : data.Nodes[0].Bounds);
+
+      m_primitives.insert(m_primitives.end(), primitives.begin(), primitives.end());
+      m_nodes.insert(m_nodes.end(), data.Nodes.begin(), data.Nodes.end());
+      m_primitiveIndices.insert(m_primitiveIndices.end(), data.PrimitiveIndices.begin(), data.PrimitiveIndices.end());
+      m_groups.push_back(group);
+      return static_cast<uint32_t>(m_groups.size() - 1);
+   }
+
+   // Builds the world out of everything added outside of groups and writes the compiled scene.
+   bool Write(const std::filesystem::path& path)
+   {
+      if (m_openGroups.size() != 1)
+      {
+         std::cerr << "Scene has unterminated groups.\n";
+         return false;
+      }
+
+      const uint32_t worldGroup = EndGroup(true);
+      m_openGroups.emplace_back();
+
+      CompiledSceneHeader header;
+      std::memcpy(header.Magic, CompiledSceneConstants::Magic, sizeof(header.Magic));
+      header.Version = CompiledSceneConstants::Version;
+      header.WorldGroup = worldGroup;
+      header.Background = m_background;
+
+      const std::pair<const void*, size_t> sections[CompiledSceneConstants::SectionCount] = {
+         { m_cameras.data(), sizeof(SceneCamera) },
+         { m_textures.data(), sizeof(SceneTexture) },
+         { m_materials.data(), sizeof(SceneMaterial) },
+         { m_primitives.data(), sizeof(ScenePrimitive) },
+         { m_groups.data(), sizeof(SceneGroup) },
+         { m_nodes.data(), sizeof(FlatBVHNode) },
+         { m_primitiveIndices.data(), sizeof(uint32_t) },
+         { m_strings.data(), sizeof(char) }
+      };
+      const size_t counts[CompiledSceneConstants::SectionCount] = {
+         m_cameras.size(), m_textures.size(), m_materials.size(), m_primitives.size(),
+         m_groups.size(), m_nodes.size(), m_primitiveIndices.size(), m_strings.size()
+      };
+
+      uint64_t offset = sizeof(CompiledSceneHeader);
+      for (size_t idx = 0; idx < CompiledSceneConstants::SectionCount; ++idx)
+      {
+         offset = AlignOffset(offset);
+         header.Sections[idx].Offset = offset;
+         header.Sections[idx].Count = counts[idx];
+         offset += counts[idx] * sections[idx].second;
+      }
+
+      return WriteFileAtomically(path, "compiled scene", [&](std::ofstream& stream)
+         {
+            constexpr char padding[CompiledSceneConstants::SectionAlignment] = {};
+            stream.write(reinterpret_cast<const char*>(&header), sizeof(header));
+            uint64_t written = sizeof(header);
+            for (size_t idx = 0; idx < CompiledSceneConstants::SectionCount; ++idx)
+            {
+               stream.write(padding, header.Sections[idx].Offset - written);
+               stream.write(static_cast<const char*>(sections[idx].first), counts[idx] * sections[idx].second);
+               written = header.Sections[idx].Offset + counts[idx] * sections[idx].second;
+            }
+         });
+   }
+
+private:
+   static uint64_t AlignOffset(uint64_t offset)
+   {
+      constexpr uint64_t alignment = CompiledSceneConstants::SectionAlignment;
+      return (offset + alignment - 1) / alignment * alignment;
+   }
+
+   // Same bounds as the Hittable objects of each record over shutter interval [0, 1].
+   AABB PrimitiveBounds(const ScenePrimitive& primitive) const
+   {
+      constexpr double RectPadding = 0.0001;
+      const double* data = primitive.Data;
+      switch (primitive.Type)
+      {
+      case ScenePrimitiveType::Sphere:
+      {
+         const Vec3 radius(data[3], data[3], data[3]);
+         const Point3 center(data[0], data[1], data[2]);
+         return AABB(center - radius, center + radius);
+      }
+      case ScenePrimitiveType::MovingSphere:
+      {
+         const Vec3 radius(data[8], data[8], data[8]);
+         const Point3 center0(data[0], data[1], data[2]);
+         const Point3 center1(data[3], data[4], data[5]);
+         return AABB::SurroundingBox(AABB(center0 - radius, center0 + radius), AABB(center1 - radius, center1 + radius));
+      }
+      case ScenePrimitiveType::XYRect:
+         return AABB(Point3(data[0], data[2], data[4] - RectPadding), Point3(data[1], data[3], data[4] + RectPadding));
+      case ScenePrimitiveType::XZRect:
+         return AABB(Point3(data[0], data[4] - RectPadding, data[2]), Point3(data[1], data[4] + RectPadding, data[3]));
+      case ScenePrimitiveType::YZRect:
+         return AABB(Point3(data[4] - RectPadding, data[0], data[2]), Point3(data[4] + RectPadding, data[1], data[3]));
+      case ScenePrimitiveType::Box:
+         return AABB(Point3(data[0], data[1], data[2]), Point3(data[3], data[4], data[5]));
+      case ScenePrimitiveType::Instance:
+      {
+         const AABB& groupBounds = m_groupBounds[primitive.Group];
+         const double cosTheta = data[1];
+         const double sinTheta = data[2];
+         const Vec3 translation(data[3], data[4], data[5]);
+         AABB bounds = AABB::Empty();
+         for (int corner = 0; corner < 8; ++corner)
+         {
+            const double x = (corner & 1) ? groupBounds.Maximum.x : groupBounds.Minimum.x;
+            const double y = (corner & 2) ? groupBounds.Maximum.y : groupBounds.Minimum.y;
+            const double z = (corner & 4) ? groupBounds.Maximum.z : groupBounds.Minimum.z;
+            const Point3 rotated(cosTheta * x + sinTheta * z, y, -sinTheta * x + cosTheta * z);
+            bounds = AABB::SurroundingBox(bounds, AABB(rotated + translation, rotated + translation));
+         }
+
+         return bounds;
+      }
+      case ScenePrimitiveType::Volume:
+         return AABB(Point3(data[2], data[3], data[4]), Point3(data[5], data[6], data[7]));
+      case ScenePrimitiveType::Medium:
+      default:
+         return m_groupBounds[primitive.Group];
+      }
+   }
+
+private:
+   Color m_background;
+   std::vector<SceneCamera> m_cameras;
+   std::vector<SceneTexture> m_textures;
+   std::vector<SceneMaterial> m_materials;
+   std::vector<ScenePrimitive> m_primitives;
+   std::vector<SceneGroup> m_groups;
+   std::vector<FlatBVHNode> m_nodes;
+   std::vector<uint32_t> m_primitiveIndices;
+   std::string m_strings;
+   std::vector<AABB> m_groupBounds;
+   std::vector<std::vector<ScenePrimitive>> m_openGroups;
+
+};
@@ -0,0 +1,713 @@
+#pragma once
+#include <Core/CoreMinimal.h>
+#include <Core/MappedFile.h>
+#include <Scenes/HittableSceneBuilder.h>
+#include <Scenes/SceneRecords.h>
+#include <charconv>
+#include <cstring>
+#include <string>
+#include <unordered_map>
+
+// Text scene format. One statement per line, tokens are separated by whitespace and '#' starts a comment.
+//
+//   background r g b
+//   camera <name> lookfrom x y z lookat x y z [up x y z] [fov degrees] [aperture a] [focus distance]
+//          [projection perspective|orthographic|equirectangular]
+//   texture <name> solid r g b | checker <texture> <texture> | image "<path>"
+//   material <name> lambertian <texture> | metal r g b fuzz | dielectric ior | light <texture> | isotropic <texture>
+//   sphere x y z radius <material>
+//   moving_sphere x0 y0 z0 x1 y1 z1 time0 time1 radius <material>
+//   xy_rect x0 x1 y0 y1 k <material>     (also xz_rect, yz_rect)
+//   box x0 y0 z0 x1 y1 z1 <material>
+//   group <name> [bvh] ... end            Defines a reusable group; 'bvh' builds it into a FlatBVH
+//   instance <group> [rotate_y degrees] [translate x y z] ...
+//   medium <group> density <texture>      Constant density medium inside a closed group of any shape
+//   volume "<path>" density <texture> [sparse]
+//                                         Medium of a .vol density grid, scaled by density; 'sparse' stores it in bricks
+//
+// Wherever a <texture> is expected, three numbers may be given instead for a solid color. Textures, materials and
+// groups are shared by name, so a million spheres using one material hold a million references to the same object.
+// Statements outside a group add objects to the world; inside a group they add them to the group. Transforms of an
+// instance are composed into a single rotation followed by a translation.
+//
+// Parsed statements are handed to a SceneSink as records, which either builds Hittable objects right away
+// (HittableSceneBuilder) or compiles the scene into a binary file (SceneCompiler).
+class SceneParser
+{
+public:
+   SceneParser(std::string_view source, std::string sourceName) :
+      m_cursor(source.data()),
+      m_end(source.data() + source.size()),
+      m_sourceName(std::move(sourceName))
+   {
+   }
+
+   static bool LoadFile(const std::filesystem::path& path, SceneSink& sink)
+   {
+      MappedFile file(path);
+      if (!file.IsValid())
+      {
+         std::cerr << "Failed to open scene file '" << path.string() << "'.\n";
+         return false;
+      }
+
+      const std::string_view source(reinterpret_cast<const char*>(file.Data()), file.Size());
+      return SceneParser(source, path.string()).Parse(sink);
+   }
+
+   static bool LoadFile(const std::filesystem::path& path, SceneFileData& output)
+   {
+      HittableSceneBuilder builder(output);
+      return LoadFile(path, builder);
+   }
+
+   bool Parse(SceneSink& sink)
+   {
+      m_openGroups.clear();
+      while (m_cursor < m_end)
+      {
+         ++m_line;
+         m_lineEnd = static_cast<const char*>(std::memchr(m_cursor, '\n', m_end - m_cursor));
+         if (m_lineEnd == nullptr)
+         {
+            m_lineEnd = m_end;
+         }
+
+         std::string_view keyword;
+         if (NextToken(keyword))
+         {
+            if (!ParseStatement(keyword, sink))
+            {
+               return false;
+            }
+
+            std::string_view extra;
+            if (NextToken(extra))
+            {
+               return Error("Unexpected '" + std::string(extra) + "'");
+            }
+         }
+
+         m_cursor = m_lineEnd < m_end ? m_lineEnd + 1 : m_end;
+      }
+
+      if (!m_openGroups.empty())
+      {
+         return Error("Group '" + m_openGroups.back().Name + "' is missing 'end'");
+      }
+
+      return true;
+   }
+
+private:
+   struct StringHash
+   {
+   public:
+      using is_transparent = void;
+      size_t operator()(std::string_view text) const { return std::hash<std::string_view>()(text); }
+
+   };
+
+   using NameMap = std::unordered_map<std::string, uint32_t, StringHash, std::equal_to<>>;
+
+   struct OpenGroup
+   {
+   public:
+      std::string Name;
+      bool bBuildBVH = false;
+
+   };
+
+   bool ParseStatement(std::string_view keyword, SceneSink& sink)
+   {
+      ScenePrimitive primitive;
+      double* data = primitive.Data;
+      if (keyword == "sphere")
+      {
+         primitive.Type = ScenePrimitiveType::Sphere;
+         if (!ReadNumbers(data, 4) || !ReadMaterial(primitive.Material))
+         {
+            return false;
+         }
+      }
+      else if (keyword == "moving_sphere")
+      {
+         primitive.Type = ScenePrimitiveType::MovingSphere;
+         if (!ReadNumbers(data, 9) || !ReadMaterial(primitive.Material))
+         {
+            return false;
+         }
+      }
+      else if (keyword == "xy_rect" || keyword == "xz_rect" || keyword == "yz_rect")
+      {
+         if (keyword == "xy_rect")
+         {
+            primitive.Type = ScenePrimitiveType::XYRect;
+         }
+         else if (keyword == "xz_rect")
+         {
+            primitive.Type = ScenePrimitiveType::XZRect;
+         }
+         else
+         {
+            primitive.Type = ScenePrimitiveType::YZRect;
+         }
+
+         if (!ReadNumbers(data, 5) || !ReadMaterial(primitive.Material))
+         {
+            return false;
+         }
+      }
+      else if (keyword == "box")
+      {
+         primitive.Type = ScenePrimitiveType::Box;
+         if (!ReadNumbers(data, 6) || !ReadMaterial(primitive.Material))
+         {
+            return false;
+         }
+      }
+      else if (keyword == "instance")
+      {
+         primitive.Type = ScenePrimitiveType::Instance;
+         if (!ReadGroup(primitive.Group) || !ParseTransforms(data))
+         {
+            return false;
+         }
+      }
+      else if (keyword == "medium")
+      {
+         SceneMaterial phaseFunction;
+         phaseFunction.Type = SceneMaterialType::Isotropic;
+         primitive.Type = ScenePrimitiveType::Medium;
+         if (!ReadGroup(primitive.Group) || !ReadNumber(data[0]) || !ReadTexture(sink, phaseFunction.Texture))
+         {
+            return false;
+         }
+
+         primitive.Material = sink.AddMaterial(phaseFunction);
+      }
+      else if (keyword == "volume")
+      {
+         SceneMaterial phaseFunction;
+         phaseFunction.Type = SceneMaterialType::Isotropic;
+         primitive.Type = ScenePrimitiveType::Volume;
+         std::string_view path;
+         if (!ReadName(path) || !ReadNumber(data[0]) || !ReadTexture(sink, phaseFunction.Texture))
+         {
+            return false;
+         }
+
+         std::string_view option;
+         if (NextToken(option))
+         {
+            if (option != "sparse")
+            {
+               return Error("Unknown volume option '" + std::string(option) + "'");
+            }
+
+            data[1] = 1.0;
+         }
+
+         primitive.Material = sink.AddMaterial(phaseFunction);
+         if (!sink.AddVolume(primitive, path))
+         {
+            return Error("Failed to load grid '" + std::string(path) + "'");
+         }
+
+         return true;
+      }
+      else if (keyword == "material")
+      {
+         return ParseMaterial(sink);
+      }
+      else if (keyword == "texture")
+      {
+         return ParseTexture(sink);
+      }
+      else if (keyword == "group")
+      {
+         OpenGroup group;
+         std::string_view name;
+         if (!ReadName(name))
+         {
+            return false;
+         }
+
+         std::string_view option;
+         if (NextToken(option))
+         {
+            if (option != "bvh")
+            {
+               return Error("Unknown group option '" + std::string(option) + "'");
+            }
+
+            group.bBuildBVH = true;
+         }
+
+         group.Name = name;
+         m_openGroups.push_back(std::move(group));
+         sink.BeginGroup();
+         return true;
+      }
+      else if (keyword == "end")
+      {
+         if (m_openGroups.empty())
+         {
+            return Error("'end' without 'group'");
+         }
+
+         OpenGroup group = std::move(m_openGroups.back());
+         m_openGroups.pop_back();
+         m_groups[group.Name] = sink.EndGroup(group.bBuildBVH);
+         return true;
+      }
+      else if (keyword == "camera")
+      {
+         return ParseCamera(sink);
+      }
+      else if (keyword == "background")
+      {
+         Color background;
+         if (!ReadVec3(background))
+         {
+            return false;
+         }
+
+         sink.SetBackground(background);
+         return true;
+      }
+      else
+      {
+         return Error("Unknown statement '" + std::string(keyword) + "'");
+      }
+
+      sink.AddPrimitive(primitive);
+      return true;
+   }
+
+   bool ParseTexture(SceneSink& sink)
+   {
+      std::string_view name, type;
+      if (!ReadName(name) || !ReadName(type))
+      {
+         return false;
+      }
+
+      SceneTexture texture;
+      std::string_view path;
+      if (type == "solid")
+      {
+         texture.Type = SceneTextureType::Solid;
+         if (!ReadVec3(texture.Albedo))
+         {
+            return false;
+         }
+      }
+      else if (type == "checker")
+      {
+         texture.Type = SceneTextureType::Checker;
+         if (!ReadTexture(sink, texture.Even) || !ReadTexture(sink, texture.Odd))
+         {
+            return false;
+         }
+      }
+      else if (type == "image")
+      {
+         texture.Type = SceneTextureType::Image;
+         if (!ReadName(path))
+         {
+            return false;
+         }
+      }
+      else
+      {
+         return Error("Unknown texture type '" + std::string(type) + "'");
+      }
+
+      m_textures[std::string(name)] = sink.AddTexture(texture, path);
+      return true;
+   }
+
+   bool ParseMaterial(SceneSink& sink)
+   {
+      std::string_view name, type;
+      if (!ReadName(name) || !ReadName(type))
+      {
+         return false;
+      }
+
+      SceneMaterial material;
+      if (type == "lambertian" || type == "light" || type == "isotropic")
+      {
+         if (type == "lambertian")
+         {
+            material.Type = SceneMaterialType::Lambertian;
+         }
+         else if (type == "light")
+         {
+            material.Type = SceneMaterialType::DiffuseLight;
+         }
+         else
+         {
+            material.Type = SceneMaterialType::Isotropic;
+         }
+
+         if (!ReadTexture(sink, material.Texture))
+         {
+            return false;
+         }
+      }
+      else if (type == "metal")
+      {
+         material.Type = SceneMaterialType::Metal;
+         if (!ReadVec3(material.Albedo) || !ReadNumber(material.Parameter))
+         {
+            return false;
+         }
+      }
+      else if (type == "dielectric")
+      {
+         material.Type = SceneMaterialType::Dielectric;
+         if (!ReadNumber(material.Parameter))
+         {
+            return false;
+         }
+      }
+      else
+      {
+         return Error("Unknown material type '" + std::string(type) + "'");
+      }
+
+      m_materials[std::string(name)] = sink.AddMaterial(material);
+      m_bHasLastMaterial = false;
+      return true;
+   }
+
+   // Composes transforms of an instance into rotation around y followed by translation.
+   bool ParseTransforms(double* data)
+   {
+      double degrees = 0.0;
+      Vec3 translation;
+      std::string_view transform;
+      while (NextToken(transform))
+      {
+         if (transform == "rotate_y")
+         {
+            double angle = 0.0;
+            if (!ReadNumber(angle))
+            {
+               return false;
+            }
+
+            // Rotating an already translated instance rotates its translation as well.
+            const double radians = DegreesToRadians(angle);
+            const double cosTheta = std::cos(radians);
+            const double sinTheta = std::sin(radians);
+            translation = Vec3(cosTheta * translation.x + sinTheta * translation.z, translation.y, -sinTheta * translation.x + cosTheta * translation.z);
+            degrees += angle;
+         }
+         else if (transform == "translate")
+         {
+            Vec3 displacement;
+            if (!ReadVec3(displacement))
+            {
+               return false;
+            }
+
+            translation += displacement;
+         }
+         else
+         {
+            return Error("Unknown transform '" + std::string(transform) + "'");
+         }
+      }
+
+      const double radians = DegreesToRadians(degrees);
+      data[0] = degrees;
+      data[1] = std::cos(radians);
+      data[2] = std::sin(radians);
+      data[3] = translation.x;
+      data[4] = translation.y;
+      data[5] = translation.z;
+      return true;
+   }
+
+   bool ParseCamera(SceneSink& sink)
+   {
+      std::string_view name;
+      if (!ReadName(name))
+      {
+         return false;
+      }
+
+      CameraPreset camera;
+      camera.Name = name;
+      bool bHasLookFrom = false;
+      bool bHasLookAt = false;
+      std::string_view property;
+      while (NextToken(property))
+      {
+         bool bValid = true;
+         if (property == "lookfrom")
+         {
+            bValid = ReadVec3(camera.LookFrom);
+            bHasLookFrom = true;
+         }
+         else if (property == "lookat")
+         {
+            bValid = ReadVec3(camera.LookAt);
+            bHasLookAt = true;
+         }
+         else if (property == "up")
+         {
+            bValid = ReadVec3(camera.Up);
+         }
+         else if (property == "fov")
+         {
+            bValid = ReadNumber(camera.VerticalFOV);
+         }
+         else if (property == "aperture")
+         {
+            bValid = ReadNumber(camera.Aperture);
+         }
+         else if (property == "focus")
+         {
+            bValid = ReadNumber(camera.FocusDistance);
+         }
+         else if (property == "projection")
+         {
+            bValid = ReadProjection(camera.Projection);
+         }
+         else
+         {
+            return Error("Unknown camera property '" + std::string(property) + "'");
+         }
+
+         if (!bValid)
+         {
+            return false;
+         }
+      }
+
+      if (!bHasLookFrom || !bHasLookAt)
+      {
+         return Error("Camera needs both 'lookfrom' and 'lookat'");
+      }
+
+      sink.AddCamera(camera);
+      return true;
+   }
+
+   // Reads next token of current line. Quoted tokens may contain whitespace.
+   bool NextToken(std::string_view& token)
+   {
+      while (m_cursor < m_lineEnd && (*m_cursor == ' ' || *m_cursor == '\t' || *m_cursor == '\r'))
+      {
+         ++m_cursor;
+      }
+
+      if (m_cursor >= m_lineEnd || *m_cursor == '#')
+      {
+         m_cursor = m_lineEnd;
+         return false;
+      }
+
+      if (*m_cursor == '"')
+      {
+         const char* begin = ++m_cursor;
+         while (m_cursor < m_lineEnd && *m_cursor != '"')
+         {
+            ++m_cursor;
+         }
+
+         token = std::string_view(begin, m_cursor - begin);
+         m_cursor = m_cursor < m_lineEnd ? m_cursor + 1 : m_lineEnd;
+         return true;
+      }
+
+      const char* begin = m_cursor;
+      while (m_cursor < m_lineEnd && *m_cursor != ' ' && *m_cursor != '\t' && *m_cursor != '\r')
+      {
+         ++m_cursor;
+      }
+
+      token = std::string_view(begin, m_cursor - begin);
+      return true;
+   }
+
+   bool ReadName(std::string_view& name)
+   {
+      if (!NextToken(name))
+      {
+         return Error("Unexpected end of line");
+      }
+
+      return true;
+   }
+
+   bool ReadNumber(double& value)
+   {
+      std::string_view token;
+      if (!ReadName(token))
+      {
+         return false;
+      }
+
+      if (!ParseDouble(token, value))
+      {
+         return Error("Expected number but found '" + std::string(token) + "'");
+      }
+
+      return true;
+   }
+
+   bool ReadVec3(Vec3& value)
+   {
+      return ReadNumbers(value.e, 3);
+   }
+
+   bool ReadNumbers(double* values, size_t count)
+   {
+      for (size_t idx = 0; idx < count; ++idx)
+      {
+         if (!ReadNumber(values[idx]))
+         {
+            return false;
+         }
+      }
+
+      return true;
+   }
+
+   bool ReadProjection(CameraProjection& projection)
+   {
+      std::string_view token;
+      if (!ReadName(token))
+      {
+         return false;
+      }
+
+      if (token == "perspective")
+      {
+         projection = CameraProjection::Perspective;
+      }
+      else if (token == "orthographic")
+      {
+         projection = CameraProjection::Orthographic;
+      }
+      else if (token == "equirectangular")
+      {
+         projection = CameraProjection::Equirectangular;
+      }
+      else
+      {
+         return Error("Unknown camera projection '" + std::string(token) + "'");
+      }
+
+      return true;
+   }
+
+   // Either name of a texture or three numbers of a solid color.
+   bool ReadTexture(SceneSink& sink, uint32_t& texture)
+   {
+      std::string_view token;
+      if (!ReadName(token))
+      {
+         return false;
+      }
+
+      SceneTexture solid;
+      if (ParseDouble(token, solid.Albedo.e[0]))
+      {
+         if (!ReadNumber(solid.Albedo.e[1]) || !ReadNumber(solid.Albedo.e[2]))
+         {
+            return false;
+         }
+
+         texture = sink.AddTexture(solid, std::string_view());
+         return true;
+      }
+
+      return Find(m_textures, token, "texture", texture);
+   }
+
+   bool ReadMaterial(uint32_t& material)
+   {
+      std::string_view name;
+      if (!ReadName(name))
+      {
+         return false;
+      }
+
+      // Large scenes tend to use the same material over and over.
+      if (m_bHasLastMaterial && name == m_lastMaterialName)
+      {
+         material = m_lastMaterial;
+         return true;
+      }
+
+      if (!Find(m_materials, name, "material", material))
+      {
+         return false;
+      }
+
+      m_lastMaterialName = name;
+      m_lastMaterial = material;
+      m_bHasLastMaterial = true;
+      return true;
+   }
+
+   bool ReadGroup(uint32_t& group)
+   {
+      std::string_view name;
+      return ReadName(name) && Find(m_groups, name, "group", group);
+   }
+
+   bool Find(const NameMap& map, std::string_view name, const char* kind, uint32_t& output)
+   {
+      auto found = map.find(name);
+      if (found == map.end())
+      {
+         return Error("Unknown " + std::string(kind) + " '" + std::string(name) + "'");
+      }
+
+      output = found->second;
+      return true;
+   }
+
+   static bool ParseDouble(std::string_view token, double& value)
+   {
+      const char* begin = token.data();
+      const char* end = token.data() + token.size();
+      if (begin != end && *begin == '+')
+      {
+         ++begin;
+      }
+
+      auto result = std::from_chars(begin, end, value);
+      return result.ec == std::errc() && result.ptr == end;
+   }
+
+   bool Error(const std::string& message) const
+   {
+      std::cerr << m_sourceName << '(' << m_line << "): " << message << ".\n";
+      return false;
+   }
+
+private:
+   const char* m_cursor = nullptr;
+   const char* m_lineEnd = nullptr;
+   const char* m_end = nullptr;
+   size_t m_line = 0;
+   std::string m_sourceName;
+
+   NameMap m_textures;
+   NameMap m_materials;
+   NameMap m_groups;
+   std::string m_lastMaterialName;
+   uint32_t m_lastMaterial = 0;
+   bool m_bHasLastMaterial = false;
+
+   std::vector<OpenGroup> m_openGroups;
+
+};
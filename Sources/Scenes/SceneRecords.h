@@ -0,0 +1,177 @@
+#pragma once
+#include <Core/CoreMinimal.h>
+#include <Core/Color.h>
+#include <Scenes/Scenes.h>
+#include <type_traits>
+
+// Plain records of resolved scene content. The parser describes scenes with them, and compiled scenes store them
+// as they are. Every reference is an index, so records can be written to disk and mapped back at any address.
+enum class SceneTextureType : uint32_t
+{
+   Solid = 0,
+   Checker,
+   Image
+};
+
+struct SceneTexture
+{
+public:
+   SceneTextureType Type = SceneTextureType::Solid;
+   uint32_t Even = 0; // Checker: texture indices
+   uint32_t Odd = 0;
+   uint32_t PathOffset = 0; // Image: path in string table of compiled scene
+   uint32_t PathLength = 0;
+   uint32_t Padding = 0;
+   Color Albedo; // Solid
+
+};
+
+enum class SceneMaterialType : uint32_t
+{
+   Lambertian = 0,
+   Metal,
+   Dielectric,
+   DiffuseLight,
+   Isotropic
+};
+
+struct SceneMaterial
+{
+public:
+   SceneMaterialType Type = SceneMaterialType::Lambertian;
+   uint32_t Texture = 0; // Lambertian, DiffuseLight, Isotropic
+   Color Albedo; // Metal
+   double Parameter = 0.0; // Metal: fuzz, Dielectric: index of refraction
+
+};
+
+enum class ScenePrimitiveType : uint32_t
+{
+   Sphere = 0,
+   MovingSphere,
+   XYRect,
+   XZRect,
+   YZRect,
+   Box,
+   Instance,
+   Medium,
+   Volume
+};
+
+namespace ScenePrimitiveConstants
+{
+   constexpr size_t DataCount = 9;
+}
+
+// Data layout by type:
+//   Sphere       : center xyz, radius
+//   MovingSphere : center0 xyz, center1 xyz, time0, time1, radius
+//   Rects        : a0, a1, b0, b1, k (a, b are the two axes in type name)
+//   Box          : min xyz, max xyz
+//   Instance     : rotation around y in degrees, cos, sin, translation xyz (rotated first, then translated)
+//   Medium       : density
+//   Volume       : density scale, 1 for a sparse grid, then bounds min xyz, max xyz of the grid once compiled
+struct ScenePrimitive
+{
+public:
+   ScenePrimitiveType Type = ScenePrimitiveType::Sphere;
+   uint32_t Material = 0; // Medium, Volume: material of its phase function
+   uint32_t Group = 0; // Instance, Medium: referenced group. Volume: path of its grid in string table of compiled scene
+   uint32_t PathLength = 0; // Volume
+   double Data[ScenePrimitiveConstants::DataCount] = {};
+
+};
+
+// Camera as stored in compiled scene. Name is null terminated.
+struct SceneCamera
+{
+public:
+   char Name[32] = {};
+   Point3 LookFrom;
+   Point3 LookAt;
+   Vec3 Up;
+   double VerticalFOV = 40.0;
+   double Aperture = 0.0;
+   double FocusDistance = 10.0;
+   CameraProjection Projection = CameraProjection::Perspective;
+
+};
+
+// Range of primitives of a group together with its own BVH. Node offsets and primitive indices are relative to
+// the first node and first primitive of the group.
+struct SceneGroup
+{
+public:
+   uint32_t FirstPrimitive = 0;
+   uint32_t PrimitiveCount = 0;
+   uint32_t FirstNode = 0;
+   uint32_t NodeCount = 0;
+   uint32_t FirstIndex = 0;
+   uint32_t IndexCount = 0;
+
+};
+
+enum class CompiledSceneSection : uint32_t
+{
+   Cameras = 0,
+   Textures,
+   Materials,
+   Primitives,
+   Groups,
+   Nodes,
+   PrimitiveIndices,
+   Strings,
+   Count
+};
+
+namespace CompiledSceneConstants
+{
+   constexpr char Magic[8] = { 'R', 'T', 'S', 'C', 'E', 'N', 'E', '\0' };
+   constexpr uint32_t Version = 3;
+   constexpr size_t SectionCount = static_cast<size_t>(CompiledSceneSection::Count);
+   constexpr size_t SectionAlignment = 16;
+}
+
+struct CompiledSceneSectionRange
+{
+public:
+   uint64_t Offset = 0; // In bytes from start of file
+   uint64_t Count = 0; // In elements
+
+};
+
+struct CompiledSceneHeader
+{
+public:
+   char Magic[8] = {};
+   uint32_t Version = 0;
+   uint32_t WorldGroup = 0;
+   Color Background;
+   CompiledSceneSectionRange Sections[CompiledSceneConstants::SectionCount];
+
+};
+
+static_assert(std::is_trivially_copyable_v<SceneTexture>, "Scene records must be serializable as raw bytes.");
+static_assert(std::is_trivially_copyable_v<SceneMaterial>, "Scene records must be serializable as raw bytes.");
+static_assert(std::is_trivially_copyable_v<ScenePrimitive>, "Scene records must be serializable as raw bytes.");
+static_assert(std::is_trivially_copyable_v<SceneCamera>, "Scene records must be serializable as raw bytes.");
+static_assert(std::is_trivially_copyable_v<SceneGroup>, "Scene records must be serializable as raw bytes.");
+static_assert(std::is_trivially_copyable_v<CompiledSceneHeader>, "Scene records must be serializable as raw bytes.");
+
+// Receives a scene from SceneParser. Indices returned by the Add/End methods are what later records refer to.
+// Primitives go to the innermost open group, or to the world when no group is open.
+class SceneSink
+{
+public:
+   virtual ~SceneSink() = default;
+
+   virtual void SetBackground(const Color& background) = 0;
+   virtual void AddCamera(const CameraPreset& camera) = 0;
+   virtual uint32_t AddTexture(const SceneTexture& texture, std::string_view imagePath) = 0;
+   virtual uint32_t AddMaterial(const SceneMaterial& material) = 0;
+   virtual void AddPrimitive(const ScenePrimitive& primitive) = 0;
+   virtual bool AddVolume(const ScenePrimitive& volume, std::string_view gridPath) = 0; // False when the grid can't be read
+   virtual void BeginGroup() = 0;
+   virtual uint32_t EndGroup(bool bBuildBVH) = 0;
+
+};
@@ -0,0 +1,524 @@
+#pragma once
+#include <Core/CoreMinimal.h>
+#include <Core/Color.h>
+#include <Core/Sphere.h>
+#include <Core/HittableList.h>
+#include <Core/Camera.h>
+#include <Core/MaterialTable.h>
+#include <Core/MovingSphere.h>
+#include <Core/Rect.h>
+#include <Core/Box.h>
+#include <Core/Instance.h>
+#include <Core/ConstantMedium.h>
+#include <Core/GridMedium.h>
+#include <Core/BVHCache.h>
+#include <Math/Vec3.h>
+#include <functional>
+#include <string>
+#include <string_view>
+
+inline std::unique_ptr<HittableList> RandomScene(MaterialTable& materials, double shutterOpen = 0.0, double shutterClose = 1.0)
+{
+   auto world = std::make_unique<HittableList>();
+   auto groundMaterial = materials.AddLambertian(Color(0.5, 0.5, 0.5));
+   auto checkerTexture = materials.AddCheckerTexture(Color(0.2, 0.3, 0.1), Color(0.9, 0.9, 0.9));
+   auto checkerMat = materials.AddLambertian(checkerTexture);
+   world->Add(std::make_shared<Sphere>(Point3(0.0, -1000.0, 0.0), 1000.0, checkerMat));
+   for (int dy = -11; dy < 11; ++dy)
+   {
+      for (int dx = -11; dx < 11; ++dx)
+      {
+         auto chooseMat = RandomDouble();
+         Point3 center(static_cast<double>(dx) + 0.9 + RandomDouble(), 0.2, static_cast<double>(dy) + 0.9 * RandomDouble());
+         auto randRad = RandomDouble(0.2f, 0.25f);
+         if ((center - Vec3(4.0, 0.2, 0.0)).Length() > 0.9)
+         {
+            uint32_t sphereMat = 0;
+            if (chooseMat < 0.8)
+            {
+               // Diffuse
+               auto albedo = Color::Random() * Color::Random();
+               sphereMat = materials.AddLambertian(albedo);
+               auto center1 = center + Vec3(0.0, RandomDouble(0.0, 0.5), 0.0); // yÃÃ ÃÂ¸Â·Ã Â¿Ã²ÃÃ·ÃÃ
+               world->Add(std::make_shared<MovingSphere>(center, center1, shutterOpen, shutterClose, randRad, sphereMat));
+            }
+            else if (chooseMat < 0.95)
+            {
+               // Metal
+               auto albedo = Color::Random(0.5, 1.0);
+               auto fuzz = RandomDouble(0.0, 0.5);
+               auto center1 = center + Vec3(RandomDouble(0.0, 0.5), 0.0, 0.0); // xÃÃ ÃÂ¸Â·Ã Â¿Ã²ÃÃ·ÃÃ
+               sphereMat = materials.AddMetal(albedo, fuzz);
+               world->Add(std::make_shared<MovingSphere>(center, center1, shutterOpen, shutterClose, randRad, sphereMat));
+            }
+            else
+            {
+               // Glass
+               sphereMat = materials.AddDielectric(1.5);
+               world->Add(std::make_shared<Sphere>(center, randRad, sphereMat));
+            }
+         }
+      }
+   }
+
+   auto dielectricMat = materials.AddDielectric(1.5);
+   auto lambertianMat = materials.AddLambertian(Color(0.4, 0.2, 0.1));
+   auto metalMat = materials.AddMetal(Color(0.7, 0.6, 0.5), 0.0);
+
+   world->Add(std::make_shared<Sphere>(Point3(0.0, 1.0, 0.0), 1.0, dielectricMat));
+   world->Add(std::make_shared<Sphere>(Point3(-4.0, 1.0, 0.0), 1.0, lambertianMat));
+   world->Add(std::make_shared<Sphere>(Point3(4.0, 1.0, 0.0), 1.0, metalMat));
+
+   return std::move(world);
+}
+
+inline std::unique_ptr<HittableList> TwoSpheres(MaterialTable& materials)
+{
+   auto world = std::make_unique<HittableList>();
+
+   auto checkerTexture = materials.AddCheckerTexture(Color(0.2, 0.3, 0.1), Color(0.9, 0.9, 0.9));
+   auto checkerMat = materials.AddLambertian(checkerTexture);
+
+   world->Add(std::make_shared<Sphere>(Point3(0.0, -10.0, 0.0), 10.0, checkerMat));
+   world->Add(std::make_shared<Sphere>(Point3(0.0, 10.0, 0.0), 10.0, checkerMat));
+
+   return std::move(world);
+}
+
+inline std::unique_ptr<HittableList> Earth(MaterialTable& materials)
+{
+   auto world = std::make_unique<HittableList>();
+
+   auto earthTexture = materials.AddImageTexture("Resources/Textures/earthmap.jpg");
+   auto earthMat = materials.AddLambertian(earthTexture);
+
+   world->Add(std::make_shared<Sphere>(Point3(0.0, 0.0, 0.0), 2.0, earthMat));
+
+   return std::move(world);
+}
+
+inline std::unique_ptr<HittableList> SimpleLight(MaterialTable& materials)
+{
+   auto world = std::make_unique<HittableList>();
+
+   auto whiteTexture = materials.AddSolidTexture(Color(1.0, 1.0, 1.0));
+   auto earthTexture = materials.AddImageTexture("Resources/Textures/earthmap.jpg");
+
+   auto whiteLambertMat = materials.AddLambertian(whiteTexture);
+   auto earthLambertMat = materials.AddLambertian(earthTexture);
+
+   world->Add(std::make_shared<Sphere>(Point3(0.0, -1000.0, 0.0), 1000.0, whiteLambertMat));
+   world->Add(std::make_shared<Sphere>(Point3(0.0, 2.0, 0.0), 2.0, earthLambertMat));
+
+   auto diffuseLightColor = materials.AddSolidTexture(Color(4.0, 4.0, 4.0));
+   auto diffuseLight = materials.AddDiffuseLight(diffuseLightColor);
+   world->Add(std::make_shared<Sphere>(Point3(0.0, 6.0, 0.0), 2.0, diffuseLight));
+   world->Add(std::make_shared<XYRect>(3.0, 5.0, 1.0, 3.0, -2.0, diffuseLight));
+
+   return std::move(world);
+}
+
+inline std::unique_ptr<HittableList> CornellBox(MaterialTable& materials)
+{
+   auto world = std::make_unique<HittableList>();
+
+   auto redMat = materials.AddLambertian(Color(0.65, 0.05, 0.05));
+   auto whiteMat = materials.AddLambertian(Color(0.73, 0.73, 0.73));
+   auto greenMat = materials.AddLambertian(Color(0.12, 0.45, 0.15));
+   auto lightMat = materials.AddDiffuseLight(Color(15.0, 15.0, 15.0));
+
+   world->Add(std::make_shared<YZRect>(0.0, 555.0, 0.0, 555.0, 555.0, greenMat));
+   world->Add(std::make_shared<YZRect>(0.0, 555.0, 0.0, 555.0, 0.0, redMat));
+   world->Add(std::make_shared<XZRect>(213.0, 343.0, 227.0, 332.0, 554.0, lightMat));
+   world->Add(std::make_shared<XZRect>(0.0, 555.0, 0.0, 555.0, 0.0, whiteMat));
+   world->Add(std::make_shared<XZRect>(0.0, 555.0, 0.0, 555.0, 555.0, whiteMat));
+   world->Add(std::make_shared<XYRect>(0.0, 555.0, 0.0, 555.0, 555.0, whiteMat));
+
+   std::shared_ptr<Hittable> box0 = std::make_shared<Box>(Point3(0.0, 0.0, 0.0), Point3(165.0, 330.0, 165.0), whiteMat);
+   box0 = std::make_shared<RotateY>(box0, 15.0);
+   box0 = std::make_shared<Translate>(box0, Vec3(265.0, 0.0, 295.0));
+   world->Add(box0);
+
+   std::shared_ptr<Hittable> box1 = std::make_shared<Box>(Point3(0.0, 0.0, 0.0), Point3(165.0, 165.0, 165.0), whiteMat);
+   box1 = std::make_shared<RotateY>(box1, -18.0);
+   box1 = std::make_shared<Translate>(box1, Vec3(130.0, 0.0, 65.0));
+   world->Add(box1);
+
+   return std::move(world);
+}
+
+inline std::unique_ptr<HittableList> CornellBoxSmoke(MaterialTable& materials)
+{
+   auto world = std::make_unique<HittableList>();
+
+   auto redMat = materials.AddLambertian(Color(0.65, 0.05, 0.05));
+   auto whiteMat = materials.AddLambertian(Color(0.73, 0.73, 0.73));
+   auto greenMat = materials.AddLambertian(Color(0.12, 0.45, 0.15));
+   auto lightMat = materials.AddDiffuseLight(Color(15.0, 15.0, 15.0));
+
+   world->Add(std::make_shared<YZRect>(0.0, 555.0, 0.0, 555.0, 555.0, greenMat));
+   world->Add(std::make_shared<YZRect>(0.0, 555.0, 0.0, 555.0, 0.0, redMat));
+   world->Add(std::make_shared<XZRect>(113.0, 443.0, 127.0, 432.0, 553.9, lightMat));
+   world->Add(std::make_shared<XZRect>(0.0, 555.0, 0.0, 555.0, 0.0, whiteMat));
+   world->Add(std::make_shared<XZRect>(0.0, 555.0, 0.0, 555.0, 555.0, whiteMat));
+   world->Add(std::make_shared<XYRect>(0.0, 555.0, 0.0, 555.0, 555.0, whiteMat));
+
+   std::shared_ptr<Hittable> box0 = std::make_shared<Box>(Point3(0.0, 0.0, 0.0), Point3(165.0, 330.0, 165.0), whiteMat);
+   box0 = std::make_shared<RotateY>(box0, 15.0);
+   box0 = std::make_shared<Translate>(box0, Vec3(265.0, 0.0, 295.0));
+   world->Add(std::make_shared<ConstantMedium>(box0, 0.01, materials.AddIsotropic(Color())));
+
+   std::shared_ptr<Hittable> box1 = std::make_shared<Box>(Point3(0.0, 0.0, 0.0), Point3(165.0, 165.0, 165.0), whiteMat);
+   box1 = std::make_shared<RotateY>(box1, -18.0);
+   box1 = std::make_shared<Translate>(box1, Vec3(130.0, 0.0, 65.0));
+   world->Add(std::make_shared<ConstantMedium>(box1, 0.01, materials.AddIsotropic(Color(1.0, 1.0, 1.0))));
+
+   return std::move(world);
+}
+
+// Walls and light of CornellBoxSmoke, for the scenes of media with boundaries of more than one piece.
+inline void AddCornellWalls(HittableList& world, MaterialTable& materials)
+{
+   auto redMat = materials.AddLambertian(Color(0.65, 0.05, 0.05));
+   auto whiteMat = materials.AddLambertian(Color(0.73, 0.73, 0.73));
+   auto greenMat = materials.AddLambertian(Color(0.12, 0.45, 0.15));
+   auto lightMat = materials.AddDiffuseLight(Color(15.0, 15.0, 15.0));
+
+   world.Add(std::make_shared<YZRect>(0.0, 555.0, 0.0, 555.0, 555.0, greenMat));
+   world.Add(std::make_shared<YZRect>(0.0, 555.0, 0.0, 555.0, 0.0, redMat));
+   world.Add(std::make_shared<XZRect>(113.0, 443.0, 127.0, 432.0, 553.9, lightMat));
+   world.Add(std::make_shared<XZRect>(0.0, 555.0, 0.0, 555.0, 0.0, whiteMat));
+   world.Add(std::make_shared<XZRect>(0.0, 555.0, 0.0, 555.0, 555.0, whiteMat));
+   world.Add(std::make_shared<XYRect>(0.0, 555.0, 0.0, 555.0, 555.0, whiteMat));
+}
+
+// Fog filling two overlapping spheres as one medium, which must be as dense where they overlap as elsewhere.
+inline std::unique_ptr<HittableList> CornellBoxOverlappingFog(MaterialTable& materials)
+{
+   auto world = std::make_unique<HittableList>();
+   AddCornellWalls(*world, materials);
+
+   auto boundary = std::make_shared<HittableList>();
+   boundary->Add(std::make_shared<Sphere>(Point3(200.0, 180.0, 278.0), 130.0, 0));
+   boundary->Add(std::make_shared<Sphere>(Point3(355.0, 180.0, 278.0), 130.0, 0));
+   world->Add(std::make_shared<ConstantMedium>(boundary, 0.01, materials.AddIsotropic(Color(0.9, 0.9, 0.9))));
+
+   return std::move(world);
+}
+
+// Fog filling two boxes that share a side as one medium, turned so that rays cross from one box into the other.
+inline std::unique_ptr<HittableList> CornellBoxTouchingFog(MaterialTable& materials)
+{
+   auto world = std::make_unique<HittableList>();
+   AddCornellWalls(*world, materials);
+
+   auto boxes = std::make_shared<HittableList>();
+   boxes->Add(std::make_shared<Box>(Point3(0.0, 0.0, 0.0), Point3(150.0, 250.0, 150.0), 0));
+   boxes->Add(std::make_shared<Box>(Point3(150.0, 0.0, 0.0), Point3(300.0, 250.0, 150.0), 0));
+   std::shared_ptr<Hittable> boundary = std::make_shared<RotateY>(boxes, 30.0);
+   boundary = std::make_shared<Translate>(boundary, Vec3(130.0, 0.0, 250.0));
+   world->Add(std::make_shared<ConstantMedium>(boundary, 0.01, materials.AddIsotropic(Color(0.9, 0.9, 0.9))));
+
+   return std::move(world);
+}
+
+// Cumulus-like cloud over a grid of resolution^3 voxels: a few overlapping balls, eroded at their edges by four octaves
+// of value noise. Four in five voxels are empty.
+inline DensityGridData CloudGrid(int resolution, const AABB& bounds)
+{
+   auto lattice = [](int x, int y, int z)
+   {
+      const uint64_t key = (static_cast<uint64_t>(static_cast<uint32_t>(x)) << 42) ^ (static_cast<uint64_t>(static_cast<uint32_t>(y)) << 21) ^
+         static_cast<uint32_t>(z);
+      return (MixBits(key) >> 11) * 0x1p-53;
+   };
+
+   auto noise = [lattice](const Point3& p)
+   {
+      int cell[3];
+      double weights[3];
+      for (int axis = 0; axis < 3; ++axis)
+      {
+         const double floorP = std::floor(p[axis]);
+         const double t = p[axis] - floorP;
+         cell[axis] = static_cast<int>(floorP);
+         weights[axis] = t * t * (3.0 - 2.0 * t);
+      }
+
+      double value = 0.0;
+      for (int corner = 0; corner < 8; ++corner)
+      {
+         const int dx = corner & 1;
+         const int dy = (corner >> 1) & 1;
+         const int dz = corner >> 2;
+         const double weight = (dx ? weights[0] : 1.0 - weights[0]) * (dy ? weights[1] : 1.0 - weights[1]) * (dz ? weights[2] : 1.0 - weights[2]);
+         value += weight * lattice(cell[0] + dx, cell[1] + dy, cell[2] + dz);
+      }
+
+      return value;
+   };
+
+   struct Ball
+   {
+   public:
+      Point3 Center;
+      double Radius;
+
+   };
+
+   const Ball balls[] = {
+      { Point3(0.5, 0.42, 0.5), 0.36 },
+      { Point3(0.25, 0.36, 0.45), 0.24 },
+      { Point3(0.74, 0.38, 0.55), 0.24 },
+      { Point3(0.46, 0.64, 0.5), 0.26 }
+   };
+
+   DensityGridData grid;
+   grid.Resolution[0] = grid.Resolution[1] = grid.Resolution[2] = resolution;
+   grid.Bounds = bounds;
+   grid.Densities.resize(grid.VoxelCount());
+   for (int z = 0; z < resolution; ++z)
+   {
+      for (int y = 0; y < resolution; ++y)
+      {
+         for (int x = 0; x < resolution; ++x)
+         {
+            const Point3 p = (Point3(x, y, z) + Vec3(0.5, 0.5, 0.5)) / resolution;
+            double shape = 0.0;
+            for (const Ball& ball : balls)
+            {
+               shape = std::max(shape, 1.0 - (p - ball.Center).Length() / ball.Radius);
+            }
+
+            double fbm = 0.0;
+            for (int octave = 0; octave < 4; ++octave)
+            {
+               const double frequency = 4.0 * (1 << octave);
+               fbm += noise(p * frequency) / (1 << octave);
+            }
+
+            const double density = shape > 0.0 ? 2.0 * shape + 0.8 * (fbm - 1.25) : 0.0;
+            grid.Densities[(static_cast<size_t>(z) * resolution + y) * resolution + x] = static_cast<float>(std::clamp(density, 0.0, 1.0));
+         }
+      }
+   }
+
+   return grid;
+}
+
+inline std::unique_ptr<HittableList> CornellBoxCloud(MaterialTable& materials)
+{
+   auto world = std::make_unique<HittableList>();
+
+   auto redMat = materials.AddLambertian(Color(0.65, 0.05, 0.05));
+   auto whiteMat = materials.AddLambertian(Color(0.73, 0.73, 0.73));
+   auto greenMat = materials.AddLambertian(Color(0.12, 0.45, 0.15));
+   auto lightMat = materials.AddDiffuseLight(Color(15.0, 15.0, 15.0));
+
+   world->Add(std::make_shared<YZRect>(0.0, 555.0, 0.0, 555.0, 555.0, greenMat));
+   world->Add(std::make_shared<YZRect>(0.0, 555.0, 0.0, 555.0, 0.0, redMat));
+   world->Add(std::make_shared<XZRect>(113.0, 443.0, 127.0, 432.0, 554.0, lightMat));
+   world->Add(std::make_shared<XZRect>(0.0, 555.0, 0.0, 555.0, 0.0, whiteMat));
+   world->Add(std::make_shared<XZRect>(0.0, 555.0, 0.0, 555.0, 555.0, whiteMat));
+   world->Add(std::make_shared<XYRect>(0.0, 555.0, 0.0, 555.0, 555.0, whiteMat));
+
+   const DensityGridData cloud = CloudGrid(64, AABB(Point3(40.0, 20.0, 80.0), Point3(515.0, 495.0, 475.0)));
+   world->Add(std::make_shared<GridMedium<SparseGrid>>(cloud.Bounds, SparseGrid(cloud), 0.06, materials.AddIsotropic(Color(0.9, 0.9, 0.9))));
+
+   return std::move(world);
+}
+
+inline std::unique_ptr<HittableList> ComplexScene(MaterialTable& materials)
+{
+   auto objects = std::make_unique<HittableList>();
+
+   HittableList boxes0;
+   auto groundMat = materials.AddLambertian(Color(0.48, 0.83, 0.53));
+
+   constexpr int BoxesPerSide = 20;
+   for (int dx = 0; dx < BoxesPerSide; ++dx)
+   {
+      for (int dz = 0; dz < BoxesPerSide; ++dz)
+      {
+         double w = 100.0;
+         double x0 = -1000.0 + dx * w;
+         double x1 = x0 + w;
+         double z0 = -1000.0 + dz * w;
+         double z1 = z0 + w;
+         double y0 = 0.0;
+         double y1 = RandomDouble(1.0, 101.0);
+
+         boxes0.Add(std::make_shared<Box>(Point3(x0, y0, z0), Point3(x1, y1, z1), groundMat));
+      }
+   }
+
+   auto bvh = BVHCache::Instance().GetOrBuild(boxes0, 0.0, 1.0);
+   objects->Add(bvh);
+
+   auto light = materials.AddDiffuseLight(Color(7.0, 7.0, 7.0));
+   objects->Add(std::make_shared<XZRect>(123.0, 423.0, 147.0, 412.0, 554.0, light));
+
+   auto center0 = Point3(400.0, 400.0, 200.0);
+   auto center1 = center0 + Vec3(30.0, 0.0, 0.0);
+   auto movingSphereMat = materials.AddLambertian(Color(0.7, 0.3, 0.1));
+   objects->Add(std::make_shared<MovingSphere>(center0, center1, 0.0, 1.0, 50.0, movingSphereMat));
+
+   objects->Add(std::make_shared<Sphere>(Point3(260.0, 150.0, 45.0), 50.0, materials.AddDielectric(1.5)));
+   objects->Add(std::make_shared<Sphere>(Point3(0.0, 150.0, 145.0), 50.0, materials.AddMetal(Color(0.8, 0.8, 0.9), 1.0)));
+
+   auto boundary = std::make_shared<Sphere>(Point3(360.0, 150.0, 145.0), 70.0, materials.AddDielectric(1.5));
+   objects->Add(boundary);
+   objects->Add(std::make_shared<ConstantMedium>(boundary, 0.2, materials.AddIsotropic(Color(0.2, 0.4, 0.9))));
+   boundary = std::make_shared<Sphere>(Point3(0.0, 0.0, 0.0), 5000.0, materials.AddDielectric(1.5));
+   objects->Add(std::make_shared<ConstantMedium>(boundary, 0.0001, materials.AddIsotropic(Color(1.0, 1.0, 1.0))));
+
+   auto earthMat = materials.AddLambertian(materials.AddImageTexture("Resources/Textures/earthmap.jpg"));
+   objects->Add(std::make_shared<Sphere>(Point3(400.0, 200.0, 400.0), 100.0, earthMat));
+   auto whiteTexture = materials.AddSolidTexture(Color(1.0, 1.0, 1.0));
+   objects->Add(std::make_shared<Sphere>(Point3(220.0, 280.0, 300.0), 80.0, materials.AddLambertian(whiteTexture)));
+
+   HittableList boxes1;
+   auto whiteMat = materials.AddLambertian(Color(0.73, 0.73, 0.73));
+   int ns = 1000;
+   for (int ds = 0; ds < ns; ++ds)
+   {
+      boxes1.Add(std::make_shared<Sphere>(Point3::Random(0.0, 165.0), 10.0, whiteMat));
+   }
+
+   objects->Add(std::make_shared<Translate>(std::make_shared<RotateY>(BVHCache::Instance().GetOrBuild(boxes1, 0.0, 1.0), 15.0), Vec3(-100.0, 270.0, 395.0)));
+   return std::move(objects);
+}
+
+// Memory bound: a field of ten thousand rotated instances of one cluster of spheres, twenty million spheres in all.
+// The instances and the BVH over them take several megabytes, more than L2 holds, and diffuse bounces across the
+// field reach all of it in no particular order.
+inline std::unique_ptr<HittableList> InstancedClusters(MaterialTable& materials)
+{
+   auto objects = std::make_unique<HittableList>();
+   objects->Add(std::make_shared<Sphere>(Point3(0.0, -1000.0, 0.0), 1000.0, materials.AddLambertian(Color(0.5, 0.5, 0.5))));
+
+   const uint32_t clusterMats[] =
+   {
+      materials.AddLambertian(Color(0.8, 0.3, 0.2)),
+      materials.AddLambertian(Color(0.2, 0.6, 0.3)),
+      materials.AddLambertian(Color(0.3, 0.4, 0.8)),
+      materials.AddMetal(Color(0.8, 0.8, 0.7), 0.3)
+   };
+
+   HittableList cluster;
+   constexpr int SpheresPerCluster = 2000;
+   while (cluster.GetObjects().size() < SpheresPerCluster)
+   {
+      const Point3 center = Point3::Random(-1.0, 1.0);
+      if (center.SquaredLength() < 1.0)
+      {
+         cluster.Add(std::make_shared<Sphere>(center, RandomDouble(0.04, 0.1), clusterMats[RandomInt(0, 3)]));
+      }
+   }
+
+   auto clusterBVH = BVHCache::Instance().GetOrBuild(cluster, 0.0, 1.0);
+   constexpr int InstancesPerSide = 100;
+   constexpr double Spacing = 2.2;
+   for (int dx = 0; dx < InstancesPerSide; ++dx)
+   {
+      for (int dz = 0; dz < InstancesPerSide; ++dz)
+      {
+         const Vec3 offset((dx - (InstancesPerSide - 1) / 2.0) * Spacing, 1.0, (dz - (InstancesPerSide - 1) / 2.0) * Spacing);
+         objects->Add(std::make_shared<Translate>(std::make_shared<RotateY>(clusterBVH, RandomDouble(0.0, 360.0)), offset));
+      }
+   }
+
+   return std::move(objects);
+}
+
+struct CameraPreset
+{
+public:
+   std::string Name;
+   Point3 LookFrom;
+   Point3 LookAt;
+   Vec3 Up = Vec3(0.0, 1.0, 0.0);
+   double VerticalFOV = 40.0;
+   double Aperture = 0.0;
+   double FocusDistance = 10.0;
+   CameraProjection Projection = CameraProjection::Perspective;
+
+   Camera Create(double aspectRatio, double shutterOpen, double shutterClose) const
+   {
+      return Camera(LookFrom, LookAt, Up, VerticalFOV, aspectRatio, Aperture, FocusDistance, shutterOpen, shutterClose, Projection);
+   }
+
+};
+
+struct SceneDescription
+{
+public:
+   std::string_view Name;
+   std::function<std::unique_ptr<HittableList>(MaterialTable& materials, double shutterOpen, double shutterClose)> Build;
+   std::string_view DefaultCamera; // Name of camera preset the scene was composed for
+   Color Background;
+   bool bAnimated = false; // Has moving primitives; the shutter of a static scene is closed instantly
+
+};
+
+inline const std::vector<CameraPreset>& GetCameraPresets()
+{
+   static const std::vector<CameraPreset> presets =
+   {
+      { "Overview", Point3(13.0, 2.0, 3.0), Point3(0.0, 0.0, 0.0), Vec3(0.0, 1.0, 0.0), 20.0, 0.0, 10.0 },
+      { "OverviewDefocus", Point3(13.0, 2.0, 3.0), Point3(0.0, 0.0, 0.0), Vec3(0.0, 1.0, 0.0), 20.0, 0.1, 10.0 },
+      { "SimpleLight", Point3(26.0, 3.0, 6.0), Point3(0.0, 2.0, 0.0), Vec3(0.0, 1.0, 0.0), 20.0, 0.0, 10.0 },
+      { "Cornell", Point3(278.0, 278.0, -800.0), Point3(278.0, 278.0, 0.0), Vec3(0.0, 1.0, 0.0), 40.0, 0.0, 10.0 },
+      { "Complex", Point3(478.0, 278.0, -600.0), Point3(278.0, 278.0, 0.0), Vec3(0.0, 1.0, 0.0), 40.0, 0.0, 10.0 },
+      { "Instances", Point3(0.0, 8.0, 30.0), Point3(0.0, 0.0, 0.0), Vec3(0.0, 1.0, 0.0), 50.0, 0.0, 10.0 }
+   };
+
+   return presets;
+}
+
+inline const CameraPreset* FindCameraPreset(std::string_view name)
+{
+   for (const auto& preset : GetCameraPresets())
+   {
+      if (preset.Name == name)
+      {
+         return &preset;
+      }
+   }
+
+   return nullptr;
+}
+
+// Every scene the renderer and the benchmark know about.
+inline const std::vector<SceneDescription>& GetScenes()
+{
+   static const std::vector<SceneDescription> scenes =
+   {
+      { "RandomScene", [](MaterialTable& materials, double shutterOpen, double shutterClose) { return RandomScene(materials, shutterOpen, shutterClose); }, "OverviewDefocus", Color(0.7, 0.8, 1.0), true },
+      { "TwoSpheres", [](MaterialTable& materials, double, double) { return TwoSpheres(materials); }, "Overview", Color(0.7, 0.8, 1.0) },
+      { "Earth", [](MaterialTable& materials, double, double) { return Earth(materials); }, "Overview", Color(0.7, 0.8, 1.0) },
+      { "SimpleLight", [](MaterialTable& materials, double, double) { return SimpleLight(materials); }, "SimpleLight", Color() },
+      { "CornellBox", [](MaterialTable& materials, double, double) { return CornellBox(materials); }, "Cornell", Color() },
+      { "CornellBoxSmoke", [](MaterialTable& materials, double, double) { return CornellBoxSmoke(materials); }, "Cornell", Color() },
+      { "CornellBoxCloud", [](MaterialTable& materials, double, double) { return CornellBoxCloud(materials); }, "Cornell", Color() },
+      { "CornellBoxOverlappingFog", [](MaterialTable& materials, double, double) { return CornellBoxOverlappingFog(materials); }, "Cornell", Color() },
+      { "CornellBoxTouchingFog", [](MaterialTable& materials, double, double) { return CornellBoxTouchingFog(materials); }, "Cornell", Color() },
+      { "ComplexScene", [](MaterialTable& materials, double, double) { return ComplexScene(materials); }, "Complex", Color(), true },
+      { "InstancedClusters", [](MaterialTable& materials, double, double) { return InstancedClusters(materials); }, "Instances", Color(0.7, 0.8, 1.0) }
+   };
+
+   return scenes;
+}
+
+inline const SceneDescription* FindScene(std::string_view name)
+{
+   for (const auto& scene : GetScenes())
+   {
+      if (scene.Name == name)
+      {
+         return &scene;
+      }
+   }
+
+   return nullptr;
+}
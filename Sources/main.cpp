@@ -1,340 +1,772 @@
 #include <Core/CoreMinimal.h>
-#include <Core/Color.h>
-#include <Core/Sphere.h>
-#include <Core/HittableList.h>
-#include <Core/Camera.h>
-#include <Core/Material.h>
-#include <Core/Lambertian.h>
-#include <Core/Metal.h>
-#include <Core/Dielectric.h>
-#include <Core/MovingSphere.h>
-#include <Core/Texture.h>
-#include <Core/ImageTexture.h>
-#include <Core/DiffuseLight.h>
-#include <Core/Rect.h>
-#include <Core/Box.h>
-#include <Core/Instance.h>
-#include <Core/ConstantMedium.h>
-#include <Core/BVHNode.h>
-#include <Math/Vec3.h>
-#include <Math/Ray.h>
+#include <Core/Renderer.h>
+#include <Core/BVHCache.h>
+#include <Core/CommandLine.h>
+#include <Core/Profiler.h>
+#include <Core/RenderBudget.h>
+#include <Core/RenderCheckpoint.h>
+#include <Core/Tonemap.h>
+#include <Scenes/Scenes.h>
+#include <Scenes/SceneParser.h>
+#include <Scenes/SceneCompiler.h>
+#include <Scenes/CompiledScene.h>
 #include <iostream>
-#include <chrono>
+#include <optional>
+#include <string>
 
-std::unique_ptr<HittableList> RandomScene(double shutterOpen = 0.0, double shutterClose = 1.0)
+namespace CheckpointConstants
 {
-	auto world = std::make_unique<HittableList>();
-	auto groundMaterial = std::make_shared<Lambertian>(Color(0.5, 0.5, 0.5));
-	auto checkerTexture = std::make_shared<CheckerTexture>(Color(0.2, 0.3, 0.1), Color(0.9, 0.9, 0.9));
-	auto checkerMat = std::make_shared<Lambertian>(checkerTexture);
-	world->Add(std::make_shared<Sphere>(Point3(0.0, -1000.0, 0.0), 1000.0, checkerMat));
-	for (int dy = -11; dy < 11; ++dy)
-	{
-		for (int dx = -11; dx < 11; ++dx)
-		{
-			auto chooseMat = RandomDouble();
-			Point3 center(static_cast<double>(dx) + 0.9 + RandomDouble(), 0.2, static_cast<double>(dy) + 0.9 * RandomDouble());
-			auto randRad = RandomDouble(0.2f, 0.25f);
-			if ((center - Vec3(4.0, 0.2, 0.0)).Length() > 0.9)
-			{
-				std::shared_ptr<Material> sphereMatPtr;
-				if (chooseMat < 0.8)
-				{
-					// Diffuse
-					auto albedo = Color::Random() * Color::Random();
-					sphereMatPtr = std::make_shared<Lambertian>(albedo);
-					auto center1 = center + Vec3(0.0, RandomDouble(0.0, 0.5), 0.0); // y 
-					world->Add(std::make_shared<MovingSphere>(center, center1, shutterOpen, shutterClose, randRad, sphereMatPtr));
-				}
-				else if (chooseMat < 0.95)
-				{
-					// Metal
-					auto albedo = Color::Random(0.5, 1.0);
-					auto fuzz = RandomDouble(0.0, 0.5);
-					auto center1 = center + Vec3(RandomDouble(0.0, 0.5), 0.0, 0.0); // x 
-					sphereMatPtr = std::make_shared<Metal>(albedo, fuzz);
-					world->Add(std::make_shared<MovingSphere>(center, center1, shutterOpen, shutterClose, randRad, sphereMatPtr));
-				}
-				else
-				{
-					// Glass
-					sphereMatPtr = std::make_shared<Dielectric>(1.5);
-					world->Add(std::make_shared<Sphere>(center, randRad, sphereMatPtr));
-				}
-			}
-		}
-	}
-
-	auto dielectricMatPtr = std::make_shared<Dielectric>(1.5);
-	auto lambertianMatPtr = std::make_shared<Lambertian>(Color(0.4, 0.2, 0.1));
-	auto metalMatPtr = std::make_shared<Metal>(Color(0.7, 0.6, 0.5), 0.0);
-
-	world->Add(std::make_shared<Sphere>(Point3(0.0, 1.0, 0.0), 1.0, dielectricMatPtr));
-	world->Add(std::make_shared<Sphere>(Point3(-4.0, 1.0, 0.0), 1.0, lambertianMatPtr));
-	world->Add(std::make_shared<Sphere>(Point3(4.0, 1.0, 0.0), 1.0, metalMatPtr));
+	// Passes are the granularity of checkpoints; a pass of 64 samples of an 800x800 image takes minutes at most.
+	constexpr int DefaultSamplesPerPass = 64;
+}
 
-	return std::move(world);
+namespace ProgressiveConstants
+{
+	// Small enough that the first snapshot of an 800x800 image shows up within seconds.
+	constexpr int DefaultSamplesPerPass = 16;
 }
 
-std::unique_ptr<HittableList> TwoSpheres()
+struct CommandLineOptions
 {
-	auto world = std::make_unique<HittableList>();
+public:
+	std::string SceneName = "ComplexScene";
+	std::string SceneFile; // Text or compiled scene file to render instead of a built-in scene
+	std::string CompilePath; // Compile scene file to this path instead of rendering
+	std::string CameraName; // Empty to use default camera of the scene
+	std::optional<CameraProjection> Projection; // Overrides projection of the camera
+	int ImageWidth = 800;
+	int ImageHeight = 0; // Zero to make it square
+	int SamplesPerPixel = 8192;
+	int MaximumDepth = 50;
+	int SamplesPerPass = 0; // Zero for a single pass, or CheckpointConstants::DefaultSamplesPerPass when checkpointing
+	int ThreadCount = 0; // Zero to use every hardware thread
+	uint64_t Seed = 0;
+	SamplerType Sampler = SamplerType::Sobol;
+	IntegratorType Integrator = IntegratorType::Megakernel;
+	int PacketSize = 0; // Camera rays traced together by the wavefront integrator, zero for single rays
+	bool bReorderRays = false;
+	bool bGenericKernels = false;
+	BVHBuildMethod BuildMethod = BVHBuildMethod::SAH; // LBVH variants build much faster for previews
+	bool bUseBVHCache = true;
+	std::string OutputPath = "output.png";
+	std::string HDROutputPath; // Linear radiance as .exr or .pfm, empty to skip
+	std::string TonemapInput; // Tonemap this PFM image into OutputPath instead of rendering
+	TonemapSettings Tonemap;
+	std::string TimingsPath = "timings.json";
+	std::string CheckpointPath; // Empty to never write checkpoints
+	double CheckpointInterval = 600.0; // Seconds between checkpoints
+	bool bResume = false;
+	bool bProgressive = false; // Rewrite output images after passes
+	double SnapshotInterval = 0.0; // Minimum seconds between progressive snapshots
+	double TimeLimit = 0.0; // Stop after the pass which exceeds this many seconds of rendering, zero for no limit
+	double NoiseTarget = 0.0; // Stop once estimated relative error falls below this, zero for no target
+	double TimeBudget = 0.0; // Wall-clock seconds from start to written image, zero to render SamplesPerPixel
+	bool bListOnly = false;
+
+};
+
+static void PrintUsage(const char* executable)
+{
+	std::cerr << "Usage: " << executable << " [options]\n"
+		<< "  --scene <name>         Scene to render (default ComplexScene)\n"
+		<< "  --scene-file <path>    Text or compiled (.rtscene) scene file to render instead of a built-in scene\n"
+		<< "  --compile <path>       Compile text scene of --scene-file into a .rtscene file and exit\n"
+		<< "  --camera <name>        Camera preset (default: the one the scene was composed for, or first camera of scene file)\n"
+		<< "  --projection <name>    Perspective, Orthographic or Equirectangular, all around at twice as wide as high (default: camera's)\n"
+		<< "  --width <pixels>       Image width (default 800)\n"
+		<< "  --height <pixels>      Image height (default: same as width)\n"
+		<< "  --spp <count>          Samples per pixel (default 8192)\n"
+		<< "  --depth <count>        Maximum ray depth (default 50)\n"
+		<< "  --pass-spp <count>     Samples per pixel of each render pass (default: all in one pass, 64 with --checkpoint)\n"
+		<< "  --threads <count>      Render threads (default: all)\n"
+		<< "  --seed <value>         Seed of scene generation and sampling (default 0)\n"
+		<< "  --sampler <name>       Sample sequence of camera and bounce dimensions (default Sobol)\n"
+		<< "  --integrator <name>    Megakernel or Wavefront; both give the same image (default Megakernel)\n"
+		<< "  --packet-size <rays>   Trace camera rays of the wavefront integrator in packets of 4, 8 or 16 rays\n"
+		<< "  --reorder-rays         Sort secondary rays of the wavefront integrator by origin and direction before tracing\n"
+		<< "  --generic-kernels      Render with kernels compiled for every feature instead of those the scene uses\n"
+		<< "  --bvh <method>         BVH build method (default SAH)\n"
+		<< "  --no-bvh-cache         Always build BVH instead of loading it from BVHCache (SBVH never is)\n"
+		<< "  --output <path>        Output image (default output.png)\n"
+		<< "  --hdr-output <path>    Also write linear radiance as OpenEXR (.exr) or PFM (.pfm)\n"
+		<< "  --tonemap <operator>   Tonemap operator of output image (default Clamp)\n"
+		<< "  --exposure <stops>     Exposure applied before tonemapping (default 0)\n"
+		<< "  --tonemap-input <path> Tonemap a PFM image written by --hdr-output instead of rendering\n"
+		<< "  --timings <path>       Timing report (default timings.json)\n"
+		<< "  --checkpoint <path>    Save render state to this file between passes\n"
+		<< "  --checkpoint-interval <seconds>  Minimum time between checkpoints (default 600)\n"
+		<< "  --resume               Continue from --checkpoint if it exists; same scene and settings are required\n"
+		<< "  --progressive          Render in passes (default 16 spp each) and rewrite output images after each pass\n"
+		<< "  --snapshot-interval <seconds>  Minimum time between progressive snapshots (default 0)\n"
+		<< "  --time-limit <seconds> Stop after the pass that runs past this much render time; --spp is the upper limit\n"
+		<< "  --noise-target <error> Stop once mean relative standard error of pixels is below this, e.g. 0.01\n"
+		<< "  --time-budget <seconds>  Fit as many samples as possible, up to --spp, between start and written image\n"
+		<< "  --list                 List scenes, camera presets and projections, BVH build methods, samplers, integrators and tonemap operators\n";
+}
 
-	auto checkerTexture = std::make_shared<CheckerTexture>(Color(0.2, 0.3, 0.1), Color(0.9, 0.9, 0.9));
-	auto checkerMat = std::make_shared<Lambertian>(checkerTexture);
+static void PrintLists()
+{
+	std::cout << "Scenes:\n";
+	for (const auto& scene : GetScenes())
+	{
+		std::cout << "  " << scene.Name << " (camera " << scene.DefaultCamera << ")\n";
+	}
 
-	world->Add(std::make_shared<Sphere>(Point3(0.0, -10.0, 0.0), 10.0, checkerMat));
-	world->Add(std::make_shared<Sphere>(Point3(0.0, 10.0, 0.0), 10.0, checkerMat));
+	std::cout << "Camera presets:\n";
+	for (const auto& preset : GetCameraPresets())
+	{
+		std::cout << "  " << preset.Name << '\n';
+	}
 
-	return std::move(world);
-}
+	std::cout << "Camera projections:\n";
+	for (const char* name : CameraConstants::ProjectionNames)
+	{
+		std::cout << "  " << name << '\n';
+	}
 
-std::unique_ptr<HittableList> Earth()
-{
-	auto world = std::make_unique<HittableList>();
+	std::cout << "BVH build methods:\n";
+	for (const char* name : BVHBuildMethodConstants::MethodNames)
+	{
+		std::cout << "  " << name << '\n';
+	}
 
-	auto earthTexture = std::make_shared<ImageTexture>("Resources/Textures/earthmap.jpg");
-	auto earthMat = std::make_shared<Lambertian>(earthTexture);
+	std::cout << "Samplers:\n";
+	for (const char* name : SamplerConstants::SamplerNames)
+	{
+		std::cout << "  " << name << '\n';
+	}
 
-	world->Add(std::make_shared<Sphere>(Point3(0.0, 0.0, 0.0), 2.0, earthMat));
+	std::cout << "Integrators:\n";
+	for (const char* name : IntegratorConstants::IntegratorNames)
+	{
+		std::cout << "  " << name << '\n';
+	}
 
-	return std::move(world);
+	std::cout << "Tonemap operators:\n";
+	for (const char* name : TonemapConstants::OperatorNames)
+	{
+		std::cout << "  " << name << '\n';
+	}
 }
 
-std::unique_ptr<HittableList> SimpleLight()
+static bool ParseBuildMethod(std::string_view text, BVHBuildMethod& output)
 {
-	auto world = std::make_unique<HittableList>();
+	for (size_t idx = 0; idx < BVHBuildMethodConstants::MethodCount; ++idx)
+	{
+		if (text == BVHBuildMethodConstants::MethodNames[idx])
+		{
+			output = static_cast<BVHBuildMethod>(idx);
+			return true;
+		}
+	}
 
-	auto whiteTexture = std::make_shared<SolidColorTexture>(Color(1.0, 1.0, 1.0));
-	auto earthTexture = std::make_shared<ImageTexture>("Resources/Textures/earthmap.jpg");
+	return false;
+}
 
-	auto whiteLambertMat = std::make_shared<Lambertian>(whiteTexture);
-	auto earthLambertMat = std::make_shared<Lambertian>(earthTexture);
+static bool ParseProjection(std::string_view text, std::optional<CameraProjection>& output)
+{
+	for (size_t idx = 0; idx < CameraConstants::ProjectionCount; ++idx)
+	{
+		if (text == CameraConstants::ProjectionNames[idx])
+		{
+			output = static_cast<CameraProjection>(idx);
+			return true;
+		}
+	}
 
-	world->Add(std::make_shared<Sphere>(Point3(0.0, -1000.0, 0.0), 1000.0, whiteLambertMat));
-	world->Add(std::make_shared<Sphere>(Point3(0.0, 2.0, 0.0), 2.0, earthLambertMat));
+	return false;
+}
 
-	auto diffuseLightColor = std::make_shared<SolidColorTexture>(Color(4.0, 4.0, 4.0));
-	auto diffuseLight = std::make_shared<DiffuseLight>(diffuseLightColor);
-	world->Add(std::make_shared<Sphere>(Point3(0.0, 6.0, 0.0), 2.0, diffuseLight));
-	world->Add(std::make_shared<XYRect>(3.0, 5.0, 1.0, 3.0, -2.0, diffuseLight));
+static bool ParseSampler(std::string_view text, SamplerType& output)
+{
+	for (size_t idx = 0; idx < SamplerConstants::SamplerCount; ++idx)
+	{
+		if (text == SamplerConstants::SamplerNames[idx])
+		{
+			output = static_cast<SamplerType>(idx);
+			return true;
+		}
+	}
 
-	return std::move(world);
+	return false;
 }
 
-std::unique_ptr<HittableList> CornellBox()
+static bool ParseIntegrator(std::string_view text, IntegratorType& output)
 {
-	auto world = std::make_unique<HittableList>();
-
-	auto redMat = std::make_shared<Lambertian>(Color(0.65, 0.05, 0.05));
-	auto whiteMat = std::make_shared<Lambertian>(Color(0.73, 0.73, 0.73));
-	auto greenMat = std::make_shared<Lambertian>(Color(0.12, 0.45, 0.15));
-	auto lightMat = std::make_shared<DiffuseLight>(Color(15.0, 15.0, 15.0));
-
-	world->Add(std::make_shared<YZRect>(0.0, 555.0, 0.0, 555.0, 555.0, greenMat));
-	world->Add(std::make_shared<YZRect>(0.0, 555.0, 0.0, 555.0, 0.0, redMat));
-	world->Add(std::make_shared<XZRect>(213.0, 343.0, 227.0, 332.0, 554.0, lightMat));
-	world->Add(std::make_shared<XZRect>(0.0, 555.0, 0.0, 555.0, 0.0, whiteMat));
-	world->Add(std::make_shared<XZRect>(0.0, 555.0, 0.0, 555.0, 555.0, whiteMat));
-	world->Add(std::make_shared<XYRect>(0.0, 555.0, 0.0, 555.0, 555.0, whiteMat));
-
-	std::shared_ptr<Hittable> box0 = std::make_shared<Box>(Point3(0.0, 0.0, 0.0), Point3(165.0, 330.0, 165.0), whiteMat);
-	box0 = std::make_shared<RotateY>(box0, 15.0);
-	box0 = std::make_shared<Translate>(box0, Vec3(265.0, 0.0, 295.0));
-	world->Add(box0);
-
-	std::shared_ptr<Hittable> box1 = std::make_shared<Box>(Point3(0.0, 0.0, 0.0), Point3(165.0, 165.0, 165.0), whiteMat);
-	box1 = std::make_shared<RotateY>(box1, -18.0);
-	box1 = std::make_shared<Translate>(box1, Vec3(130.0, 0.0, 65.0));
-	world->Add(box1);
-
-	return std::move(world);
+	for (size_t idx = 0; idx < IntegratorConstants::IntegratorCount; ++idx)
+	{
+		if (text == IntegratorConstants::IntegratorNames[idx])
+		{
+			output = static_cast<IntegratorType>(idx);
+			return true;
+		}
+	}
+
+	return false;
 }
 
-std::unique_ptr<HittableList> CornellBoxSmoke()
+static bool ParseTonemapOperator(std::string_view text, TonemapOperator& output)
 {
-	auto world = std::make_unique<HittableList>();
-
-	auto redMat = std::make_shared<Lambertian>(Color(0.65, 0.05, 0.05));
-	auto whiteMat = std::make_shared<Lambertian>(Color(0.73, 0.73, 0.73));
-	auto greenMat = std::make_shared<Lambertian>(Color(0.12, 0.45, 0.15));
-	auto lightMat = std::make_shared<DiffuseLight>(Color(15.0, 15.0, 15.0));
-
-	world->Add(std::make_shared<YZRect>(0.0, 555.0, 0.0, 555.0, 555.0, greenMat));
-	world->Add(std::make_shared<YZRect>(0.0, 555.0, 0.0, 555.0, 0.0, redMat));
-	world->Add(std::make_shared<XZRect>(113.0, 443.0, 127.0, 432.0, 553.9, lightMat));
-	world->Add(std::make_shared<XZRect>(0.0, 555.0, 0.0, 555.0, 0.0, whiteMat));
-	world->Add(std::make_shared<XZRect>(0.0, 555.0, 0.0, 555.0, 555.0, whiteMat));
-	world->Add(std::make_shared<XYRect>(0.0, 555.0, 0.0, 555.0, 555.0, whiteMat));
-
-	std::shared_ptr<Hittable> box0 = std::make_shared<Box>(Point3(0.0, 0.0, 0.0), Point3(165.0, 330.0, 165.0), whiteMat);
-	box0 = std::make_shared<RotateY>(box0, 15.0);
-	box0 = std::make_shared<Translate>(box0, Vec3(265.0, 0.0, 295.0));
-	world->Add(std::make_shared<ConstantMedium>(box0, 0.01, Color()));
-
-	std::shared_ptr<Hittable> box1 = std::make_shared<Box>(Point3(0.0, 0.0, 0.0), Point3(165.0, 165.0, 165.0), whiteMat);
-	box1 = std::make_shared<RotateY>(box1, -18.0);
-	box1 = std::make_shared<Translate>(box1, Vec3(130.0, 0.0, 65.0));
-	world->Add(std::make_shared<ConstantMedium>(box1, 0.01, Color(1.0, 1.0, 1.0)));
-
-	return std::move(world);
+	for (size_t idx = 0; idx < TonemapConstants::OperatorCount; ++idx)
+	{
+		if (text == TonemapConstants::OperatorNames[idx])
+		{
+			output = static_cast<TonemapOperator>(idx);
+			return true;
+		}
+	}
+
+	return false;
 }
 
-std::unique_ptr<HittableList> ComplexScene()
+// Writes through a temporary file, so that viewers of progressive snapshots never see a half-written image.
+static bool WriteOutputImages(const Framebuffer& framebuffer, const CommandLineOptions& options)
 {
-	auto objects = std::make_unique<HittableList>();
+	auto replace = [](const std::filesystem::path& path, const auto& write)
+	{
+		auto tempPath = path;
+		tempPath.replace_filename(path.stem().string() + ".partial" + path.extension().string());
+		if (!write(tempPath))
+		{
+			return false;
+		}
 
-	HittableList boxes0;
-	auto groundMat = std::make_shared<Lambertian>(Color(0.48, 0.83, 0.53));
+		std::error_code error;
+		std::filesystem::rename(tempPath, path, error);
+		return !error;
+	};
 
-	constexpr int BoxesPerSide = 20;
-	for (int dx = 0; dx < BoxesPerSide; ++dx)
+	bool bSucceeded = true;
+	const HDRImage image = framebuffer.Resolve();
+	if (!options.HDROutputPath.empty())
 	{
-		for (int dz = 0; dz < BoxesPerSide; ++dz)
+		bSucceeded &= replace(options.HDROutputPath, [&image](const std::filesystem::path& path) { return image.Write(path); });
+	}
+
+	auto outputBuffer = Tonemap(image, options.Tonemap);
+	bSucceeded &= replace(options.OutputPath, [&image, &outputBuffer](const std::filesystem::path& path)
 		{
-			double w = 100.0;
-			double x0 = -1000.0 + dx * w;
-			double x1 = x0 + w;
-			double z0 = -1000.0 + dz * w;
-			double z1 = z0 + w;
-			double y0 = 0.0;
-			double y1 = RandomDouble(1.0, 101.0);
+			return stbi_write_png(path.string().c_str(), image.Width, image.Height, TonemapConstants::Channels, outputBuffer.get(), image.Width * TonemapConstants::Channels) != 0;
+		});
 
-			boxes0.Add(std::make_shared<Box>(Point3(x0, y0, z0), Point3(x1, y1, z1), groundMat));
-		}
+	if (!bSucceeded)
+	{
+		std::cerr << "Failed to write output image '" << options.OutputPath << "'.\n";
 	}
 
-	auto bvh = std::make_shared<BVHNode>(boxes0, 0.0, 1.0);
-	objects->Add(bvh);
+	return bSucceeded;
+}
+
+static bool ParseCommandLine(int argc, char** argv, CommandLineOptions& options)
+{
+	for (int idx = 1; idx < argc; ++idx)
+	{
+		const std::string_view arg = argv[idx];
+		if (arg == "--list")
+		{
+			options.bListOnly = true;
+			continue;
+		}
+		else if (arg == "--no-bvh-cache")
+		{
+			options.bUseBVHCache = false;
+			continue;
+		}
+		else if (arg == "--resume")
+		{
+			options.bResume = true;
+			continue;
+		}
+		else if (arg == "--progressive")
+		{
+			options.bProgressive = true;
+			continue;
+		}
+		else if (arg == "--reorder-rays")
+		{
+			options.bReorderRays = true;
+			continue;
+		}
+		else if (arg == "--generic-kernels")
+		{
+			options.bGenericKernels = true;
+			continue;
+		}
+		else if (arg == "--help" || arg == "-h")
+		{
+			return false;
+		}
+
+		if (idx + 1 >= argc)
+		{
+			std::cerr << "Unknown option or missing value '" << arg << "'.\n";
+			return false;
+		}
+
+		const std::string_view value = argv[++idx];
+		bool bValid = true;
+		if (arg == "--scene")
+		{
+			options.SceneName = value;
+		}
+		else if (arg == "--scene-file")
+		{
+			options.SceneFile = value;
+		}
+		else if (arg == "--compile")
+		{
+			options.CompilePath = value;
+		}
+		else if (arg == "--camera")
+		{
+			options.CameraName = value;
+		}
+		else if (arg == "--projection")
+		{
+			bValid = ParseProjection(value, options.Projection);
+		}
+		else if (arg == "--width")
+		{
+			bValid = ParseNumber(value, 1, options.ImageWidth);
+		}
+		else if (arg == "--height")
+		{
+			bValid = ParseNumber(value, 1, options.ImageHeight);
+		}
+		else if (arg == "--spp")
+		{
+			bValid = ParseNumber(value, 1, options.SamplesPerPixel);
+		}
+		else if (arg == "--depth")
+		{
+			bValid = ParseNumber(value, 1, options.MaximumDepth);
+		}
+		else if (arg == "--pass-spp")
+		{
+			bValid = ParseNumber(value, 1, options.SamplesPerPass);
+		}
+		else if (arg == "--checkpoint")
+		{
+			options.CheckpointPath = value;
+		}
+		else if (arg == "--checkpoint-interval")
+		{
+			bValid = ParseNumber(value, 0.0, options.CheckpointInterval);
+		}
+		else if (arg == "--snapshot-interval")
+		{
+			bValid = ParseNumber(value, 0.0, options.SnapshotInterval);
+		}
+		else if (arg == "--time-limit")
+		{
+			bValid = ParseNumber(value, 0.0, options.TimeLimit);
+		}
+		else if (arg == "--noise-target")
+		{
+			bValid = ParseNumber(value, 0.0, options.NoiseTarget);
+		}
+		else if (arg == "--time-budget")
+		{
+			bValid = ParseNumber(value, 0.0, options.TimeBudget);
+		}
+		else if (arg == "--threads")
+		{
+			bValid = ParseNumber(value, 0, options.ThreadCount);
+		}
+		else if (arg == "--seed")
+		{
+			bValid = ParseNumber<uint64_t>(value, 0, options.Seed);
+		}
+		else if (arg == "--sampler")
+		{
+			bValid = ParseSampler(value, options.Sampler);
+		}
+		else if (arg == "--integrator")
+		{
+			bValid = ParseIntegrator(value, options.Integrator);
+		}
+		else if (arg == "--packet-size")
+		{
+			bValid = ParsePacketSize(value, options.PacketSize);
+		}
+		else if (arg == "--bvh")
+		{
+			bValid = ParseBuildMethod(value, options.BuildMethod);
+		}
+		else if (arg == "--output")
+		{
+			options.OutputPath = value;
+		}
+		else if (arg == "--hdr-output")
+		{
+			options.HDROutputPath = value;
+		}
+		else if (arg == "--tonemap")
+		{
+			bValid = ParseTonemapOperator(value, options.Tonemap.Operator);
+		}
+		else if (arg == "--exposure")
+		{
+			bValid = ParseNumber(value, -Infinity, options.Tonemap.Exposure);
+		}
+		else if (arg == "--tonemap-input")
+		{
+			options.TonemapInput = value;
+		}
+		else if (arg == "--timings")
+		{
+			options.TimingsPath = value;
+		}
+		else
+		{
+			std::cerr << "Unknown option '" << arg << "'.\n";
+			return false;
+		}
+
+		if (!bValid)
+		{
+			std::cerr << "Invalid value '" << value << "' of '" << arg << "'.\n";
+			return false;
+		}
+	}
 
-	auto light = std::make_shared<DiffuseLight>(Color(7.0, 7.0, 7.0));
-	objects->Add(std::make_shared<XZRect>(123.0, 423.0, 147.0, 412.0, 554.0, light));
+	if (!options.CompilePath.empty() && options.SceneFile.empty())
+	{
+		std::cerr << "'--compile' needs a text scene given by '--scene-file'.\n";
+		return false;
+	}
 
-	auto center0 = Point3(400.0, 400.0, 200.0);
-	auto center1 = center0 + Vec3(30.0, 0.0, 0.0);
-	auto movingSphereMat = std::make_shared<Lambertian>(Color(0.7, 0.3, 0.1));
-	objects->Add(std::make_shared<MovingSphere>(center0, center1, 0.0, 1.0, 50.0, movingSphereMat));
+	if (options.bResume && options.CheckpointPath.empty())
+	{
+		std::cerr << "'--resume' needs a checkpoint file given by '--checkpoint'.\n";
+		return false;
+	}
 
-	objects->Add(std::make_shared<Sphere>(Point3(260.0, 150.0, 45.0), 50.0, std::make_shared<Dielectric>(1.5)));
-	objects->Add(std::make_shared<Sphere>(Point3(0.0, 150.0, 145.0), 50.0, std::make_shared<Metal>(Color(0.8, 0.8, 0.9), 1.0)));
+	// Passes of a budgeted render depend on timing, so a checkpoint of one could never be resumed exactly.
+	if (options.TimeBudget > 0.0 && !options.CheckpointPath.empty())
+	{
+		std::cerr << "'--time-budget' can't be combined with '--checkpoint'.\n";
+		return false;
+	}
 
-	auto boundary = std::make_shared<Sphere>(Point3(360.0, 150.0, 145.0), 70.0, std::make_shared<Dielectric>(1.5));
-	objects->Add(boundary);
-	objects->Add(std::make_shared<ConstantMedium>(boundary, 0.2, Color(0.2, 0.4, 0.9)));
-	boundary = std::make_shared<Sphere>(Point3(0.0, 0.0, 0.0), 5000.0, std::make_shared<Dielectric>(1.5));
-	objects->Add(std::make_shared<ConstantMedium>(boundary, 0.0001, Color(1.0, 1.0, 1.0)));
+	if (!ValidateIntegratorOptions(options.Integrator, options.PacketSize, options.bReorderRays))
+	{
+		return false;
+	}
 
-	auto earthMat = std::make_shared<Lambertian>(std::make_shared<ImageTexture>("Resources/Textures/earthmap.jpg"));
-	objects->Add(std::make_shared<Sphere>(Point3(400.0, 200.0, 400.0), 100.0, earthMat));
-	auto whiteTexture = std::make_shared<SolidColorTexture>(Color(1.0, 1.0, 1.0));
-	objects->Add(std::make_shared<Sphere>(Point3(220.0, 280.0, 300.0), 80.0, std::make_shared<Lambertian>(whiteTexture)));
+	// Anything that looks at the image between passes needs passes small enough to be useful.
+	const bool bStopsEarly = options.TimeLimit > 0.0 || options.NoiseTarget > 0.0;
+	if ((options.bProgressive || bStopsEarly) && options.SamplesPerPass == 0)
+	{
+		options.SamplesPerPass = ProgressiveConstants::DefaultSamplesPerPass;
+	}
+	else if (!options.CheckpointPath.empty() && options.SamplesPerPass == 0)
+	{
+		options.SamplesPerPass = CheckpointConstants::DefaultSamplesPerPass;
+	}
 
-	HittableList boxes1;
-	auto whiteMat = std::make_shared<Lambertian>(Color(0.73, 0.73, 0.73));
-	int ns = 1000;
-	for (int ds = 0; ds < ns; ++ds)
+	if (options.ImageHeight == 0)
 	{
-		boxes1.Add(std::make_shared<Sphere>(Point3::Random(0.0, 165.0), 10.0, whiteMat));
+		options.ImageHeight = options.ImageWidth;
 	}
 
-	objects->Add(std::make_shared<Translate>(std::make_shared<RotateY>(std::make_shared<BVHNode>(boxes1, 0.0, 1.0), 15.0), Vec3(-100.0, 270.0, 395.0)));
-	return std::move(objects);
+	return true;
 }
 
-Color RayColor(const Ray& r, const Color& background, const Hittable& world, int depth)
+int main(int argc, char** argv)
 {
-	if (depth <= 0)
+	const auto processBegin = RenderProfiler::Clock::now();
+	CommandLineOptions options;
+	if (!ParseCommandLine(argc, argv, options))
 	{
-		return Color(0.0, 0.0, 0.0);
+		PrintUsage(argv[0]);
+		return 2;
 	}
 
-	HitRecord rec;
-	if (world.Hit(r, 0.001, Infinity, rec))
+	if (options.bListOnly)
 	{
-		Ray scattered;
-		Color attenuation;
-		Color emitted = rec.MatPtr->Emitted(rec.u, rec.v, rec.p);
-		if (rec.MatPtr->Scatter(r, rec, attenuation, scattered))
+		PrintLists();
+		return 0;
+	}
+
+	if (!options.TonemapInput.empty())
+	{
+		HDRImage image;
+		if (!HDRImage::ReadPFM(options.TonemapInput, image))
 		{
-			return emitted + (attenuation * RayColor(scattered, background, world, depth - 1));
+			return 1;
 		}
 
-		return emitted;
+		auto outputBuffer = Tonemap(image, options.Tonemap);
+		if (!stbi_write_png(options.OutputPath.c_str(), image.Width, image.Height, TonemapConstants::Channels, outputBuffer.get(), image.Width * TonemapConstants::Channels))
+		{
+			std::cerr << "Failed to write output image '" << options.OutputPath << "'.\n";
+			return 1;
+		}
+
+		return 0;
 	}
 
-	return background;
-}
+	if (!options.CompilePath.empty())
+	{
+		SceneCompiler compiler;
+		if (!SceneParser::LoadFile(options.SceneFile, compiler) || !compiler.Write(options.CompilePath))
+		{
+			return 1;
+		}
+
+		std::cout << "Compiled '" << options.SceneFile << "' into '" << options.CompilePath << "'.\n";
+		return 0;
+	}
+
+	const SceneDescription* scene = nullptr;
+	SceneFileData sceneFile;
+	std::shared_ptr<CompiledScene> compiledScene;
+	if (options.SceneFile.empty())
+	{
+		scene = FindScene(options.SceneName);
+		if (scene == nullptr)
+		{
+			std::cerr << "Unknown scene '" << options.SceneName << "'. Use --list to see available scenes.\n";
+			return 2;
+		}
+	}
+
+	// Cameras defined by the scene file take precedence over presets of the same name.
+	const CameraPreset* cameraPreset = nullptr;
+	std::string_view cameraName = options.CameraName;
+	auto& profiler = RenderProfiler::Instance();
+	BVHCache::Instance().SetEnabled(options.bUseBVHCache);
+	if (scene == nullptr)
+	{
+		RenderProfiler::ScopedPhase phase(RenderPhase::SceneBuild);
+		if (CompiledScene::IsCompiledScene(options.SceneFile))
+		{
+			compiledScene = CompiledScene::Load(options.SceneFile);
+			if (compiledScene == nullptr)
+			{
+				return 1;
+			}
+
+			sceneFile.Cameras = compiledScene->GetCameras();
+			sceneFile.Background = compiledScene->GetBackground();
+			sceneFile.bAnimated = compiledScene->IsAnimated();
+		}
+		else if (!SceneParser::LoadFile(options.SceneFile, sceneFile))
+		{
+			return 1;
+		}
+
+		for (const auto& camera : sceneFile.Cameras)
+		{
+			if (cameraName.empty() || camera.Name == cameraName)
+			{
+				cameraPreset = &camera;
+				break;
+			}
+		}
+	}
+	else if (cameraName.empty())
+	{
+		cameraName = scene->DefaultCamera;
+	}
+
+	if (cameraPreset == nullptr)
+	{
+		cameraPreset = FindCameraPreset(cameraName);
+		if (cameraPreset == nullptr)
+		{
+			std::cerr << "Unknown camera preset '" << cameraName << "'. Use --list to see available presets.\n";
+			return 2;
+		}
+	}
+
+#ifdef _OPENMP
+	if (options.ThreadCount > 0)
+	{
+		omp_set_num_threads(options.ThreadCount);
+	}
+#endif
 
-int main()
-{
 	// Output Image
-	constexpr double aspectRatio = 1.0;
-	constexpr int imageWidth = 800;
-	constexpr int imageHeight = static_cast<int>(imageWidth/aspectRatio);
-	constexpr int imageChannels = 3; // RGB
-	constexpr int samplesPerPixel = 8192;
-	constexpr int maximumDepth = 50;
-
-	auto outputBuffer = std::make_unique<unsigned char[]>(imageWidth*imageHeight*imageChannels);
-
-	// Camera
-	// Cornell
-	//Point3 lookFrom(278.0, 278.0, -800.0);
-	//Point3 lookAt(278.0, 278.0, 0.0);
-	//Vec3 up(0.0, 1.0, 0.0);
-	//auto distToFocus = 10.0;
-	//auto aperture = 0.0;
-	//auto shutterOpen = 0.0;
-	//auto shutterClose = 1.0;
-	//auto verticalFOV = 40.0;
-
-	Point3 lookFrom(478.0, 278.0, -600.0);
-	Point3 lookAt(278.0, 278.0, 0.0);
-	Vec3 up(0.0, 1.0, 0.0);
-	auto distToFocus = 10.0;
-	auto aperture = 0.0;
+	const double aspectRatio = static_cast<double>(options.ImageWidth) / options.ImageHeight;
+
+	// Camera; the shutter of a static scene closes at once, which spares the renderer sampling time.
+	const bool bAnimated = scene != nullptr ? scene->bAnimated : sceneFile.bAnimated;
 	auto shutterOpen = 0.0;
-	auto shutterClose = 1.0;
-	auto verticalFOV = 40.0;
-	Camera cam(lookFrom, lookAt, up, verticalFOV, aspectRatio, aperture, distToFocus, shutterOpen, shutterClose);
+	auto shutterClose = bAnimated ? 1.0 : shutterOpen;
+	CameraPreset cameraSettings = *cameraPreset;
+	cameraSettings.Projection = options.Projection.value_or(cameraPreset->Projection);
+	Camera cam = cameraSettings.Create(aspectRatio, shutterOpen, shutterClose);
 
 	// World
-	//auto world = std::move(RandomScene(shutterOpen, shutterClose));
-	//auto world = std::move(TwoSpheres());
-	//auto world = std::move(SimpleLight());
-	//auto world = std::move(CornellBoxSmoke());
-	auto world = std::move(ComplexScene());
-	Color background = Color();
+	std::unique_ptr<HittableList> world;
+	Color background = sceneFile.Background;
+	if (scene != nullptr)
+	{
+		RenderProfiler::ScopedPhase phase(RenderPhase::SceneBuild);
+		SeedRandom(options.Seed);
+		world = scene->Build(sceneFile.Materials, shutterOpen, shutterClose);
+		background = scene->Background;
+	}
+	else
+	{
+		world = std::move(sceneFile.World);
+	}
 
-	auto begin = std::chrono::system_clock::now();
+	// Compiled scenes carry their own BVHs and materials.
+	std::shared_ptr<Hittable> worldBVH = compiledScene;
+	const MaterialTable& materials = compiledScene != nullptr ? compiledScene->GetMaterials() : sceneFile.Materials;
+	if (compiledScene == nullptr)
+	{
+		worldBVH = BVHCache::Instance().GetOrBuild(*world, shutterOpen, shutterClose, options.BuildMethod);
+	}
 
 	// Render
-#pragma omp parallel for schedule(dynamic, 1)
-	for (int dy = imageHeight - 1; dy >= 0; --dy)
+	RenderSettings settings;
+	settings.ImageWidth = options.ImageWidth;
+	settings.ImageHeight = options.ImageHeight;
+	settings.SamplesPerPixel = options.SamplesPerPixel;
+	settings.MaximumDepth = options.MaximumDepth;
+	settings.SamplesPerPass = options.SamplesPerPass;
+	settings.Seed = options.Seed;
+	settings.Sampler = options.Sampler;
+	settings.Integrator = options.Integrator;
+	settings.PacketSize = options.PacketSize;
+	settings.bReorderRays = options.bReorderRays;
+	settings.bSpecializeKernels = !options.bGenericKernels;
+	profiler.SetSetting("scene", scene != nullptr ? options.SceneName : options.SceneFile);
+	profiler.SetSetting("camera", cameraPreset->Name);
+	profiler.SetSetting("projection", CameraConstants::ProjectionNames[static_cast<size_t>(cam.GetProjection())]);
+	profiler.SetSetting("bvhBuildMethod", BVHBuildMethodConstants::MethodNames[static_cast<size_t>(options.BuildMethod)]);
+
+	settings.bTrackVariance = options.NoiseTarget > 0.0;
+	Renderer renderer(settings);
+	Framebuffer framebuffer(settings.ImageWidth, settings.ImageHeight, settings.bTrackVariance);
+	// Perspective renders keep the key they had before cameras had projections, so their checkpoints still resume.
+	std::string sceneKey = (scene != nullptr ? options.SceneName : options.SceneFile) + '\n' + cameraPreset->Name;
+	if (cam.GetProjection() != CameraProjection::Perspective)
+	{
+		sceneKey += '\n' + std::string(CameraConstants::ProjectionNames[static_cast<size_t>(cam.GetProjection())]);
+	}
+
+	const uint64_t sceneHash = RenderCheckpoint::HashSceneKey(sceneKey);
+	int completedPasses = 0;
+	if (options.bResume && std::filesystem::exists(options.CheckpointPath))
+	{
+		if (!RenderCheckpoint::Load(options.CheckpointPath, settings, renderer, sceneHash, framebuffer, completedPasses))
+		{
+			return 1;
+		}
+
+		std::cerr << "Resuming from pass " << completedPasses << '/' << renderer.GetPassCount() << " of checkpoint '" << options.CheckpointPath << "'.\n";
+	}
+
+	// Samples per pass of a budgeted render follow the measured speed; a given pass size becomes their upper limit.
+	std::optional<RenderBudget> budget;
+	if (options.TimeBudget > 0.0)
+	{
+		const auto deadline = processBegin + std::chrono::duration_cast<RenderProfiler::Clock::duration>(
+			std::chrono::duration<double>(options.TimeBudget - RenderBudgetConstants::OutputReserveSeconds));
+		budget.emplace(deadline, settings.SamplesPerPixel, settings.SamplesPerPass);
+	}
+
+	const auto renderBegin = RenderProfiler::Clock::now();
+	auto lastCheckpoint = renderBegin;
+	auto lastSnapshot = renderBegin;
+	auto planPass = [&](int pass)
 	{
-		std::cerr << "\rScanlines Reamining : " << dy << ' ' << std::flush;
-		for (int dx = 0; dx < imageWidth; ++dx)
+		if (!budget)
+		{
+			return renderer.GetSamplesOfPass(pass);
+		}
+
+		const bool bCalibrated = budget->HasPlan();
+		const int samples = budget->BeginPass();
+		if (!bCalibrated && budget->HasPlan())
+		{
+			std::cerr << "\nCalibrated " << budget->GetSecondsPerSample() << " s per sample per pixel; planning "
+				<< budget->GetPlannedSamples() << " samples per pixel, rendered by "
+				<< RenderProfiler::SecondsBetween(processBegin, budget->GetPlannedFinish()) << " s of " << options.TimeBudget << " s budget.\n";
+		}
+
+		return samples;
+	};
+
+	auto onPassDone = [&](int passes)
+	{
+		if (budget)
+		{
+			budget->EndPass();
+		}
+
+		const auto now = RenderProfiler::Clock::now();
+		completedPasses = passes;
+		bool bStop = false;
+		if (options.TimeLimit > 0.0 && RenderProfiler::SecondsBetween(renderBegin, now) >= options.TimeLimit)
+		{
+			std::cerr << "\nTime limit of " << options.TimeLimit << " s reached.";
+			bStop = true;
+		}
+		else if (options.NoiseTarget > 0.0)
 		{
-			Color pixelColor(0.0f, 0.0f, 0.0f);
-			for (int ds = 0; ds < samplesPerPixel; ++ds)
+			const double relativeError = framebuffer.EstimateRelativeError();
+			if (relativeError <= options.NoiseTarget)
 			{
-				auto u = (double(dx) + RandomDouble()) / (imageWidth - 1);
-				auto v = (double(dy) + RandomDouble()) / (imageHeight - 1);
-				Ray r = cam.GetRay(u, v);
-				pixelColor += RayColor(r, background, *world, maximumDepth);
+				std::cerr << "\nNoise target reached, relative error " << relativeError << '.';
+				bStop = true;
 			}
+		}
 
-			size_t base = ((imageHeight - dy - 1) * imageWidth * imageChannels) + (dx * imageChannels);
-			WriteColor(outputBuffer, pixelColor, base, samplesPerPixel);
+		const bool bFinished = bStop || passes == renderer.GetPassCount();
+		if (!options.CheckpointPath.empty() && (bFinished || RenderProfiler::SecondsBetween(lastCheckpoint, now) >= options.CheckpointInterval))
+		{
+			RenderCheckpoint::Write(options.CheckpointPath, settings, renderer, sceneHash, passes, framebuffer);
+			lastCheckpoint = now;
 		}
+
+		// Final images are written once rendering is done.
+		if (options.bProgressive && !bFinished && RenderProfiler::SecondsBetween(lastSnapshot, now) >= options.SnapshotInterval)
+		{
+			WriteOutputImages(framebuffer, options);
+			lastSnapshot = RenderProfiler::Clock::now();
+		}
+
+		return !bStop;
+	};
+
+	renderer.Render(cam, *worldBVH, materials, background, framebuffer, completedPasses, planPass, onPassDone);
+	const auto renderEnd = RenderProfiler::Clock::now();
+	const int completedSamples = static_cast<int>(framebuffer.SampleCount(0));
+	std::cerr << "Rendered " << completedSamples << " of " << settings.SamplesPerPixel << " samples per pixel.\n";
+	profiler.SetSetting("completedSamplesPerPixel", completedSamples);
+
+	profiler.BeginPhase(RenderPhase::ImageWrite);
+	WriteOutputImages(framebuffer, options);
+	profiler.EndPhase(RenderPhase::ImageWrite);
+
+	if (budget)
+	{
+		const double renderedAt = RenderProfiler::SecondsBetween(processBegin, renderEnd);
+		const double finishedAt = RenderProfiler::SecondsBetween(processBegin, RenderProfiler::Clock::now());
+		const double plannedAt = budget->HasPlan() ? RenderProfiler::SecondsBetween(processBegin, budget->GetPlannedFinish()) : renderedAt;
+		const double predictedAt = budget->HasPlan() ? RenderProfiler::SecondsBetween(processBegin, budget->GetPredictedFinish()) : renderedAt;
+		std::cerr << "Time budget " << options.TimeBudget << " s: rendered by " << renderedAt << " s (predicted " << predictedAt
+			<< " s before last pass, " << plannedAt << " s after calibration), finished at " << finishedAt << " s.\n";
+		profiler.SetSetting("timeBudgetSeconds", options.TimeBudget);
+		profiler.SetSetting("plannedSamplesPerPixel", budget->HasPlan() ? budget->GetPlannedSamples() : completedSamples);
+		profiler.SetSetting("plannedRenderEndSeconds", plannedAt);
+		profiler.SetSetting("predictedRenderEndSeconds", predictedAt);
+		profiler.SetSetting("renderEndSeconds", renderedAt);
+		profiler.SetSetting("finishSeconds", finishedAt);
 	}
 
-	stbi_write_png("output.png", imageWidth, imageHeight, imageChannels, outputBuffer.get(), imageWidth * imageChannels);
-	std::cerr << "\nRendering Done\n";
+#if RT_ENABLE_STATS
+	Statistics::Report("stats_");
+#endif
 
-	auto end = std::chrono::system_clock::now();
-	auto elapsed = std::chrono::duration_cast<std::chrono::seconds>(end - begin);
-	std::cout << "Taken : " << elapsed.count() << " seconds" << std::endl;
+	profiler.PrintSummary(std::cout);
+	profiler.WriteJson(options.TimingsPath);
 
    return 0;
-}
\ No newline at end of file
+}